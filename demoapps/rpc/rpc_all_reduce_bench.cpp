@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/rpc/dc_init_from_mpi.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/timer.hpp>
+using namespace graphlab;
+
+/*
+ * Compares the all_reduce() tree with the ring of all_reduce_vector()
+ * on vectors of doubles of increasing length.
+ *
+ * usage: mpiexec -n [N] rpc_all_reduce_bench [max length] [repetitions]
+ */
+struct reducer {
+  dc_dist_object<reducer> rmi;
+  reducer(distributed_control &dc):rmi(dc, this) {
+    dc.barrier();
+  }
+
+  // returns the seconds per all reduce of length doubles through the
+  // tree if ring is false, and through the ring otherwise
+  double run(size_t length, size_t repetitions, bool ring) {
+    rmi.set_ring_all_reduce_bytes(ring ? 0 : (size_t)(-1));
+    std::vector<double> data(length);
+    rmi.barrier();
+    timer ti;
+    ti.start();
+    for (size_t r = 0;r < repetitions; ++r) {
+      for (size_t i = 0;i < length; ++i) data[i] = rmi.procid() + i;
+      rmi.all_reduce_vector(data);
+    }
+    double t = ti.current_time() / repetitions;
+    // each element is the sum over the machines of procid + i
+    const size_t p = rmi.numprocs();
+    for (size_t i = 0;i < length; ++i) {
+      ASSERT_EQ(data[i], double(p * (p - 1) / 2 + p * i));
+    }
+    rmi.barrier();
+    return t;
+  }
+};
+
+
+int main(int argc, char** argv) {
+  mpi_tools::init(argc, argv);
+  distributed_control dc;
+  size_t max_length = argc > 1 ? atol(argv[1]) : (1 << 24);
+  size_t repetitions = argc > 2 ? atol(argv[2]) : 5;
+
+  reducer red(dc);
+  for (size_t length = 1024;length <= max_length; length *= 4) {
+    double tree = red.run(length, repetitions, false);
+    double ring = red.run(length, repetitions, true);
+    if (dc.procid() == 0) {
+      double mb = double(length * sizeof(double)) / 1024 / 1024;
+      std::cout << dc.numprocs() << " machines, " << length << " doubles: "
+                << "tree " << tree << "s (" << mb / tree << " MB/s), "
+                << "ring " << ring << "s (" << mb / ring << " MB/s)"
+                << std::endl;
+    }
+  }
+  dc.barrier();
+  mpi_tools::finalize();
+}
@@ -1,12 +1,18 @@
 #! /bin/bash
 
 apppath=./graph_analytics/
-datasetpath=/home/xcgoner/lab/jmlr2015/dataset/
-resultpath=/home/xcgoner/lab/jmlr2015/result/
+datasetpath=${DATASET_PATH:-./dataset/}
+resultpath=${RESULT_PATH:-./result/}
 
 nmachines=24
 niterations=100
 
+# partition quality of every ingress method, one JSON object per line
+for dataset in web-google/web-Google lj2008/lj2008_a wiki/wiki_a
+do
+	mpirun -n $nmachines ${apppath}partition_bench --graph=$datasetpath$dataset --format=snap --graph_opts threshold=150,interval=2000 --iterations=$niterations --result_file=${resultpath}partition_bench.json
+done
+
 
 for appname in test_partition test_cc kcore approximate_diameter
 do
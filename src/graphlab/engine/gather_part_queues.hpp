@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_GATHER_PART_QUEUES_HPP
+#define GRAPHLAB_GATHER_PART_QUEUES_HPP
+
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+
+namespace graphlab {
+
+  /**
+   * \brief The gathers of high degree vertices split into parts which
+   * the threads of a synchronous engine steal from each other.
+   *
+   * A part is a range of the in or out edges of a vertex. The parts of
+   * a vertex go to the queue of the thread which split it. That thread
+   * takes them from the back of its queue, and the threads done with
+   * their own vertices steal them from the front of the other queues.
+   * The partial results are combined in the split_gather of the vertex
+   * with the += of GatherType, and the engine finishes the gather of
+   * the vertex when combine() reports its last part.
+   */
+  template <typename GatherType>
+  class gather_part_queues {
+  public:
+    /// The combined result of the parts of a vertex
+    struct split_gather {
+      simple_spinlock lock;
+      GatherType accum;
+      bool accum_is_set;
+      size_t remaining_parts;
+      split_gather() : accum_is_set(false), remaining_parts(0) { }
+    };
+
+    /// The edges [begin, end) of the in or out edges of lvid
+    struct gather_part {
+      lvid_type lvid;
+      bool in_edges;
+      size_t begin, end;
+      split_gather* gather;
+    };
+
+    gather_part_queues() { pending = 0; }
+
+    /// Makes one queue per thread
+    void resize(size_t nthreads) { queues.resize(nthreads); }
+
+    /**
+     * Returns the number of edges of the parts of a super-step which
+     * gathers about work local edges: the larger of min_edges and a
+     * quarter of the share of a thread.
+     */
+    size_t part_edges(size_t work, size_t min_edges) const {
+      return std::max(min_edges, work / (4 * queues.size()));
+    }
+
+    /**
+     * Splits the gather of lvid over nin in edges and nout out edges
+     * into parts of part_edges edges, queued by thread_id. accum is the
+     * initial value of the combined result.
+     */
+    void split(size_t thread_id, lvid_type lvid, size_t nin, size_t nout,
+               size_t part_edges, const GatherType& accum) {
+      split_gather* gather = new split_gather();
+      gather->accum = accum;
+      std::vector<gather_part> parts;
+      for (size_t i = 0; i < 2; ++i) {
+        const size_t nedges = (i == 0) ? nin : nout;
+        for (size_t begin = 0; begin < nedges; begin += part_edges) {
+          gather_part part;
+          part.lvid = lvid;
+          part.in_edges = (i == 0);
+          part.begin = begin;
+          part.end = std::min(begin + part_edges, nedges);
+          part.gather = gather;
+          parts.push_back(part);
+        }
+      }
+      gather->remaining_parts = parts.size();
+      pending += parts.size();
+      queue& q = queues[thread_id];
+      q.lock.lock();
+      q.parts.insert(q.parts.end(), parts.begin(), parts.end());
+      q.lock.unlock();
+    }
+
+    /**
+     * Takes the last part of the queue of thread_id or, if steal is set
+     * and that queue is empty, the first part of another queue. Returns
+     * false if no part was found.
+     */
+    bool next(size_t thread_id, bool steal, gather_part& part) {
+      for (size_t i = 0; i < (steal ? queues.size() : 1); ++i) {
+        queue& q = queues[(thread_id + i) % queues.size()];
+        q.lock.lock();
+        const bool found = !q.parts.empty();
+        if (found && i == 0) {
+          part = q.parts.back();
+          q.parts.pop_back();
+        } else if (found) {
+          part = q.parts.front();
+          q.parts.pop_front();
+        }
+        q.lock.unlock();
+        if (found) return true;
+      }
+      return false;
+    }
+
+    /**
+     * Adds the result of a part to the result of its vertex. Returns
+     * true for the last part of the vertex: the caller then finishes
+     * the gather with part.gather and deletes it.
+     */
+    bool combine(const gather_part& part, const GatherType& accum,
+                 bool accum_is_set) {
+      split_gather& gather = *part.gather;
+      gather.lock.lock();
+      if (accum_is_set) {
+        if (gather.accum_is_set) {
+          gather.accum += accum;
+        } else {
+          gather.accum = accum;
+          gather.accum_is_set = true;
+        }
+      }
+      const bool last_part = (--gather.remaining_parts == 0);
+      gather.lock.unlock();
+      return last_part;
+    }
+
+    /// Called once a part, and its vertex if it was the last part, is done
+    void part_done() { pending.dec(); }
+
+    /// The number of parts queued or running
+    size_t num_pending() const { return pending.value; }
+
+  private:
+    struct queue {
+      simple_spinlock lock;
+      std::deque<gather_part> parts;
+    };
+    std::vector<queue> queues;
+    atomic<size_t> pending;
+  }; // end of gather_part_queues
+
+} // end of namespace graphlab
+
+#endif
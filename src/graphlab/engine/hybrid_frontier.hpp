@@ -0,0 +1,213 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_HYBRID_FRONTIER_HPP
+#define GRAPHLAB_HYBRID_FRONTIER_HPP
+
+#include <vector>
+#include <algorithm>
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+
+namespace graphlab {
+
+  /**
+   * \brief A set of local vertices stored as a dense_bitset and, while
+   * it is small, also as a queue of its lvids.
+   *
+   * Every lvid whose bit is set is appended to the queue, until the
+   * queue holds capacity lvids. The frontier is then dense and only the
+   * bitset describes it. It becomes sparse again when it is cleared, or
+   * when make_sparse() finds that it fits in the queue.
+   *
+   * Clearing and sweeping a sparse frontier costs the size of its queue
+   * rather than the number of vertices. The bits cleared with
+   * clear_bit() stay in the queue and are skipped by the sweeps, so an
+   * lvid must not be cleared and set again before the next clear().
+   */
+  class hybrid_frontier {
+  public:
+    hybrid_frontier() : sweep_queue(false), sweep_end(0) { count = 0; }
+
+    /** Resizes the frontier to n vertices with a queue of at most
+     *  capacity lvids. The frontier is left empty. */
+    void resize(size_t n, size_t capacity) {
+      bits.resize(n);
+      bits.clear();
+      queue.resize(capacity);
+      count = 0;
+    }
+
+    /// The number of vertices
+    size_t size() const { return bits.size(); }
+
+    inline bool get(lvid_type lvid) const { return bits.get(lvid); }
+
+    /** Sets the bit of lvid and returns its previous value. Safe to call
+     *  from several threads. */
+    inline bool set_bit(lvid_type lvid) {
+      if (bits.set_bit(lvid)) return true;
+      // a dense frontier stops counting, so the counter is not contended
+      if (count.value <= queue.size()) {
+        const size_t pos = count.inc_ret_last();
+        if (pos < queue.size()) queue[pos] = lvid;
+      }
+      return false;
+    }
+
+    inline bool clear_bit(lvid_type lvid) { return bits.clear_bit(lvid); }
+
+    /// True if the queue lists every vertex of the frontier
+    inline bool is_sparse() const { return count.value <= queue.size(); }
+
+    /// The number of lvids in the queue
+    inline size_t num_queued() const {
+      return std::min(size_t(count.value), queue.size());
+    }
+
+    /// The i-th lvid of the queue
+    inline lvid_type queued(size_t i) const { return queue[i]; }
+
+    /// Adds every vertex. The frontier becomes dense.
+    void fill() {
+      bits.fill();
+      count = queue.size() + 1;
+    }
+
+    /// Removes every vertex. Not thread safe.
+    void clear() {
+      const size_t nqueued = num_queued();
+      if (is_sparse() && nqueued < num_words()) {
+        for (size_t i = 0; i < nqueued; ++i) bits.clear_bit_unsync(queue[i]);
+      } else {
+        bits.clear();
+      }
+      count = 0;
+    }
+
+    /**
+     * Makes a dense frontier sparse if it fits in the queue. The bitset
+     * is counted and the queue is written in parallel, by chunks of
+     * words, so the queue lists the vertices in lvid order. Returns
+     * is_sparse(). Not thread safe.
+     */
+    bool make_sparse() {
+      if (is_sparse()) return true;
+      const size_t WORDS_PER_CHUNK = 1024;
+      const ssize_t nchunks = (num_words() + WORDS_PER_CHUNK - 1) / WORDS_PER_CHUNK;
+      std::vector<size_t> offsets(nchunks + 1, 0);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t c = 0; c < nchunks; ++c) {
+        const size_t end = std::min((c + 1) * WORDS_PER_CHUNK, num_words());
+        size_t n = 0;
+        for (size_t w = c * WORDS_PER_CHUNK; w < end; ++w) {
+          n += __builtin_popcountl(word(w));
+        }
+        offsets[c + 1] = n;
+      }
+      for (ssize_t c = 0; c < nchunks; ++c) offsets[c + 1] += offsets[c];
+      if (offsets[nchunks] > queue.size()) return false;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t c = 0; c < nchunks; ++c) {
+        const size_t end = std::min((c + 1) * WORDS_PER_CHUNK, num_words());
+        size_t pos = offsets[c];
+        for (size_t w = c * WORDS_PER_CHUNK; w < end; ++w) {
+          size_t bitword = word(w);
+          while (bitword != 0) {
+            queue[pos++] = w * WORD_BITS + __builtin_ctzl(bitword);
+            bitword &= bitword - 1;
+          }
+        }
+      }
+      count = offsets[nchunks];
+      return true;
+    }
+
+    /**
+     * Prepares the next sweep: over the queue if use_queue is set and
+     * the frontier is sparse, or else over the whole bitset. Called
+     * before the threads start sweeping, and the counter handed to
+     * next_block() must then be zero.
+     */
+    void begin_sweep(bool use_queue = true) {
+      sweep_queue = use_queue && is_sparse();
+      sweep_end = sweep_queue ? num_queued() : bits.size();
+    }
+
+    /**
+     * Fills block with the next lvids of the sweep whose bit is set,
+     * handing out 64 positions at a time to the threads through
+     * counter. Returns false when the sweep is over.
+     */
+    bool next_block(atomic<size_t>& counter,
+                    std::vector<lvid_type>& block) const {
+      block.clear();
+      while (block.empty()) {
+        const size_t start = counter.inc_ret_last(WORD_BITS);
+        if (start >= sweep_end) return false;
+        if (sweep_queue) {
+          const size_t end = std::min(start + WORD_BITS, sweep_end);
+          for (size_t i = start; i < end; ++i) {
+            if (bits.get(queue[i])) block.push_back(queue[i]);
+          }
+        } else {
+          size_t bitword = word(start / WORD_BITS);
+          while (bitword != 0) {
+            block.push_back(start + __builtin_ctzl(bitword));
+            bitword &= bitword - 1;
+          }
+        }
+      }
+      return true;
+    }
+
+  private:
+    static const size_t WORD_BITS = 8 * sizeof(size_t);
+
+    dense_bitset bits;
+    std::vector<lvid_type> queue;
+    /// The number of bits set since the last clear, capped near the capacity
+    atomic<size_t> count;
+    bool sweep_queue;
+    size_t sweep_end;
+
+    size_t num_words() const {
+      return (bits.size() + WORD_BITS - 1) / WORD_BITS;
+    }
+
+    /// Word w of the bitset without the bits past the last vertex
+    size_t word(size_t w) const {
+      size_t ret = bits.containing_word(w * WORD_BITS);
+      const size_t nbits = bits.size() - w * WORD_BITS;
+      if (nbits < WORD_BITS) ret &= (size_t(1) << nbits) - 1;
+      return ret;
+    }
+  }; // end of hybrid_frontier
+
+} // end of namespace graphlab
+
+#endif
@@ -34,6 +34,8 @@
 #include <graphlab/vertex_program/context.hpp>
 
 #include <graphlab/engine/execution_status.hpp>
+#include <graphlab/engine/hybrid_frontier.hpp>
+#include <graphlab/engine/gather_part_queues.hpp>
 #include <graphlab/options/graphlab_options.hpp>
 
 
@@ -189,6 +191,39 @@ namespace graphlab {
    * or update (\ref icontext::post_delta) the cache values of
    * neighboring vertices during the scatter phase.
    *
+   * \li <b>track_changes</b>: (default: false) When set, the vertex
+   * data is only sent to the mirrors if the apply changed it, and then
+   * only as the delta encoded by \ref ivertex_program::diff_vertex_data.
+   * The bytes saved are logged every iteration.
+   *
+   * \li <b>direction</b>: (default: auto) How a super-step finds its
+   * active vertices. \c pull sweeps the activity bitsets over all the
+   * local vertices. \c push follows the lvid queues which the
+   * frontiers keep while they are sparse (see \ref hybrid_frontier),
+   * so that a small frontier costs time proportional to its size.
+   * \c auto pushes while the frontier is small, see \c push_threshold.
+   *
+   * \li <b>push_threshold</b>: (default: 0.05) With direction=auto a
+   * super-step pushes if both the vertices of its frontier and their
+   * local edges are at most this fraction of the local vertices and
+   * edges.
+   *
+   * \li <b>gather_split_edges</b>: (default: 4096) Each super-step the
+   * gather work of the active vertices is estimated from their number
+   * of local edges in the gather direction. The gather of a vertex
+   * with more than max(gather_split_edges, work / (4 * ncpus)) local
+   * edges is split into parts of that many edges, which the threads
+   * done with their own vertices steal. The partial results are
+   * combined with the += of the gather_type, so the gather of such a
+   * vertex program may run on several threads at once. 0 disables the
+   * splitting.
+   *
+   * \li <b>compress_exchanges</b>: (default: false) When set, the send
+   * buffers of the exchanges between the masters and the mirrors are
+   * compressed with \ref lz_compress, trading CPU time for network
+   * bandwidth. The compression ratio and time of each exchange are
+   * logged at the end of start().
+   *
    * \li \b snapshot_interval If set to a positive value, a snapshot
    * is taken every this number of iterations. If set to 0, a snapshot
    * is taken before the first iteration. If set to a negative value,
@@ -441,6 +476,39 @@ namespace graphlab {
      */
     bool sched_allv;
 
+    /**
+     * \brief Only send the changes of the vertex data to the mirrors
+     */
+    bool track_changes;
+
+    /**
+     * \brief The direction option: "pull", "push" or "auto"
+     */
+    std::string direction;
+
+    /**
+     * \brief With direction "auto" a super-step pushes if its frontier
+     * holds at most this fraction of the local vertices and edges
+     */
+    double push_threshold;
+
+    /**
+     * \brief The smallest number of edges of a gather part. 0 disables
+     * the splitting of the gathers.
+     */
+    size_t gather_split_edges;
+
+    /**
+     * \brief True if the current super-step follows the queues of the
+     * sparse frontiers rather than sweeping their bitsets.
+     */
+    bool push_superstep;
+
+    /**
+     * \brief The number of super-steps of the last start() which pushed
+     */
+    size_t num_push_supersteps;
+
     /**
      * \brief Used to stop the engine prematurely
      */
@@ -477,7 +545,7 @@ namespace graphlab {
     /**
      * \brief Bit indicating whether a message is present for each vertex.
      */
-    dense_bitset has_message;
+    hybrid_frontier has_message;
 
 
     /**
@@ -501,7 +569,7 @@ namespace graphlab {
      * set while holding the lock in
      * \ref graphlab::powerlyra_sync_engine::vlocks.
      */
-    dense_bitset has_gather_accum;
+    hybrid_frontier has_gather_accum;
 
 
     /**
@@ -523,7 +591,7 @@ namespace graphlab {
      * \brief A bit (for master vertices) indicating if that vertex is active
      * (received a message on this iteration).
      */
-    dense_bitset active_superstep;
+    hybrid_frontier active_superstep;
 
     /**
      * \brief  The number of local vertices (masters) that are active on this
@@ -535,7 +603,7 @@ namespace graphlab {
      * \brief A bit indicating (for all vertices) whether to
      * participate in the current minor-step (gather or scatter).
      */
-    dense_bitset active_minorstep;
+    hybrid_frontier active_minorstep;
 
     /**
      * \brief A counter measuring the number of gathers that have been completed
@@ -552,6 +620,67 @@ namespace graphlab {
      */
     atomic<size_t> completed_scatters;
 
+    /**
+     * \brief Counts the mirror updates of the vertex data when
+     * track_changes is set. Every field is summed over the mirrors.
+     */
+    struct vdata_sync_stats : public IS_POD_TYPE {
+      /// bytes the new vertex data would have taken
+      size_t full_bytes;
+      /// bytes of the deltas sent instead
+      size_t sent_bytes;
+      /// updates not sent since the data did not change
+      size_t suppressed;
+      vdata_sync_stats() : full_bytes(0), sent_bytes(0), suppressed(0) { }
+      vdata_sync_stats& operator+=(const vdata_sync_stats& other) {
+        full_bytes += other.full_bytes;
+        sent_bytes += other.sent_bytes;
+        suppressed += other.suppressed;
+        return *this;
+      }
+    };
+
+    /**
+     * \brief The mirror update counts of each thread in the current
+     * iteration.
+     */
+    std::vector<vdata_sync_stats> per_thread_vdata_stats;
+
+    /**
+     * \brief The mirror update counts of all the machines since start.
+     */
+    vdata_sync_stats total_vdata_stats;
+
+
+    typedef gather_part_queues<gather_type> gather_part_queues_type;
+    typedef typename gather_part_queues_type::gather_part gather_part;
+
+    /// The parts of the gathers split in this super-step
+    gather_part_queues_type gather_parts;
+
+    /// The estimated number of local edges gathered in this super-step
+    atomic<size_t> gather_work;
+
+    /**
+     * \brief The number of edges of a gather part in this super-step,
+     * or 0 if the gathers are not split.
+     */
+    size_t gather_part_edges;
+
+    /**
+     * \brief Started at the beginning of the gather, apply and scatter
+     * phases. Every thread records in per_thread_finish_time when it is
+     * done with the vertices of the phase.
+     */
+    timer phase_timer;
+    std::vector<double> per_thread_finish_time;
+
+    /**
+     * \brief The time between the first and the last thread finishing
+     * the gather, apply and scatter phases, summed over the super-steps
+     * of the last start().
+     */
+    double barrier_tail_time;
 
     /**
      * \brief The shared counter used coordinate operations between
@@ -632,6 +761,24 @@ namespace graphlab {
      */
     update_exchange_type update_exchange;
 
+    /**
+     * \brief The pair type used to send the encoded change of the
+     * vertex data when track_changes is set.
+     */
+    typedef std::pair<vertex_id_type, std::string> vid_vdelta_pair_type;
+
+    /**
+     * \brief The type of the express used to update mirrors with
+     * vertex data changes
+     */
+    typedef fiber_buffered_exchange<vid_vdelta_pair_type> delta_exchange_type;
+
+    /**
+     * \brief The distributed express used to update mirrors with
+     * vertex data changes when track_changes is set.
+     */
+    delta_exchange_type delta_exchange;
+
 
     /**
      * \brief The pair type used to synchronize the results of the gather phase
@@ -753,6 +900,15 @@ namespace graphlab {
      */
     int iteration() const;
 
+    /**
+     * \brief Get the time the threads of this machine waited for the
+     * slowest thread at the end of the gather, apply and scatter
+     * phases, summed over the super-steps since start was last invoked.
+     *
+     * \return the barrier tail latency in seconds
+     */
+    double get_barrier_tail_time() const { return barrier_tail_time; }
+
 
     /**
      * \brief Compute the total memory used by the entire distributed
@@ -908,6 +1064,14 @@ namespace graphlab {
     inline bool low_master_lvid(const lvid_type lvid);
     inline bool high_mirror_lvid(const lvid_type lvid);  
     inline bool low_mirror_lvid(const lvid_type lvid);
+
+    /**
+     * \brief Chooses whether the next super-step pushes.
+     *
+     * Makes has_message sparse if it fits in its queue, then compares
+     * the number of local edges of the frontier with push_threshold.
+     */
+    bool choose_push_superstep();
     
     // /**
     //  * \brief Initialize all vertex programs by invoking
@@ -947,6 +1111,26 @@ namespace graphlab {
      */
     void execute_gathers(size_t thread_id);
 
+    /**
+     * \brief Returns the number of local edges the gather of the local
+     * vertex visits in the direction gather_dir.
+     */
+    size_t num_gather_edges(local_vertex_type& local_vertex,
+                            edge_dir_type gather_dir) const;
+
+    /**
+     * \brief Gathers the edges of the part and adds them to its split
+     * gather. The last part of a vertex completes its gather.
+     */
+    void run_gather_part(context_type& context, const gather_part& part,
+                         size_t thread_id);
+
+    /**
+     * \brief Adds the time between the first and the last thread
+     * finishing the phase to barrier_tail_time.
+     */
+    void record_barrier_tail();
+
 
 
 
@@ -1021,6 +1205,26 @@ namespace graphlab {
      */
     void recv_updates();
 
+    /**
+     * \brief Send the change of the vertex data made by the last apply
+     * to the mirrors of the local vertex id, if there is one.
+     *
+     * @param [in] lvid the vertex to sync.  It must be the master of that vertex.
+     * @param [in] old_data the vertex data before the apply.
+     * @param [in] delta_arc an in-memory archive reused across calls.
+     */
+    void send_delta(lvid_type lvid, const vertex_data_type& old_data,
+                    oarchive& delta_arc, size_t thread_id);
+
+    /**
+     * \brief patch local mirrors with the vertex data changes.
+     *
+     * This function returns when there is nothing left in the
+     * buffered exchange and should be called after the buffered
+     * exchange has been flushed
+     */
+    void recv_deltas();
+
     /**
      * \brief Send the gather accum for the vertex id to its master.
      *
@@ -1112,16 +1316,23 @@ namespace graphlab {
     threads(2*1024*1024 /* 2MB stack per fiber*/),
     thread_barrier(opts.get_ncpus()),
     max_iterations(-1), snapshot_interval(-1), iteration_counter(0),
-    print_interval(5), timeout(0), sched_allv(false),
+    print_interval(5), timeout(0), sched_allv(false), track_changes(false),
+    direction("auto"), push_threshold(0.05), gather_split_edges(4096),
+    push_superstep(false), num_push_supersteps(0), gather_part_edges(0),
+    barrier_tail_time(0),
     activ_exchange(dc),
     update_activ_exchange(dc),
     update_exchange(dc),
+    delta_exchange(dc),
     accum_exchange(dc),
     message_exchange(dc),
     aggregator(dc, graph, new context_type(*this, graph)) {
     // Process any additional options
     std::vector<std::string> keys = opts.get_engine_args().get_option_keys();
     per_thread_compute_time.resize(opts.get_ncpus());
+    per_thread_vdata_stats.resize(opts.get_ncpus());
+    per_thread_finish_time.resize(opts.get_ncpus());
+    gather_parts.resize(opts.get_ncpus());
     use_cache = false;
     foreach(std::string opt, keys) {
       if (opt == "max_iterations") {
@@ -1154,6 +1365,38 @@ namespace graphlab {
         if (rmi.procid() == 0)
           logstream(LOG_EMPH) << "Engine Option: sched_allv = "
             << sched_allv << std::endl;
+      } else if (opt == "track_changes") {
+        opts.get_engine_args().get_option("track_changes", track_changes);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: track_changes = "
+            << track_changes << std::endl;
+      } else if (opt == "direction") {
+        opts.get_engine_args().get_option("direction", direction);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: direction = "
+            << direction << std::endl;
+      } else if (opt == "push_threshold") {
+        opts.get_engine_args().get_option("push_threshold", push_threshold);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: push_threshold = "
+            << push_threshold << std::endl;
+      } else if (opt == "gather_split_edges") {
+        opts.get_engine_args().get_option("gather_split_edges", gather_split_edges);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: gather_split_edges = "
+            << gather_split_edges << std::endl;
+      } else if (opt == "compress_exchanges") {
+        bool compress_exchanges = false;
+        opts.get_engine_args().get_option("compress_exchanges", compress_exchanges);
+        activ_exchange.set_compression(compress_exchanges);
+        update_activ_exchange.set_compression(compress_exchanges);
+        update_exchange.set_compression(compress_exchanges);
+        delta_exchange.set_compression(compress_exchanges);
+        accum_exchange.set_compression(compress_exchanges);
+        message_exchange.set_compression(compress_exchanges);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: compress_exchanges = "
+            << compress_exchanges << std::endl;
       } else {
         logstream(LOG_FATAL) << "Unexpected Engine Option: " << opt << std::endl;
       }
@@ -1163,6 +1406,11 @@ namespace graphlab {
       logstream(LOG_FATAL)
         << "Snapshot interval specified, but no snapshot path" << std::endl;
     }
+    if (direction != "pull" && direction != "push" && direction != "auto") {
+      logstream(LOG_FATAL)
+        << "Unknown direction " << direction
+        << ", expected pull, push or auto" << std::endl;
+    }
     INITIALIZE_EVENT_LOG(dc);
     ADD_CUMULATIVE_EVENT(EVENT_APPLIES, "Applies", "Calls");
     ADD_CUMULATIVE_EVENT(EVENT_GATHERS , "Gathers", "Calls");
@@ -1197,6 +1445,7 @@ namespace graphlab {
     has_cache.clear();
     active_superstep.clear();
     active_minorstep.clear();
+    push_superstep = false;
 
     memory_info::log_usage("After Engine Initialization");
   }
@@ -1205,6 +1454,14 @@ namespace graphlab {
   template<typename VertexProgram>
   void powerlyra_sync_engine<VertexProgram>:: resize() {
     size_t l_nverts = graph.num_local_vertices();
+    // The frontiers only queue the vertices of the frontiers small
+    // enough to be pushed
+    size_t queue_capacity = 0;
+    if (direction == "push") {
+      queue_capacity = l_nverts;
+    } else if (direction == "auto") {
+      queue_capacity = std::min(l_nverts, size_t(push_threshold * l_nverts) + 1);
+    }
 
     // Allocate vertex locks and vertex programs
     vlocks.resize(l_nverts);
@@ -1212,11 +1469,11 @@ namespace graphlab {
     
     // Allocate messages and message bitset
     messages.resize(l_nverts, message_type());
-    has_message.resize(l_nverts);
+    has_message.resize(l_nverts, queue_capacity);
     
     // Allocate gather accumulators and accumulator bitset
     gather_accum.resize(l_nverts, gather_type());
-    has_gather_accum.resize(l_nverts);
+    has_gather_accum.resize(l_nverts, queue_capacity);
 
     // If caching is used then allocate cache data-structures
     if (use_cache) {
@@ -1224,8 +1481,8 @@ namespace graphlab {
       has_cache.resize(l_nverts);
     }
     // Allocate bitset to track active vertices on each bitset.
-    active_superstep.resize(l_nverts);
-    active_minorstep.resize(l_nverts);
+    active_superstep.resize(l_nverts, queue_capacity);
+    active_minorstep.resize(l_nverts, queue_capacity);
   }
 
 
@@ -1402,6 +1659,8 @@ namespace graphlab {
     completed_gathers = 0;
     completed_applys = 0;
     completed_scatters = 0;
+    total_vdata_stats = vdata_sync_stats();
+    barrier_tail_time = 0;
     rmi.barrier();
 
     // Initialization code ==================================================
@@ -1414,6 +1673,8 @@ namespace graphlab {
     graphlab::timer ti, bk_ti;
 #endif
     iteration_counter = 0;
+    push_superstep = false;
+    num_push_supersteps = 0;
     force_abort = false;
     execution_status::status_enum termination_reason = execution_status::UNSET;
     aggregator.start();
@@ -1449,6 +1710,14 @@ namespace graphlab {
           << std::endl;
         last_print = elapsed_seconds();
       }
+      // Choose the direction ---------------------------------------------
+      // Push if the frontier is small, that is follow the queues of
+      // the sparse frontiers rather than sweep their bitsets
+      push_superstep = choose_push_superstep();
+      if (rmi.procid() == 0 && print_this_round)
+        logstream(LOG_DEBUG)
+          << "\tDirection: " << (push_superstep ? "push" : "pull") << std::endl;
+
       // Reset Active vertices ----------------------------------------------
       // Clear the active super-step and minor-step bits which will
       // be set upon receiving messages
@@ -1466,6 +1735,7 @@ namespace graphlab {
 #ifdef TUNING
       bk_ti.start();
 #endif
+      has_message.begin_sweep(push_superstep);
       run_synchronous( &powerlyra_sync_engine::exchange_messages );
 #ifdef TUNING
       exch_time += bk_ti.current_time();
@@ -1488,6 +1758,7 @@ namespace graphlab {
 #ifdef TUNING
       bk_ti.start();
 #endif
+      has_message.begin_sweep(push_superstep);
       run_synchronous( &powerlyra_sync_engine::receive_messages );
       if (sched_allv) active_minorstep.fill();
       has_message.clear();
@@ -1530,7 +1801,12 @@ namespace graphlab {
 #ifdef TUNING
       bk_ti.start();
 #endif
+      active_minorstep.begin_sweep(push_superstep);
+      gather_work = 0;
+      gather_part_edges = 0;
+      phase_timer.start();
       run_synchronous( &powerlyra_sync_engine::execute_gathers );
+      record_barrier_tail();
       // Clear the minor step bit since only super-step vertices
       // (only master vertices are required to participate in the
       // apply step)
@@ -1555,10 +1831,28 @@ namespace graphlab {
 #ifdef TUNING
       bk_ti.start();
 #endif
+      active_superstep.begin_sweep(push_superstep);
+      phase_timer.start();
       run_synchronous( &powerlyra_sync_engine::execute_applys );
+      record_barrier_tail();
 #ifdef TUNING
       apply_time += bk_ti.current_time();
 #endif
+      if (track_changes) {
+        vdata_sync_stats vdata_stats;
+        for (size_t i = 0; i < per_thread_vdata_stats.size(); ++i) {
+          vdata_stats += per_thread_vdata_stats[i];
+          per_thread_vdata_stats[i] = vdata_sync_stats();
+        }
+        rmi.all_reduce(vdata_stats);
+        total_vdata_stats += vdata_stats;
+        if (rmi.procid() == 0)
+          logstream(LOG_INFO)
+            << "\tVertex data sync: " << vdata_stats.sent_bytes << " of "
+            << vdata_stats.full_bytes << " bytes sent, "
+            << vdata_stats.suppressed << " unchanged updates suppressed"
+            << std::endl;
+      }
       /**
        * Post conditions:
        *   1) any changes to the vertex data have been synchronized
@@ -1578,7 +1872,10 @@ namespace graphlab {
 #ifdef TUNING
       bk_ti.start();
 #endif
+      active_minorstep.begin_sweep(push_superstep);
+      phase_timer.start();
       run_synchronous( &powerlyra_sync_engine::execute_scatters );
+      record_barrier_tail();
 #ifdef TUNING
       scatter_time += bk_ti.current_time();
 #endif
@@ -1591,6 +1888,7 @@ namespace graphlab {
       // probe the aggregator
       aggregator.tick_synchronous();
 
+      if (push_superstep) ++num_push_supersteps;
       ++iteration_counter;
 
       if (snapshot_interval > 0 && iteration_counter % snapshot_interval == 0) {
@@ -1604,6 +1902,17 @@ namespace graphlab {
     if (rmi.procid() == 0) {
       logstream(LOG_EMPH) << iteration_counter
                           << " iterations completed." << std::endl;
+      logstream(LOG_EMPH) << "Barrier tail latency: " << barrier_tail_time
+                          << " s on machine 0" << std::endl;
+      if (direction != "pull")
+        logstream(LOG_EMPH)
+          << num_push_supersteps << " super-steps pushed on machine 0"
+          << std::endl;
+      if (track_changes)
+        logstream(LOG_EMPH)
+          << "Vertex data sync saved "
+          << total_vdata_stats.full_bytes - total_vdata_stats.sent_bytes
+          << " of " << total_vdata_stats.full_bytes << " bytes" << std::endl;
     }
     // Final barrier to ensure that all engines terminate at the same time
     double total_compute_time = 0;
@@ -1658,6 +1967,12 @@ namespace graphlab {
                           << std::endl;
 #endif
     }
+    activ_exchange.get_compression().report("activ_exchange");
+    update_activ_exchange.get_compression().report("update_activ_exchange");
+    update_exchange.get_compression().report("update_exchange");
+    delta_exchange.get_compression().report("delta_exchange");
+    accum_exchange.get_compression().report("accum_exchange");
+    message_exchange.get_compression().report("message_exchange");
 
     rmi.full_barrier();
     // Stop the aggregator
@@ -1690,28 +2005,30 @@ namespace graphlab {
     return graph.l_degree_type(lvid) == graph_type::LOW_MIRROR;
   }
 
+  template<typename VertexProgram>
+  bool powerlyra_sync_engine<VertexProgram>::choose_push_superstep() {
+    if (direction == "pull" || sched_allv) return false;
+    if (!has_message.make_sparse()) return false;
+    if (direction == "push") return true;
+    size_t frontier_edges = 0;
+    for (size_t i = 0; i < has_message.num_queued(); ++i) {
+      const lvid_type lvid = has_message.queued(i);
+      frontier_edges += graph.l_num_in_edges(lvid) + graph.l_num_out_edges(lvid);
+    }
+    return frontier_edges <= push_threshold * graph.num_local_edges();
+  } // end of choose_push_superstep
+
+
   template<typename VertexProgram>
   void powerlyra_sync_engine<VertexProgram>::
   exchange_messages(const size_t thread_id) {
     context_type context(*this, graph);
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset; // a word-size = 64 bit
     const size_t TRY_RECV_MOD = 100;
     size_t vcount = 1; // avoid unnecessarily call recv_messages() 
     
-    while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = has_message.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+    std::vector<lvid_type> lvid_block;
+    while (has_message.next_block(shared_lvid_counter, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
 
         // [TARGET]: High/Low-degree Mirrors
         if(!graph.l_is_master(lvid)) {        
@@ -1737,25 +2054,13 @@ namespace graphlab {
   void powerlyra_sync_engine<VertexProgram>::
   receive_messages(const size_t thread_id) {
     context_type context(*this, graph);
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset; // a word-size = 64 bit
     const size_t TRY_RECV_MOD = 100;
     size_t vcount = 0;
     size_t nactive_inc = 0;
     
-    while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = has_message.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+    std::vector<lvid_type> lvid_block;
+    while (has_message.next_block(shared_lvid_counter, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
 
         ASSERT_TRUE(graph.l_is_master(lvid));
         // The vertex becomes active for this superstep
@@ -1800,26 +2105,37 @@ namespace graphlab {
   execute_gathers(const size_t thread_id) {
     context_type context(*this, graph);
     const bool caching_enabled = !gather_cache.empty();
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset; // a word-size = 64 bit    
     const size_t TRY_RECV_MOD = 1000;
     size_t vcount = 0;
     size_t ngather_inc = 0;
     timer ti;
     
-    while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = active_minorstep.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+    std::vector<lvid_type> lvid_block;
+    if (gather_split_edges > 0 && ncpus > 1) {
+      // estimate the gather work of the super-step to size the parts
+      size_t work = 0;
+      while (active_minorstep.next_block(shared_lvid_counter, lvid_block)) {
+        foreach(lvid_type lvid, lvid_block) {
+          if (caching_enabled && has_cache.get(lvid)) continue;
+          local_vertex_type local_vertex = graph.l_vertex(lvid);
+          const vertex_type vertex(local_vertex);
+          work += num_gather_edges(local_vertex,
+                      vertex_programs[lvid].gather_edges(context, vertex));
+        }
+      }
+      gather_work += work;
+      thread_barrier.wait();
+      if (thread_id == 0) {
+        shared_lvid_counter = 0;
+        gather_part_edges = gather_parts.part_edges(gather_work.value,
+                                                    gather_split_edges);
+      }
+      thread_barrier.wait();
+    }
+
+    gather_part part;
+    while (active_minorstep.next_block(shared_lvid_counter, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
 
         // [TARGET]: High/Low-degree Masters, and High/Low-degree Mirrors
         bool accum_is_set = false;
@@ -1835,6 +2151,21 @@ namespace graphlab {
           local_vertex_type local_vertex = graph.l_vertex(lvid);
           const vertex_type vertex(local_vertex);
           const edge_dir_type gather_dir = vprog.gather_edges(context, vertex);
+          if (gather_part_edges > 0 &&
+              num_gather_edges(local_vertex, gather_dir) > gather_part_edges) {
+            // leave the parts at the front of the queue to the thieves
+            const bool gather_in = (gather_dir == IN_EDGES || gather_dir == ALL_EDGES);
+            const bool gather_out = (gather_dir == OUT_EDGES || gather_dir == ALL_EDGES);
+            vprog.pre_local_gather(accum);
+            gather_parts.split(thread_id, lvid,
+                               gather_in ? local_vertex.num_in_edges() : 0,
+                               gather_out ? local_vertex.num_out_edges() : 0,
+                               gather_part_edges, accum);
+            while (gather_parts.next(thread_id, false, part)) {
+              run_gather_part(context, part, thread_id);
+            }
+            continue;
+          }
           
           size_t edges_touched = 0;
           vprog.pre_local_gather(accum);
@@ -1892,8 +2223,18 @@ namespace graphlab {
         if(++vcount % TRY_RECV_MOD == 0) recv_accums();
       }
     } // end of loop over vertices to compute gather accumulators
+    // steal the parts of the split gathers still queued
+    while (gather_parts.num_pending() > 0) {
+      if (gather_parts.next(thread_id, true, part)) {
+        run_gather_part(context, part, thread_id);
+      } else {
+        fiber_control::yield();
+      }
+      if(++vcount % TRY_RECV_MOD == 0) recv_accums();
+    }
     completed_gathers += ngather_inc;
     per_thread_compute_time[thread_id] += ti.current_time();
+    per_thread_finish_time[thread_id] = phase_timer.current_time();
     accum_exchange.partial_flush();
     // Finish sending and receiving all gather operations
     thread_barrier.wait();
@@ -1903,30 +2244,88 @@ namespace graphlab {
   } // end of execute_gathers
 
 
+  template<typename VertexProgram>
+  size_t powerlyra_sync_engine<VertexProgram>::
+  num_gather_edges(local_vertex_type& local_vertex,
+                   edge_dir_type gather_dir) const {
+    size_t nedges = 0;
+    if (gather_dir == IN_EDGES || gather_dir == ALL_EDGES)
+      nedges += local_vertex.num_in_edges();
+    if (gather_dir == OUT_EDGES || gather_dir == ALL_EDGES)
+      nedges += local_vertex.num_out_edges();
+    return nedges;
+  } // end of num_gather_edges
+
+
+  template<typename VertexProgram>
+  void powerlyra_sync_engine<VertexProgram>::
+  run_gather_part(context_type& context, const gather_part& part,
+                  const size_t thread_id) {
+    typedef typename graph_type::local_edge_list_type local_edge_list_type;
+    const lvid_type lvid = part.lvid;
+    const vertex_program_type& vprog = vertex_programs[lvid];
+    local_vertex_type local_vertex = graph.l_vertex(lvid);
+    const vertex_type vertex(local_vertex);
+    const local_edge_list_type edges = part.in_edges ?
+      local_vertex.in_edges() : local_vertex.out_edges();
+    bool accum_is_set = false;
+    gather_type accum = gather_type();
+    typename local_edge_list_type::iterator it = edges.begin() + part.begin;
+    for (size_t i = part.begin; i < part.end; ++i, ++it) {
+      edge_type edge(*it);
+      if(accum_is_set) {
+        accum += vprog.gather(context, vertex, edge);
+      } else {
+        accum = vprog.gather(context, vertex, edge);
+        accum_is_set = true;
+      }
+    }
+    INCREMENT_EVENT(EVENT_GATHERS, part.end - part.begin);
+
+    if (gather_parts.combine(part, accum, accum_is_set)) {
+      // the same as the end of an unsplit gather in execute_gathers
+      typename gather_part_queues_type::split_gather& gather = *part.gather;
+      vprog.post_local_gather(gather.accum);
+      if (!gather_cache.empty() && gather.accum_is_set) {
+        gather_cache[lvid] = gather.accum; has_cache.set_bit(lvid);
+      }
+      if (gather.accum_is_set) send_accum(lvid, gather.accum, thread_id);
+      if (!graph.l_is_master(lvid)) {
+        vertex_programs[lvid] = vertex_program_type();
+      }
+      ++completed_gathers;
+      delete part.gather;
+    }
+    gather_parts.part_done();
+  } // end of run_gather_part
+
+
+  template<typename VertexProgram>
+  void powerlyra_sync_engine<VertexProgram>::record_barrier_tail() {
+    barrier_tail_time +=
+      *std::max_element(per_thread_finish_time.begin(),
+                        per_thread_finish_time.end()) -
+      *std::min_element(per_thread_finish_time.begin(),
+                        per_thread_finish_time.end());
+  } // end of record_barrier_tail
+
+
   template<typename VertexProgram>
   void powerlyra_sync_engine<VertexProgram>::
   execute_applys(const size_t thread_id) {
     context_type context(*this, graph);
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset;  // allocate a word size = 64bits
     const size_t TRY_RECV_MOD = 1000;
     size_t vcount = 0;
     size_t napply_inc = 0;
     timer ti;
+    // with track_changes, the vertex data before the apply and the
+    // buffer its delta is encoded in
+    vertex_data_type old_vdata;
+    oarchive delta_arc;
     
-    while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = active_superstep.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+    std::vector<lvid_type> lvid_block;
+    while (active_superstep.next_block(shared_lvid_counter, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
 
         // [TARGET]: High/Low-degree Masters
         // Only master vertices can be active in a super-step
@@ -1936,6 +2335,9 @@ namespace graphlab {
         // the gather_accum was not set during the gather.
         const gather_type& accum = gather_accum[lvid];
         INCREMENT_EVENT(EVENT_APPLIES, 1);
+        const bool track = track_changes &&
+          graph.l_vertex(lvid).num_mirrors() > 0;
+        if (track) old_vdata = vertex.data();
         vertex_programs[lvid].apply(context, vertex, accum);
         // record an apply as a completed task
         ++napply_inc;
@@ -1947,30 +2349,45 @@ namespace graphlab {
         
         if (const_vprog.scatter_edges(context, const_vertex) 
             != graphlab::NO_EDGES) {
-          // send Ax1 and Sx1
-          send_updates_activs(lvid, thread_id);
+          if (track) {
+            // send the delta of A and Sx1 separately
+            send_delta(lvid, old_vdata, delta_arc, thread_id);
+            send_activs(lvid, thread_id);
+          } else {
+            // send Ax1 and Sx1
+            send_updates_activs(lvid, thread_id);
+          }
           active_minorstep.set_bit(lvid);
         } else {
           // send Ax1
-          send_updates(lvid, thread_id);
+          if (track) send_delta(lvid, old_vdata, delta_arc, thread_id);
+          else send_updates(lvid, thread_id);
           vertex_programs[lvid] = vertex_program_type();
         }
 
         if(++vcount % TRY_RECV_MOD == 0) {
           recv_updates_activs(); recv_updates();
+          if (track_changes) { recv_activs(); recv_deltas(); }
         }
       }
     } // end of loop over vertices to run apply
+    free(delta_arc.buf);
     completed_applys += napply_inc;
     per_thread_compute_time[thread_id] += ti.current_time();
+    per_thread_finish_time[thread_id] = phase_timer.current_time();
     update_activ_exchange.partial_flush(); update_exchange.partial_flush();
+    if (track_changes) {
+      activ_exchange.partial_flush(); delta_exchange.partial_flush();
+    }
     thread_barrier.wait();
     // Flush the buffer and finish receiving any remaining updates.
     if(thread_id == 0) {
       update_activ_exchange.flush(); update_exchange.flush();
+      if (track_changes) { activ_exchange.flush(); delta_exchange.flush(); }
     }
     thread_barrier.wait();
     recv_updates_activs(); recv_updates();
+    if (track_changes) { recv_activs(); recv_deltas(); }
     
   } // end of execute_applys
 
@@ -1979,24 +2396,12 @@ namespace graphlab {
   void powerlyra_sync_engine<VertexProgram>::
   execute_scatters(const size_t thread_id) {
     context_type context(*this, graph);
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset; // allocate a word size = 64 bits
     size_t nscatter_inc = 0;
     timer ti;
     
-    while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = active_minorstep.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+    std::vector<lvid_type> lvid_block;
+    while (active_minorstep.next_block(shared_lvid_counter, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
 
         // [TARGET]: High/Low-degree Masters, and High/Low-degree Mirrors
         const vertex_program_type& vprog = vertex_programs[lvid];
@@ -2033,6 +2438,7 @@ namespace graphlab {
     } // end of loop over vertices to complete scatter operation
     completed_scatters += nscatter_inc;
     per_thread_compute_time[thread_id] += ti.current_time();
+    per_thread_finish_time[thread_id] = phase_timer.current_time();
   } // end of execute_scatters
 
 
@@ -2126,6 +2532,49 @@ namespace graphlab {
     }
   } // end of recv_updates
 
+  template<typename VertexProgram>
+  inline void powerlyra_sync_engine<VertexProgram>::
+  send_delta(lvid_type lvid, const vertex_data_type& old_data,
+             oarchive& delta_arc, const size_t thread_id) {
+    ASSERT_TRUE(graph.l_is_master(lvid));
+    const vertex_id_type vid = graph.global_vid(lvid);
+    local_vertex_type vertex = graph.l_vertex(lvid);
+    const size_t nmirrors = vertex.num_mirrors();
+    vdata_sync_stats& stats = per_thread_vdata_stats[thread_id];
+    // the full update, which the diff keeps or replaces by a delta
+    delta_arc.off = 0;
+    delta_arc << vertex.data();
+    stats.full_bytes += nmirrors * delta_arc.off;
+    if (!vertex_programs[lvid].diff_vertex_data(old_data, vertex.data(),
+                                                delta_arc)) {
+      stats.suppressed += nmirrors;
+      return;
+    }
+    stats.sent_bytes += nmirrors * delta_arc.off;
+    const std::string delta(delta_arc.buf, delta_arc.off);
+    foreach(const procid_t& mirror, vertex.mirrors()) {
+      delta_exchange.send(mirror, std::make_pair(vid, delta));
+    }
+  } // end of send_delta
+
+  template<typename VertexProgram>
+  inline void powerlyra_sync_engine<VertexProgram>::
+  recv_deltas() {
+    const vertex_program_type patcher = vertex_program_type();
+    typename delta_exchange_type::recv_buffer_type recv_buffer;
+    while(delta_exchange.recv(recv_buffer)) {
+      for (size_t i = 0;i < recv_buffer.size(); ++i) {
+        typename delta_exchange_type::buffer_type& buffer = recv_buffer[i].buffer;
+        foreach(const vid_vdelta_pair_type& pair, buffer) {
+          const lvid_type lvid = graph.local_vid(pair.first);
+          ASSERT_FALSE(graph.l_is_master(lvid));
+          iarchive iarc(pair.second.data(), pair.second.size());
+          patcher.patch_vertex_data(graph.l_vertex(lvid).data(), iarc);
+        }
+      }
+    }
+  } // end of recv_deltas
+
   template<typename VertexProgram>
   inline void powerlyra_sync_engine<VertexProgram>::
   send_accum(lvid_type lvid, const gather_type& accum, const size_t thread_id) {
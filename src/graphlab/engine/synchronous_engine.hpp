@@ -35,6 +35,8 @@
 #include <graphlab/vertex_program/context.hpp>
 
 #include <graphlab/engine/execution_status.hpp>
+#include <graphlab/engine/hybrid_frontier.hpp>
+#include <graphlab/engine/gather_part_queues.hpp>
 #include <graphlab/options/graphlab_options.hpp>
 
 
@@ -189,6 +191,39 @@ namespace graphlab {
    * or update (\ref icontext::post_delta) the cache values of
    * neighboring vertices during the scatter phase.
    *
+   * \li <b>track_changes</b>: (default: false) When set, the vertex
+   * data is only sent to the mirrors if the apply changed it, and then
+   * only as the delta encoded by \ref ivertex_program::diff_vertex_data.
+   * The bytes saved are logged every iteration.
+   *
+   * \li <b>direction</b>: (default: auto) How a super-step finds its
+   * active vertices. \c pull sweeps the activity bitsets over all the
+   * local vertices. \c push follows the lvid queues which the
+   * frontiers keep while they are sparse (see \ref hybrid_frontier),
+   * so that a small frontier costs time proportional to its size.
+   * \c auto pushes while the frontier is small, see \c push_threshold.
+   *
+   * \li <b>push_threshold</b>: (default: 0.05) With direction=auto a
+   * super-step pushes if both the vertices of its frontier and their
+   * local edges are at most this fraction of the local vertices and
+   * edges.
+   *
+   * \li <b>gather_split_edges</b>: (default: 4096) Each super-step the
+   * gather work of the active vertices is estimated from their number
+   * of local edges in the gather direction. The gather of a vertex
+   * with more than max(gather_split_edges, work / (4 * ncpus)) local
+   * edges is split into parts of that many edges, which the threads
+   * done with their own vertices steal. The partial results are
+   * combined with the += of the gather_type, so the gather of such a
+   * vertex program may run on several threads at once. 0 disables the
+   * splitting.
+   *
+   * \li <b>compress_exchanges</b>: (default: false) When set, the send
+   * buffers of the exchanges between the masters and the mirrors are
+   * compressed with \ref lz_compress, trading CPU time for network
+   * bandwidth. The compression ratio and time of each exchange are
+   * logged at the end of start().
+   *
    * \li \b snapshot_interval If set to a positive value, a snapshot
    * is taken every this number of iterations. If set to 0, a snapshot
    * is taken before the first iteration. If set to a negative value,
@@ -402,6 +437,11 @@ namespace graphlab {
 
     double one_itr_time;
 
+    /**
+     * \brief The wall time of every super-step of the last start().
+     */
+    std::vector<double> superstep_times;
+
     double compute_balance;
 
     /**
@@ -439,6 +479,39 @@ namespace graphlab {
      */
     bool sched_allv;
 
+    /**
+     * \brief Only send the changes of the vertex data to the mirrors
+     */
+    bool track_changes;
+
+    /**
+     * \brief The direction option: "pull", "push" or "auto"
+     */
+    std::string direction;
+
+    /**
+     * \brief With direction "auto" a super-step pushes if its frontier
+     * holds at most this fraction of the local vertices and edges
+     */
+    double push_threshold;
+
+    /**
+     * \brief The smallest number of local edges of a gather part, or 0
+     * to never split a gather
+     */
+    size_t gather_split_edges;
+
+    /**
+     * \brief True if the current super-step follows the queues of the
+     * sparse frontiers rather than sweeping their bitsets.
+     */
+    bool push_superstep;
+
+    /**
+     * \brief The number of super-steps of the last start() which pushed
+     */
+    size_t num_push_supersteps;
+
     /**
      * \brief Used to stop the engine prematurely
      */
@@ -478,7 +551,7 @@ namespace graphlab {
     /**
      * \brief Bit indicating whether a message is present for each vertex.
      */
-    dense_bitset has_message;
+    hybrid_frontier has_message;
 
 
     /**
@@ -502,7 +575,7 @@ namespace graphlab {
      * set while holding the lock in
      * \ref graphlab::synchronous_engine::vlocks.
      */
-    dense_bitset has_gather_accum;
+    hybrid_frontier has_gather_accum;
 
 
     /**
@@ -524,7 +597,7 @@ namespace graphlab {
      * \brief A bit (for master vertices) indicating if that vertex is active
      * (received a message on this iteration).
      */
-    dense_bitset active_superstep;
+    hybrid_frontier active_superstep;
 
     /**
      * \brief  The number of local vertices (masters) that are active on this
@@ -536,13 +609,28 @@ namespace graphlab {
      * \brief A bit indicating (for all vertices) whether to
      * participate in the current minor-step (gather or scatter).
      */
-    dense_bitset active_minorstep;
+    hybrid_frontier active_minorstep;
 
     /**
      * \brief A counter measuring the number of gathers that have been completed
      */
     atomic<size_t> completed_gathers;
 
+    typedef gather_part_queues<gather_type> gather_part_queues_type;
+    typedef typename gather_part_queues_type::gather_part gather_part;
+
+    /// The parts of the gathers split in this super-step
+    gather_part_queues_type gather_parts;
+
+    /// The estimated number of local edges gathered in this super-step
+    atomic<size_t> gather_work;
+
+    /**
+     * \brief The number of edges of a gather part in this super-step,
+     * or 0 if the gathers are not split.
+     */
+    size_t gather_part_edges;
+
     /**
      * \brief A counter measuring the number of applys that have been completed
      */
@@ -553,6 +641,37 @@ namespace graphlab {
      */
     atomic<size_t> completed_scatters;
 
+    /**
+     * \brief Counts the mirror updates of the vertex data when
+     * track_changes is set. Every field is summed over the mirrors.
+     */
+    struct vdata_sync_stats : public IS_POD_TYPE {
+      /// bytes the new vertex data would have taken
+      size_t full_bytes;
+      /// bytes of the deltas sent instead
+      size_t sent_bytes;
+      /// updates not sent since the data did not change
+      size_t suppressed;
+      vdata_sync_stats() : full_bytes(0), sent_bytes(0), suppressed(0) { }
+      vdata_sync_stats& operator+=(const vdata_sync_stats& other) {
+        full_bytes += other.full_bytes;
+        sent_bytes += other.sent_bytes;
+        suppressed += other.suppressed;
+        return *this;
+      }
+    };
+
+    /**
+     * \brief The mirror update counts of each thread in the current
+     * iteration.
+     */
+    std::vector<vdata_sync_stats> per_thread_vdata_stats;
+
+    /**
+     * \brief The mirror update counts of all the machines since start.
+     */
+    vdata_sync_stats total_vdata_stats;
+
 
     /**
      * \brief The shared counter used coordinate operations between
@@ -593,6 +712,24 @@ namespace graphlab {
      */
     vdata_exchange_type vdata_exchange;
 
+    /**
+     * \brief The pair type used to send the encoded change of the
+     * vertex data when track_changes is set.
+     */
+    typedef std::pair<vertex_id_type, std::string> vid_vdelta_pair_type;
+
+    /**
+     * \brief The type of the exchange used to synchronize vertex data
+     * changes
+     */
+    typedef fiber_buffered_exchange<vid_vdelta_pair_type> vdelta_exchange_type;
+
+    /**
+     * \brief The distributed exchange used to synchronize changes to
+     * vertex data when track_changes is set.
+     */
+    vdelta_exchange_type vdelta_exchange;
+
     /**
      * \brief The pair type used to synchronize the results of the gather phase
      */
@@ -742,6 +879,10 @@ namespace graphlab {
 
     double get_one_itr_time() const { return one_itr_time; }
 
+    const std::vector<double>& get_superstep_times() const {
+      return superstep_times;
+    }
+
     double get_compute_balance() const { return compute_balance; }
 
 
@@ -867,6 +1008,14 @@ namespace graphlab {
       }
     } // end of run_synchronous
 
+    /**
+     * \brief Chooses whether the next super-step pushes.
+     *
+     * Makes has_message sparse if it fits in its queue, then compares
+     * the number of local edges of the frontier with push_threshold.
+     */
+    bool choose_push_superstep();
+
     // /**
     //  * \brief Initialize all vertex programs by invoking
     //  * \ref graphlab::ivertex_program::init on all vertices.
@@ -905,6 +1054,20 @@ namespace graphlab {
      */
     void execute_gathers(size_t thread_id);
 
+    /**
+     * \brief The number of local edges of a vertex in the gather
+     * direction.
+     */
+    size_t num_gather_edges(local_vertex_type& local_vertex,
+                            edge_dir_type gather_dir) const;
+
+    /**
+     * \brief Gathers the edges of the part and adds them to its split
+     * gather. The last part of a vertex completes its gather.
+     */
+    void run_gather_part(context_type& context, const gather_part& part,
+                         size_t thread_id);
+
 
 
 
@@ -966,6 +1129,24 @@ namespace graphlab {
      */
     void recv_vertex_data();
 
+    /**
+     * \brief Send the change of the vertex data made by the last apply
+     * to the mirrors of the local vertex id, if there is one.
+     *
+     * @param [in] lvid the vertex to sync.  This machine must be the master
+     * of that vertex.
+     * @param [in] old_data the vertex data before the apply.
+     * @param [in] delta_arc an in-memory archive reused across calls.
+     */
+    void sync_vertex_delta(lvid_type lvid, const vertex_data_type& old_data,
+                           oarchive& delta_arc, size_t thread_id);
+
+    /**
+     * \brief Receive all incoming vertex data changes and patch the
+     * local mirrors.
+     */
+    void recv_vertex_delta();
+
     /**
      * \brief Send the gather value for the vertex id to its master.
      *
@@ -1058,15 +1239,20 @@ namespace graphlab {
     threads(2*1024*1024 /* 2MB stack per fiber*/),
     thread_barrier(opts.get_ncpus()),
     max_iterations(-1), snapshot_interval(-1), iteration_counter(0),
-    timeout(0), sched_allv(false),
+    timeout(0), sched_allv(false), track_changes(false),
+    direction("auto"), push_threshold(0.05), gather_split_edges(4096),
+    push_superstep(false), num_push_supersteps(0), gather_part_edges(0),
     vprog_exchange(dc),
     vdata_exchange(dc),
+    vdelta_exchange(dc),
     gather_exchange(dc),
     message_exchange(dc),
     aggregator(dc, graph, new context_type(*this, graph)) {
     // Process any additional options
     std::vector<std::string> keys = opts.get_engine_args().get_option_keys();
     per_thread_compute_time.resize(opts.get_ncpus());
+    per_thread_vdata_stats.resize(opts.get_ncpus());
+    gather_parts.resize(opts.get_ncpus());
     use_cache = false;
     foreach(std::string opt, keys) {
       if (opt == "max_iterations") {
@@ -1099,6 +1285,37 @@ namespace graphlab {
         if (rmi.procid() == 0)
           logstream(LOG_EMPH) << "Engine Option: sched_allv = "
             << sched_allv << std::endl;
+      } else if (opt == "track_changes") {
+        opts.get_engine_args().get_option("track_changes", track_changes);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: track_changes = "
+            << track_changes << std::endl;
+      } else if (opt == "direction") {
+        opts.get_engine_args().get_option("direction", direction);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: direction = "
+            << direction << std::endl;
+      } else if (opt == "push_threshold") {
+        opts.get_engine_args().get_option("push_threshold", push_threshold);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: push_threshold = "
+            << push_threshold << std::endl;
+      } else if (opt == "gather_split_edges") {
+        opts.get_engine_args().get_option("gather_split_edges", gather_split_edges);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: gather_split_edges = "
+            << gather_split_edges << std::endl;
+      } else if (opt == "compress_exchanges") {
+        bool compress_exchanges = false;
+        opts.get_engine_args().get_option("compress_exchanges", compress_exchanges);
+        vprog_exchange.set_compression(compress_exchanges);
+        vdata_exchange.set_compression(compress_exchanges);
+        vdelta_exchange.set_compression(compress_exchanges);
+        gather_exchange.set_compression(compress_exchanges);
+        message_exchange.set_compression(compress_exchanges);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: compress_exchanges = "
+            << compress_exchanges << std::endl;
       } else {
         logstream(LOG_FATAL) << "Unexpected Engine Option: " << opt << std::endl;
       }
@@ -1108,6 +1325,11 @@ namespace graphlab {
       logstream(LOG_FATAL)
         << "Snapshot interval specified, but no snapshot path" << std::endl;
     }
+    if (direction != "pull" && direction != "push" && direction != "auto") {
+      logstream(LOG_FATAL)
+        << "Unknown direction " << direction
+        << ", expected pull, push or auto" << std::endl;
+    }
     INITIALIZE_EVENT_LOG(dc);
     ADD_CUMULATIVE_EVENT(EVENT_APPLIES, "Applies", "Calls");
     ADD_CUMULATIVE_EVENT(EVENT_GATHERS , "Gathers", "Calls");
@@ -1132,6 +1354,7 @@ namespace graphlab {
     has_cache.clear();
     active_superstep.clear();
     active_minorstep.clear();
+    push_superstep = false;
   }
 
 
@@ -1143,12 +1366,21 @@ namespace graphlab {
     vertex_programs.resize(graph.num_local_vertices());
     // allocate the edge locks
     //elocks.resize(graph.num_local_edges());
+    // The frontiers only queue the vertices of the frontiers small
+    // enough to be pushed
+    size_t queue_capacity = 0;
+    if (direction == "push") {
+      queue_capacity = graph.num_local_vertices();
+    } else if (direction == "auto") {
+      queue_capacity = std::min(graph.num_local_vertices(),
+          size_t(push_threshold * graph.num_local_vertices()) + 1);
+    }
     // Allocate messages and message bitset
     messages.resize(graph.num_local_vertices(), message_type());
-    has_message.resize(graph.num_local_vertices());
+    has_message.resize(graph.num_local_vertices(), queue_capacity);
     // Allocate gather accumulators and accumulator bitset
     gather_accum.resize(graph.num_local_vertices(), gather_type());
-    has_gather_accum.resize(graph.num_local_vertices());
+    has_gather_accum.resize(graph.num_local_vertices(), queue_capacity);
 
     // If caching is used then allocate cache data-structures
     if (use_cache) {
@@ -1156,8 +1388,9 @@ namespace graphlab {
       has_cache.resize(graph.num_local_vertices());
     }
     // Allocate bitset to track active vertices on each bitset.
-    active_superstep.resize(graph.num_local_vertices());
-    active_minorstep.resize(graph.num_local_vertices());
+    active_superstep.resize(graph.num_local_vertices(), queue_capacity);
+    active_minorstep.resize(graph.num_local_vertices(), queue_capacity);
+    push_superstep = false;
 
     // Print memory usage after initialization
     memory_info::log_usage("After Engine Initialization");
@@ -1336,6 +1569,10 @@ namespace graphlab {
       gather_time = apply_time = scatter_time = 0.0;
     graphlab::timer ti, bk_ti;
     iteration_counter = 0;
+    superstep_times.clear();
+    total_vdata_stats = vdata_sync_stats();
+    push_superstep = false;
+    num_push_supersteps = 0;
     force_abort = false;
     execution_status::status_enum termination_reason =
       execution_status::UNSET;
@@ -1366,6 +1603,7 @@ namespace graphlab {
       }
 
       bool print_this_round = (elapsed_seconds() - last_print) >= 5;
+      const double superstep_start = ti.current_time();
 
       if(rmi.procid() == 0 && print_this_round) {
         logstream(LOG_DEBUG)
@@ -1373,6 +1611,14 @@ namespace graphlab {
           << std::endl;
         last_print = elapsed_seconds();
       }
+      // Choose the direction ---------------------------------------------
+      // Push if the frontier is small, that is follow the queues of
+      // the sparse frontiers rather than sweep their bitsets
+      push_superstep = choose_push_superstep();
+      if (rmi.procid() == 0 && print_this_round)
+        logstream(LOG_DEBUG)
+          << "\tDirection: " << (push_superstep ? "push" : "pull") << std::endl;
+
       // Reset Active vertices ----------------------------------------------
       // Clear the active super-step and minor-step bits which will
       // be set upon receiving messages
@@ -1384,6 +1630,7 @@ namespace graphlab {
       // Exchange any messages in the local message vectors
       // if (rmi.procid() == 0) std::cout << "Exchange messages..." << std::endl;
       bk_ti.start();
+      has_message.begin_sweep(push_superstep);
       run_synchronous( &synchronous_engine::exchange_messages );
       exch_time += bk_ti.current_time();
       /**
@@ -1399,6 +1646,7 @@ namespace graphlab {
       // if (rmi.procid() == 0) std::cout << "Receive messages..." << std::endl;
       num_active_vertices = 0;
       bk_ti.start();
+      has_message.begin_sweep(push_superstep);
       run_synchronous( &synchronous_engine::receive_messages );
       if (sched_allv) {
         active_minorstep.fill();
@@ -1434,6 +1682,9 @@ namespace graphlab {
       // in this minor-step (active-minorstep bit set).
       // if (rmi.procid() == 0) std::cout << "Gathering..." << std::endl;
       bk_ti.start();
+      active_minorstep.begin_sweep(push_superstep);
+      gather_work = 0;
+      gather_part_edges = 0;
       run_synchronous( &synchronous_engine::execute_gathers );
       // Clear the minor step bit since only super-step vertices
       // (only master vertices are required to participate in the
@@ -1452,8 +1703,24 @@ namespace graphlab {
       // Run the apply function on all active vertices
       // if (rmi.procid() == 0) std::cout << "Applying..." << std::endl;
       bk_ti.start();
+      active_superstep.begin_sweep(push_superstep);
       run_synchronous( &synchronous_engine::execute_applys );
       apply_time += bk_ti.current_time();
+      if (track_changes) {
+        vdata_sync_stats vdata_stats;
+        for (size_t i = 0; i < per_thread_vdata_stats.size(); ++i) {
+          vdata_stats += per_thread_vdata_stats[i];
+          per_thread_vdata_stats[i] = vdata_sync_stats();
+        }
+        rmi.all_reduce(vdata_stats);
+        total_vdata_stats += vdata_stats;
+        if (rmi.procid() == 0)
+          logstream(LOG_INFO)
+            << "\tVertex data sync: " << vdata_stats.sent_bytes << " of "
+            << vdata_stats.full_bytes << " bytes sent, "
+            << vdata_stats.suppressed << " unchanged updates suppressed"
+            << std::endl;
+      }
       /**
        * Post conditions:
        *   1) any changes to the vertex data have been synchronized
@@ -1469,6 +1736,7 @@ namespace graphlab {
       // Execute Scatter Operations -----------------------------------------
       // Execute each of the scatters on all minor-step active vertices.
       bk_ti.start();
+      active_minorstep.begin_sweep(push_superstep);
       run_synchronous( &synchronous_engine::execute_scatters );
       scatter_time += bk_ti.current_time();
       /**
@@ -1482,6 +1750,8 @@ namespace graphlab {
 
       if(iteration_counter == 0)
         one_itr_time = ti.current_time();
+      superstep_times.push_back(ti.current_time() - superstep_start);
+      if (push_superstep) ++num_push_supersteps;
       ++iteration_counter;
 
       if (snapshot_interval > 0 && iteration_counter % snapshot_interval == 0) {
@@ -1493,6 +1763,15 @@ namespace graphlab {
     if (rmi.procid() == 0) {
       logstream(LOG_EMPH) << iteration_counter
                         << " iterations completed." << std::endl;
+      if (direction != "pull")
+        logstream(LOG_EMPH)
+          << num_push_supersteps << " super-steps pushed on machine 0"
+          << std::endl;
+      if (track_changes)
+        logstream(LOG_EMPH)
+          << "Vertex data sync saved "
+          << total_vdata_stats.full_bytes - total_vdata_stats.sent_bytes
+          << " of " << total_vdata_stats.full_bytes << " bytes" << std::endl;
     }
     // Final barrier to ensure that all engines terminate at the same time
     double total_compute_time = 0;
@@ -1552,6 +1831,11 @@ namespace graphlab {
                           << std::endl;
 #endif
     }
+    vprog_exchange.get_compression().report("vprog_exchange");
+    vdata_exchange.get_compression().report("vdata_exchange");
+    vdelta_exchange.get_compression().report("vdelta_exchange");
+    gather_exchange.get_compression().report("gather_exchange");
+    message_exchange.get_compression().report("message_exchange");
     rmi.full_barrier();
     // Stop the aggregator
     aggregator.stop();
@@ -1561,27 +1845,29 @@ namespace graphlab {
 
 
 
+  template<typename VertexProgram>
+  bool synchronous_engine<VertexProgram>::choose_push_superstep() {
+    if (direction == "pull" || sched_allv) return false;
+    if (!has_message.make_sparse()) return false;
+    if (direction == "push") return true;
+    size_t frontier_edges = 0;
+    for (size_t i = 0; i < has_message.num_queued(); ++i) {
+      const lvid_type lvid = has_message.queued(i);
+      frontier_edges += graph.l_num_in_edges(lvid) + graph.l_num_out_edges(lvid);
+    }
+    return frontier_edges <= push_threshold * graph.num_local_edges();
+  } // end of choose_push_superstep
+
+
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>::
   exchange_messages(const size_t thread_id) {
     context_type context(*this, graph);
     const size_t TRY_RECV_MOD = 100;
     size_t vcount = 0;
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset; // a word-size = 64 bit
-    while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = has_message.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+    std::vector<lvid_type> lvid_block;
+    while (has_message.next_block(shared_lvid_counter, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
         // if the vertex is not local and has a message send the
         // message and clear the bit
         if(!graph.l_is_master(lvid)) {
@@ -1610,23 +1896,10 @@ namespace graphlab {
     const size_t TRY_RECV_MOD = 100;
     size_t vcount = 0;
     size_t nactive_inc = 0;
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset; // a word-size = 64 bit
-
-    while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = has_message.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+
+    std::vector<lvid_type> lvid_block;
+    while (has_message.next_block(shared_lvid_counter, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
 
         // if this is the master of lvid and we have a message
         if(graph.l_is_master(lvid)) {
@@ -1677,23 +1950,33 @@ namespace graphlab {
     size_t ngather_inc = 0;
     timer ti;
 
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset; // a word-size = 64 bit
 
-    while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = active_minorstep.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
+    std::vector<lvid_type> lvid_block;
+    if (gather_split_edges > 0 && ncpus > 1) {
+      // estimate the gather work of the super-step to size the parts
+      size_t work = 0;
+      while (active_minorstep.next_block(shared_lvid_counter, lvid_block)) {
+        foreach(lvid_type lvid, lvid_block) {
+          if (caching_enabled && has_cache.get(lvid)) continue;
+          local_vertex_type local_vertex = graph.l_vertex(lvid);
+          const vertex_type vertex(local_vertex);
+          work += num_gather_edges(local_vertex,
+                      vertex_programs[lvid].gather_edges(context, vertex));
+        }
+      }
+      gather_work += work;
+      thread_barrier.wait();
+      if (thread_id == 0) {
+        shared_lvid_counter = 0;
+        gather_part_edges = gather_parts.part_edges(gather_work.value,
+                                                    gather_split_edges);
+      }
+      thread_barrier.wait();
+    }
 
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+    gather_part part;
+    while (active_minorstep.next_block(shared_lvid_counter, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
 
         bool accum_is_set = false;
         gather_type accum = gather_type();
@@ -1708,6 +1991,21 @@ namespace graphlab {
           local_vertex_type local_vertex = graph.l_vertex(lvid);
           const vertex_type vertex(local_vertex);
           const edge_dir_type gather_dir = vprog.gather_edges(context, vertex);
+          if (gather_part_edges > 0 &&
+              num_gather_edges(local_vertex, gather_dir) > gather_part_edges) {
+            // leave the parts at the front of the queue to the thieves
+            const bool gather_in = (gather_dir == IN_EDGES || gather_dir == ALL_EDGES);
+            const bool gather_out = (gather_dir == OUT_EDGES || gather_dir == ALL_EDGES);
+            vprog.pre_local_gather(accum);
+            gather_parts.split(thread_id, lvid,
+                               gather_in ? local_vertex.num_in_edges() : 0,
+                               gather_out ? local_vertex.num_out_edges() : 0,
+                               gather_part_edges, accum);
+            while (gather_parts.next(thread_id, false, part)) {
+              run_gather_part(context, part, thread_id);
+            }
+            continue;
+          }
           // Loop over in edges
           size_t edges_touched = 0;
           vprog.pre_local_gather(accum);
@@ -1762,7 +2060,16 @@ namespace graphlab {
         // try to recv gathers if there are any in the buffer
         if(++vcount % TRY_RECV_MOD == 0) recv_gathers();
       }
-    } // end of loop over vertices to compute gather accumulators    
+    } // end of loop over vertices to compute gather accumulators
+    // steal the parts of the split gathers still queued
+    while (gather_parts.num_pending() > 0) {
+      if (gather_parts.next(thread_id, true, part)) {
+        run_gather_part(context, part, thread_id);
+      } else {
+        fiber_control::yield();
+      }
+      if(++vcount % TRY_RECV_MOD == 0) recv_gathers();
+    }
     completed_gathers += ngather_inc;
     per_thread_compute_time[thread_id] += ti.current_time();
     gather_exchange.partial_flush();
@@ -1774,6 +2081,62 @@ namespace graphlab {
   } // end of execute_gathers
 
 
+  template<typename VertexProgram>
+  size_t synchronous_engine<VertexProgram>::
+  num_gather_edges(local_vertex_type& local_vertex,
+                   edge_dir_type gather_dir) const {
+    size_t nedges = 0;
+    if (gather_dir == IN_EDGES || gather_dir == ALL_EDGES)
+      nedges += local_vertex.num_in_edges();
+    if (gather_dir == OUT_EDGES || gather_dir == ALL_EDGES)
+      nedges += local_vertex.num_out_edges();
+    return nedges;
+  } // end of num_gather_edges
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  run_gather_part(context_type& context, const gather_part& part,
+                  const size_t thread_id) {
+    typedef typename graph_type::local_edge_list_type local_edge_list_type;
+    const lvid_type lvid = part.lvid;
+    const vertex_program_type& vprog = vertex_programs[lvid];
+    local_vertex_type local_vertex = graph.l_vertex(lvid);
+    const vertex_type vertex(local_vertex);
+    const local_edge_list_type edges = part.in_edges ?
+      local_vertex.in_edges() : local_vertex.out_edges();
+    bool accum_is_set = false;
+    gather_type accum = gather_type();
+    typename local_edge_list_type::iterator it = edges.begin() + part.begin;
+    for (size_t i = part.begin; i < part.end; ++i, ++it) {
+      edge_type edge(*it);
+      if(accum_is_set) {
+        accum += vprog.gather(context, vertex, edge);
+      } else {
+        accum = vprog.gather(context, vertex, edge);
+        accum_is_set = true;
+      }
+    }
+    INCREMENT_EVENT(EVENT_GATHERS, part.end - part.begin);
+
+    if (gather_parts.combine(part, accum, accum_is_set)) {
+      // the same as the end of an unsplit gather in execute_gathers
+      typename gather_part_queues_type::split_gather& gather = *part.gather;
+      vprog.post_local_gather(gather.accum);
+      if (!gather_cache.empty() && gather.accum_is_set) {
+        gather_cache[lvid] = gather.accum; has_cache.set_bit(lvid);
+      }
+      if (gather.accum_is_set) sync_gather(lvid, gather.accum, thread_id);
+      if (!graph.l_is_master(lvid)) {
+        vertex_programs[lvid] = vertex_program_type();
+      }
+      ++completed_gathers;
+      delete part.gather;
+    }
+    gather_parts.part_done();
+  } // end of run_gather_part
+
+
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>::
   execute_applys(const size_t thread_id) {
@@ -1782,22 +2145,14 @@ namespace graphlab {
     size_t vcount = 0;
     size_t napply_inc = 0;
     timer ti;
+    // with track_changes, the vertex data before the apply and the
+    // buffer its delta is encoded in
+    vertex_data_type old_vdata;
+    oarchive delta_arc;
 
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset;  // allocate a word size = 64bits
-    while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = active_superstep.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+    std::vector<lvid_type> lvid_block;
+    while (active_superstep.next_block(shared_lvid_counter, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
 
         // Only master vertices can be active in a super-step
         ASSERT_TRUE(graph.l_is_master(lvid));
@@ -1806,13 +2161,17 @@ namespace graphlab {
         // the gather_accum was not set during the gather.
         const gather_type& accum = gather_accum[lvid];
         INCREMENT_EVENT(EVENT_APPLIES, 1);
+        const bool track = track_changes &&
+          graph.l_vertex(lvid).num_mirrors() > 0;
+        if (track) old_vdata = vertex.data();
         vertex_programs[lvid].apply(context, vertex, accum);
         // record an apply as a completed task
         ++napply_inc;
         // Clear the accumulator to save some memory
         gather_accum[lvid] = gather_type();
         // synchronize the changed vertex data with all mirrors
-        sync_vertex_data(lvid, thread_id);
+        if (track) sync_vertex_delta(lvid, old_vdata, delta_arc, thread_id);
+        else sync_vertex_data(lvid, thread_id);
         // determine if a scatter operation is needed
         const vertex_program_type& const_vprog = vertex_programs[lvid];
         const vertex_type const_vertex = vertex;
@@ -1827,21 +2186,26 @@ namespace graphlab {
         if(++vcount % TRY_RECV_MOD == 0) {
           recv_vertex_programs();
           recv_vertex_data();
+          if (track_changes) recv_vertex_delta();
         }
       }
     } // end of loop over vertices to run apply
+    free(delta_arc.buf);
     completed_applys += napply_inc;
     per_thread_compute_time[thread_id] += ti.current_time();
     vprog_exchange.partial_flush();
     vdata_exchange.partial_flush();
+    if (track_changes) vdelta_exchange.partial_flush();
       // Finish sending and receiving all changes due to apply operations
     thread_barrier.wait();
     if(thread_id == 0) { 
       vprog_exchange.flush(); vdata_exchange.flush(); 
+      if (track_changes) vdelta_exchange.flush();
     }
     thread_barrier.wait();
     recv_vertex_programs();
     recv_vertex_data();
+    if (track_changes) recv_vertex_delta();
   } // end of execute_applys
 
 
@@ -1853,21 +2217,9 @@ namespace graphlab {
     context_type context(*this, graph);
     size_t nscatter_inc = 0;
     timer ti;
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset; // allocate a word size = 64 bits
-    while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = active_minorstep.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+    std::vector<lvid_type> lvid_block;
+    while (active_minorstep.next_block(shared_lvid_counter, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
 
         const vertex_program_type& vprog = vertex_programs[lvid];
         local_vertex_type local_vertex = graph.l_vertex(lvid);
@@ -1971,6 +2323,51 @@ namespace graphlab {
   } // end of recv vertex data
 
 
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  sync_vertex_delta(lvid_type lvid, const vertex_data_type& old_data,
+                    oarchive& delta_arc, const size_t thread_id) {
+    ASSERT_TRUE(graph.l_is_master(lvid));
+    const vertex_id_type vid = graph.global_vid(lvid);
+    local_vertex_type vertex = graph.l_vertex(lvid);
+    const size_t nmirrors = vertex.num_mirrors();
+    vdata_sync_stats& stats = per_thread_vdata_stats[thread_id];
+    // the full update, which the diff keeps or replaces by a delta
+    delta_arc.off = 0;
+    delta_arc << vertex.data();
+    stats.full_bytes += nmirrors * delta_arc.off;
+    if (!vertex_programs[lvid].diff_vertex_data(old_data, vertex.data(),
+                                                delta_arc)) {
+      stats.suppressed += nmirrors;
+      return;
+    }
+    stats.sent_bytes += nmirrors * delta_arc.off;
+    const std::string delta(delta_arc.buf, delta_arc.off);
+    foreach(const procid_t& mirror, vertex.mirrors()) {
+      vdelta_exchange.send(mirror, std::make_pair(vid, delta));
+    }
+  } // end of sync_vertex_delta
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  recv_vertex_delta() {
+    const vertex_program_type patcher = vertex_program_type();
+    typename vdelta_exchange_type::recv_buffer_type recv_buffer;
+    while(vdelta_exchange.recv(recv_buffer)) {
+      for (size_t i = 0;i < recv_buffer.size(); ++i) {
+        typename vdelta_exchange_type::buffer_type& buffer = recv_buffer[i].buffer;
+        foreach(const vid_vdelta_pair_type& pair, buffer) {
+          const lvid_type lvid = graph.local_vid(pair.first);
+          ASSERT_FALSE(graph.l_is_master(lvid));
+          iarchive iarc(pair.second.data(), pair.second.size());
+          patcher.patch_vertex_data(graph.l_vertex(lvid).data(), iarc);
+        }
+      }
+    }
+  } // end of recv_vertex_delta
+
+
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>::
   sync_gather(lvid_type lvid, const gather_type& accum, const size_t thread_id) {
@@ -25,6 +25,13 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <utility>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #if defined(__cplusplus) && __cplusplus >= 201103L
 // do not include spirit
@@ -37,8 +44,10 @@
 #endif
 
 #include <graphlab/util/stl_util.hpp>
+#include <graphlab/util/charstream.hpp>
 #include <graphlab/logger/logger.hpp>
 #include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/graph/graph_basic_types.hpp>
 
 
 
@@ -226,6 +235,241 @@ namespace graphlab {
       return true;
     } // end of adjc parser
 
+
+    /**************************************************************************
+     *                         Block parsers                                  *
+     *                                                                        *
+     * A block parser receives a buffer [begin, end) holding a sequence of    *
+     * complete lines (the final line may lack its '\n') and adds all edges   *
+     * found in it to the graph in batches through Graph::add_edges(). They   *
+     * avoid the per line std::string, strtoul and boost::function call of    *
+     * the line parsers above and are used by load_format() for the plain     *
+     * edge list formats.                                                     *
+     **************************************************************************/
+
+    namespace block_parser_impl {
+
+      /// Number of edges buffered before they are handed to the graph
+      const size_t EDGE_BATCH_SIZE = 4096;
+
+      /**
+       * Returns a pointer to the first '\n' in [begin, end) or NULL if there
+       * is none. Scans 16 bytes at a time when SSE2 is available.
+       */
+      inline const char* find_newline(const char* begin, const char* end) {
+#ifdef __SSE2__
+        const __m128i nl = _mm_set1_epi8('\n');
+        while (begin + 16 <= end) {
+          const __m128i chunk =
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+          const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+          if (mask != 0) return begin + __builtin_ctz(mask);
+          begin += 16;
+        }
+#endif
+        return reinterpret_cast<const char*>(
+            memchr(begin, '\n', end - begin));
+      }
+
+      /**
+       * Returns a pointer to the last '\n' in [begin, end) or NULL if there
+       * is none.
+       */
+      inline const char* rfind_newline(const char* begin, const char* end) {
+        while (end > begin) {
+          --end;
+          if (*end == '\n') return end;
+        }
+        return NULL;
+      }
+
+      inline bool is_digit(char c) {
+        return (unsigned char)(c - '0') < 10;
+      }
+
+      /// Space, tab, carriage return and comma separate numbers on a line
+      inline bool is_separator(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == ',';
+      }
+
+      /**
+       * Skips separators and parses one unsigned decimal number starting at
+       * ptr. Returns false if no number is found before the end of the line.
+       */
+      inline bool parse_uint(const char*& ptr, const char* end, size_t& ret) {
+        while (ptr < end && is_separator(*ptr)) ++ptr;
+        if (ptr == end || !is_digit(*ptr)) return false;
+        size_t val = 0;
+        while (ptr < end && is_digit(*ptr)) {
+          val = val * 10 + (*ptr - '0');
+          ++ptr;
+        }
+        ret = val;
+        return true;
+      }
+
+      /// Trailing characters after the last number must be separators
+      inline bool only_separators(const char* ptr, const char* end) {
+        while (ptr < end && is_separator(*ptr)) ++ptr;
+        return ptr == end;
+      }
+
+      /**
+       * Accumulates edges and forwards them to the graph in batches.
+       */
+      template <typename Graph>
+      struct edge_batch {
+        typedef typename Graph::vertex_id_type vertex_id_type;
+        Graph& graph;
+        std::vector<std::pair<vertex_id_type, vertex_id_type> > edges;
+        edge_batch(Graph& graph) : graph(graph) {
+          edges.reserve(EDGE_BATCH_SIZE);
+        }
+        ~edge_batch() { flush(); }
+        inline void add(size_t source, size_t target) {
+          if (source == target) return;
+          edges.push_back(std::make_pair(vertex_id_type(source),
+                                         vertex_id_type(target)));
+          if (edges.size() >= EDGE_BATCH_SIZE) flush();
+        }
+        void flush() {
+          if (edges.empty()) return;
+          graph.add_edges(edges);
+          edges.clear();
+        }
+      };
+
+      /**
+       * Parses lines of the form "source target" in which the two ids are
+       * separated by whitespace or a comma. If allow_comments is set, lines
+       * beginning with '#' or '%' are echoed and skipped. If reverse is set
+       * the edge direction is flipped.
+       *
+       * As with the line parsers, lines without two ids, such as column
+       * headers, are skipped. The first one of each block is logged.
+       */
+      template <typename Graph>
+      bool parse_edge_list(Graph& graph, const std::string& srcfilename,
+                           const char* begin, const char* end,
+                           bool allow_comments, bool reverse) {
+        edge_batch<Graph> batch(graph);
+        size_t nskipped = 0;
+        while (begin < end) {
+          const char* eol = find_newline(begin, end);
+          if (eol == NULL) eol = end;
+          const char* line = begin;
+          const char* ptr = begin;
+          begin = eol + 1;
+          if (only_separators(ptr, eol)) continue;
+          if (allow_comments && (*ptr == '#' || *ptr == '%')) {
+            std::cout << std::string(line, eol) << std::endl;
+            continue;
+          }
+          size_t source, target;
+          if (!parse_uint(ptr, eol, source) || !parse_uint(ptr, eol, target)) {
+            if (nskipped++ == 0) {
+              logstream(LOG_WARNING) << "Skipping unparsable line in "
+                                     << srcfilename << ": \""
+                                     << std::string(line, eol) << "\""
+                                     << std::endl;
+            }
+            continue;
+          }
+          if (reverse) batch.add(target, source);
+          else batch.add(source, target);
+        }
+        if (nskipped > 1) {
+          logstream(LOG_WARNING) << "Skipped " << nskipped
+                                 << " unparsable lines in " << srcfilename
+                                 << std::endl;
+        }
+        return true;
+      }
+    } // namespace block_parser_impl
+
+    /**
+     * \brief Block version of snap_parser().
+     */
+    template <typename Graph>
+    bool snap_block_parser(Graph& graph, const std::string& srcfilename,
+                           const char* begin, const char* end) {
+      return block_parser_impl::parse_edge_list(graph, srcfilename,
+                                                begin, end, true, false);
+    } // end of snap block parser
+
+    /**
+     * \brief Block version of tsv_parser().
+     */
+    template <typename Graph>
+    bool tsv_block_parser(Graph& graph, const std::string& srcfilename,
+                          const char* begin, const char* end) {
+      return block_parser_impl::parse_edge_list(graph, srcfilename,
+                                                begin, end, false, false);
+    } // end of tsv block parser
+
+    /**
+     * \brief Block version of rtsv_parser().
+     */
+    template <typename Graph>
+    bool rtsv_block_parser(Graph& graph, const std::string& srcfilename,
+                           const char* begin, const char* end) {
+      return block_parser_impl::parse_edge_list(graph, srcfilename,
+                                                begin, end, false, true);
+    } // end of rtsv block parser
+
+    /**
+     * \brief Block version of csv_parser().
+     */
+    template <typename Graph>
+    bool csv_block_parser(Graph& graph, const std::string& srcfilename,
+                          const char* begin, const char* end) {
+      return block_parser_impl::parse_edge_list(graph, srcfilename,
+                                                begin, end, false, false);
+    } // end of csv block parser
+
+    /**
+     * \brief Block version of adj_parser().
+     *
+     * Each line holds a source id, the number of targets n and then
+     * n target ids, separated by whitespace or commas.
+     */
+    template <typename Graph>
+    bool adj_block_parser(Graph& graph, const std::string& srcfilename,
+                          const char* begin, const char* end) {
+      using namespace block_parser_impl;
+      edge_batch<Graph> batch(graph);
+      while (begin < end) {
+        const char* eol = find_newline(begin, end);
+        if (eol == NULL) eol = end;
+        const char* line = begin;
+        const char* ptr = begin;
+        begin = eol + 1;
+        if (only_separators(ptr, eol)) continue;
+        size_t source, n, target;
+        if (!parse_uint(ptr, eol, source)) {
+          logstream(LOG_WARNING) << "Error parsing line in " << srcfilename
+                                 << ": \"" << std::string(line, eol)
+                                 << "\"" << std::endl;
+          return false;
+        }
+        // a vertex without a target count has no edges
+        if (!parse_uint(ptr, eol, n)) continue;
+        size_t nadded = 0;
+        while (parse_uint(ptr, eol, target)) {
+          batch.add(source, target);
+          ++nadded;
+        }
+        if (n != nadded || !only_separators(ptr, eol)) {
+          logstream(LOG_WARNING) << "Error parsing line in " << srcfilename
+                                 << ": \"" << std::string(line, eol)
+                                 << "\"" << std::endl;
+          return false;
+        }
+      }
+      return true;
+    } // end of adj block parser
+
+
     template <typename Graph>
     struct tsv_writer{
       typedef typename Graph::vertex_type vertex_type;
@@ -55,6 +55,11 @@
 #include <boost/filesystem.hpp>
 #include <boost/concept/requires.hpp>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 
 #include <graphlab/logger/logger.hpp>
 #include <graphlab/logger/assertions.hpp>
@@ -73,6 +78,8 @@
 #include <graphlab/graph/local_graph.hpp>
 #include <graphlab/graph/dynamic_local_graph.hpp>
 
+#include <graphlab/graph/mirror_set.hpp>
+#include <graphlab/graph/local_vertex_order.hpp>
 #include <graphlab/graph/graph_gather_apply.hpp>
 #include <graphlab/graph/ingress/distributed_ingress_base.hpp>
 #include <graphlab/graph/ingress/distributed_oblivious_ingress.hpp>
@@ -395,8 +402,25 @@ namespace graphlab {
     typedef boost::function<bool(distributed_graph&, const std::string&,
                                  const std::string&)> line_parser_type;
 
+    /**
+       The block parser is any function (or functor) that has the form:
+
+       <code>
+        bool block_parser(distributed_graph& graph, const std::string& filename,
+                          const char* begin, const char* end);
+       </code>
+
+       [begin, end) holds a sequence of complete lines, of which only the
+       last may lack a trailing newline. The block parser returns true if
+       all lines were parsed successfully. See
+       \ref graphlab::distributed_graph::load_blocks "load_blocks()".
+     */
+    typedef boost::function<bool(distributed_graph&, const std::string&,
+                                 const char*, const char*)> block_parser_type;
 
-    typedef fixed_dense_bitset<RPC_MAX_N_PROCS> mirror_type;
+
+    /// The set of machines mirroring a vertex. See \ref mirror_set
+    typedef mirror_set mirror_type;
 
     /// The type of the local graph used to store the graph data
 #ifdef USE_DYNAMIC_LOCAL_GRAPH
@@ -638,6 +662,12 @@ namespace graphlab {
      *                Defaults to 50,000. Increasing this number will
      *                decrease partitioning time with a penalty to partitioning
      *                quality.
+     * \li \c split_ingress If set to 1, uncompressed input files are cut into
+     *                line aligned byte ranges which are parsed by all
+     *                machines and threads, instead of assigning whole files
+     *                to machines. Ignored with affinity. Defaults to 0.
+     * \li \c split_size The minimum number of bytes in one byte range when
+     *                split_ingress is enabled. Defaults to 64MB.
      *
      * \param [in] dc Distributed controller to associate with
      * \param [in] opts A graphlab::graphlab_options object specifying engine
@@ -654,7 +684,9 @@ namespace graphlab {
 #else
       vertex_exchange(dc), 
 #endif
-      vset_exchange(dc), parallel_ingress(true), data_affinity(false) {
+      vset_exchange(dc), parallel_ingress(true), data_affinity(false),
+      split_ingress(false), split_size(64 * 1024 * 1024),
+      compress_adjacency(false), reorder_method("none") {
       rpc.barrier();
       set_options(opts);
     }
@@ -689,6 +721,12 @@ namespace graphlab {
 	  // random seed
 	  uint32_t seed = 5;
 
+      // out-of-core ingress
+      std::string spill_dir;
+      size_t spill_edges = 1 << 24;
+
+      bool compress_exchange = false;
+
       std::vector<std::string> keys = opts.get_graph_args().get_option_keys();
       foreach(std::string opt, keys) {
         if (opt == "ingress") {
@@ -726,6 +764,52 @@ namespace graphlab {
           if (rpc.procid() == 0)
             logstream(LOG_EMPH) << "Graph Option: affinity = "
                                 << data_affinity << std::endl;
+        } else if (opt == "split_ingress") {
+          opts.get_graph_args().get_option("split_ingress", split_ingress);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: split_ingress = "
+                                << split_ingress << std::endl;
+        } else if (opt == "split_size") {
+          opts.get_graph_args().get_option("split_size", split_size);
+          if (split_size == 0) split_size = 1;
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: split_size = "
+                                << split_size << std::endl;
+        } else if (opt == "spill_dir") {
+          opts.get_graph_args().get_option("spill_dir", spill_dir);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: spill_dir = "
+                                << spill_dir << std::endl;
+        } else if (opt == "spill_edges") {
+          opts.get_graph_args().get_option("spill_edges", spill_edges);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: spill_edges = "
+                                << spill_edges << std::endl;
+        } else if (opt == "compress_adjacency") {
+          opts.get_graph_args().get_option("compress_adjacency", compress_adjacency);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: compress_adjacency = "
+                                << compress_adjacency << std::endl;
+#ifdef USE_DYNAMIC_LOCAL_GRAPH
+          if (compress_adjacency) {
+            logstream(LOG_FATAL)
+              << "\n\tcompress_adjacency requires the static local graph."
+              << "\n\tRebuild with ./configure --static_local_graph."
+              << std::endl;
+          }
+#endif
+        } else if (opt == "compress_exchange") {
+          opts.get_graph_args().get_option("compress_exchange", compress_exchange);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: compress_exchange = "
+                                << compress_exchange << std::endl;
+        } else if (opt == "reorder") {
+          opts.get_graph_args().get_option("reorder", reorder_method);
+          if (reorder_method != "degree" && reorder_method != "rcm")
+            reorder_method = "none";
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: reorder = "
+                                << reorder_method << std::endl;
         } else if (opt == "favorite") {
           opts.get_graph_args().get_option("favorite", favorite);
           if(favorite != "target") favorite = "source";
@@ -763,6 +847,10 @@ namespace graphlab {
       }
       set_ingress_method(ingress_method, bufsize, usehash, userecent, favorite,
         threshold, nedges, nverts, interval, seed);
+      if (!spill_dir.empty()) {
+        ingress_ptr->set_edge_spill(spill_dir + "/graphlab_edges", spill_edges);
+      }
+      if (compress_exchange) ingress_ptr->set_exchange_compression(true);
     }
 
   public:
@@ -790,6 +878,8 @@ namespace graphlab {
       ASSERT_NE(ingress_ptr, NULL);
       logstream(LOG_INFO) << "Distributed graph: enter finalize" << std::endl;
       ingress_ptr->finalize();
+      if (reorder_method != "none") reorder_local_vertices();
+      if (compress_adjacency) local_graph.compress();
       lock_manager.resize(num_local_vertices());
       rpc.barrier(); 
 
@@ -981,6 +1071,46 @@ namespace graphlab {
       return true;
     }
 
+    /**
+     * \brief Creates a batch of edges with default edge data.
+     *
+     * Equivalent to calling add_edge(source, target) for every pair, but
+     * hands the whole batch to the ingress at once. Pairs containing
+     * the reserved id (vertex_id_type)(-1) and self edges are skipped.
+     *
+     * Returns true if all edges were added.
+     */
+    bool add_edges(const std::vector<std::pair<vertex_id_type,
+                                               vertex_id_type> >& edges) {
+#ifndef USE_DYNAMIC_LOCAL_GRAPH
+      if(finalized) {
+        logstream(LOG_FATAL)
+          << "\n\tAttempting to add an edge to a finalized graph."
+          << "\n\tEdges cannot be added to a graph after finalization."
+          << std::endl;
+      }
+#else
+      finalized = false;
+#endif
+      ASSERT_NE(ingress_ptr, NULL);
+      bool all_valid = true;
+      for (size_t i = 0; i < edges.size() && all_valid; ++i) {
+        all_valid = edges[i].first != vertex_id_type(-1) &&
+                    edges[i].second != vertex_id_type(-1) &&
+                    edges[i].first != edges[i].second;
+      }
+      if (all_valid) {
+        ingress_ptr->add_edges(edges);
+        return true;
+      }
+      // slow path: let add_edge() report and skip the invalid edges
+      bool success = true;
+      for (size_t i = 0; i < edges.size(); ++i) {
+        success &= add_edge(edges[i].first, edges[i].second);
+      }
+      return success;
+    }
+
    /**
     * \brief Performs a map-reduce operation on each vertex in the
     * graph returning the result.
@@ -1906,6 +2036,103 @@ namespace graphlab {
     } // end of save
 
 
+    /** \brief Saves the partitioned graph as a snapshot which can be
+     * reloaded with load_partition() without running ingress again. This
+     * function must be called simultaneously on all machines.
+     *
+     * Every machine writes one uncompressed file
+     * \li [prefix]_partition_1_of_N
+     * \li [prefix]_partition_2_of_N
+     * \li etc.
+     *
+     * holding its finalized local CSR/CSC adjacency, its vid2lvid mapping
+     * and its vertex records (owner, degree type, mirror set) exactly as the
+     * ingress method built them, followed by the vertex and edge data.
+     * All arrays are written as contiguous blocks so that load_partition()
+     * can read them straight out of a memory mapping.
+     *
+     * The snapshot can only be loaded on the same number of machines and
+     * with the same vertex and edge data serialization formats.
+     * The graph is finalized if it is not already.
+     *
+     * Returns true on success, and false if any file cannot be written.
+     */
+    bool save_partition(const std::string& prefix) {
+      rpc.full_barrier();
+      finalize();
+      timer savetime;  savetime.start();
+      const std::string fname = partition_filename(prefix);
+      logstream(LOG_INFO) << "Save partition to " << fname << std::endl;
+      size_t success = 0;
+      std::ofstream out_file(fname.c_str(),
+                             std::ios_base::out | std::ios_base::binary);
+      if (!out_file.good()) {
+        logstream(LOG_ERROR) << "\n\tError opening file: " << fname << std::endl;
+      } else {
+        oarchive oarc(out_file);
+        save_partition_to_archive(oarc);
+        out_file.close();
+        success = !out_file.fail();
+      }
+      rpc.all_reduce(success);
+      logstream(LOG_INFO) << "Finished saving partition: "
+                          << savetime.current_time() << std::endl;
+      rpc.full_barrier();
+      return success == rpc.numprocs();
+    } // end of save partition
+
+
+    /** \brief Loads a partitioned graph snapshot written by
+     * save_partition(). This function must be called simultaneously on all
+     * machines, and there must be as many machines as when the snapshot was
+     * saved.
+     *
+     * The snapshot file is memory mapped and the local graph, vid2lvid map
+     * and vertex records are rebuilt directly from it. Neither ingress
+     * nor finalize() is run, so the graph is ready for computation once
+     * this function returns. The compress_adjacency option is applied
+     * as in finalize().
+     *
+     * Returns true on success. Returns false on all machines if any machine
+     * cannot open its file, or if the file was written by a different
+     * number of machines or with different id widths.
+     */
+    bool load_partition(const std::string& prefix) {
+      rpc.full_barrier();
+      timer loadtime;  loadtime.start();
+      const std::string fname = partition_filename(prefix);
+      logstream(LOG_INFO) << "Load partition from " << fname << std::endl;
+      size_t success = 0;
+      const int fd = open(fname.c_str(), O_RDONLY);
+      struct stat st;
+      if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        logstream(LOG_ERROR) << "\n\tError opening file: " << fname << std::endl;
+      } else {
+        void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+          logstream(LOG_ERROR) << "\n\tError mapping file: " << fname << std::endl;
+        } else {
+          madvise(addr, st.st_size, MADV_SEQUENTIAL);
+          iarchive iarc(reinterpret_cast<const char*>(addr), st.st_size);
+          success = load_partition_from_archive(iarc);
+          munmap(addr, st.st_size);
+        }
+      }
+      if (fd >= 0) close(fd);
+      rpc.all_reduce(success);
+      if (success != rpc.numprocs()) {
+        clear();
+        rpc.full_barrier();
+        return false;
+      }
+      lock_manager.resize(num_local_vertices());
+      logstream(LOG_INFO) << "Finished loading partition: "
+                          << loadtime.current_time() << std::endl;
+      rpc.full_barrier();
+      return true;
+    } // end of load partition
+
+
     /**
      * \brief Saves the graph to the filesystem using a provided Writer object.
      * Like \ref save(const std::string& prefix, writer writer, bool gzip, bool save_vertex, bool save_edge, size_t files_per_machine) "save()"
@@ -2247,6 +2474,46 @@ namespace graphlab {
      */
     void load_from_posixfs(std::string prefix,
                            line_parser_type line_parser) {
+      load_text_from_posixfs(prefix, line_parser, block_parser_type());
+    } // end of load from posixfs
+
+    /**
+     *  \brief Like load_from_posixfs() but parses the files with a
+     *  block parser.
+     */
+    void load_blocks_from_posixfs(std::string prefix,
+                                  block_parser_type block_parser) {
+      load_text_from_posixfs(prefix, line_parser_type(), block_parser);
+    } // end of load blocks from posixfs
+
+    /**
+     *  \brief Load a graph from a collection of files in stored on
+     *  the HDFS using the user defined line parser. Like
+     *  \ref load(const std::string& path, line_parser_type line_parser)
+     *  but only loads from HDFS.
+     */
+    void load_from_hdfs(std::string prefix, line_parser_type line_parser) {
+      load_text_from_hdfs(prefix, line_parser, block_parser_type());
+    } // end of load from hdfs
+
+    /**
+     *  \brief Like load_from_hdfs() but parses the files with a
+     *  block parser.
+     */
+    void load_blocks_from_hdfs(std::string prefix,
+                               block_parser_type block_parser) {
+      load_text_from_hdfs(prefix, line_parser_type(), block_parser);
+    } // end of load blocks from hdfs
+
+  private:
+    /**
+     *  \internal
+     *  Loads all files matching the prefix from the filesystem. Exactly one
+     *  of line_parser and block_parser is set.
+     */
+    void load_text_from_posixfs(std::string prefix,
+                                line_parser_type line_parser,
+                                block_parser_type block_parser) {
       std::string directory_name; std::string original_path(prefix);
       boost::filesystem::path path(prefix);
       std::string search_prefix;
@@ -2269,6 +2536,47 @@ namespace graphlab {
         logstream(LOG_WARNING) << "No files found matching " << original_path << std::endl;
       }
 
+      if (split_ingress && parallel_ingress && !data_affinity) {
+        std::vector<size_t> file_sizes(graph_files.size());
+        for(size_t i = 0; i < graph_files.size(); ++i) {
+          file_sizes[i] = boost::filesystem::file_size(graph_files[i]);
+        }
+        std::vector<file_split> splits;
+        compute_file_splits(graph_files, file_sizes, splits);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for(size_t i = 0; i < splits.size(); ++i) {
+          if (i % rpc.numprocs() != rpc.procid()) continue;
+          const file_split& split = splits[i];
+          const std::string& fname = graph_files[split.file_idx];
+          std::ifstream in_file(fname.c_str(),
+                                std::ios_base::in | std::ios_base::binary);
+          bool success = false;
+          if (split.compressed) {
+            boost::iostreams::filtering_stream<boost::iostreams::input> fin;
+            fin.push(boost::iostreams::gzip_decompressor());
+            fin.push(in_file);
+            success = parse_text_stream(fname, fin, 0, size_t(-1),
+                                        line_parser, block_parser);
+            fin.pop(); fin.pop();
+          } else {
+            // start one byte early so that a line beginning exactly at
+            // split.begin is recognized as belonging to this split.
+            const size_t seek_pos = split.begin > 0 ? split.begin - 1 : 0;
+            in_file.seekg(seek_pos);
+            success = parse_text_stream(fname, in_file, split.begin, split.end,
+                                        line_parser, block_parser);
+          }
+          if(!success) {
+            logstream(LOG_FATAL)
+              << "\n\tError parsing file: " << fname << std::endl;
+          }
+        }
+        rpc.full_barrier();
+        return;
+      }
+
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
@@ -2287,7 +2595,9 @@ namespace graphlab {
           // Using gzip filter
           if (gzip) fin.push(boost::iostreams::gzip_decompressor());
           fin.push(in_file);
-          const bool success = load_from_stream(graph_files[i], fin, line_parser);
+          const bool success = parse_text_stream(graph_files[i], fin, 0,
+                                                 size_t(-1), line_parser,
+                                                 block_parser);
           if(!success) {
             logstream(LOG_FATAL)
               << "\n\tError parsing file: " << graph_files[i] << std::endl;
@@ -2297,15 +2607,16 @@ namespace graphlab {
         }
       }
       rpc.full_barrier();
-    } // end of load from posixfs
+    } // end of load text from posixfs
 
     /**
-     *  \brief Load a graph from a collection of files in stored on
-     *  the HDFS using the user defined line parser. Like
-     *  \ref load(const std::string& path, line_parser_type line_parser)
-     *  but only loads from HDFS.
+     *  \internal
+     *  Loads all files matching the prefix from HDFS. Exactly one of
+     *  line_parser and block_parser is set.
      */
-    void load_from_hdfs(std::string prefix, line_parser_type line_parser) {
+    void load_text_from_hdfs(std::string prefix,
+                             line_parser_type line_parser,
+                             block_parser_type block_parser) {
       // force a "/" at the end of the path
       // make sure to check that the path is non-empty. (you do not
       // want to make the empty path "" the root path "/" )
@@ -2324,6 +2635,47 @@ namespace graphlab {
         logstream(LOG_WARNING) << "No files found matching " << prefix << std::endl;
       }
 
+      if (split_ingress && parallel_ingress && !data_affinity) {
+        std::vector<size_t> file_sizes(graph_files.size());
+        for(size_t i = 0; i < graph_files.size(); ++i) {
+          file_sizes[i] = hdfs.file_size(graph_files[i]);
+        }
+        std::vector<file_split> splits;
+        compute_file_splits(graph_files, file_sizes, splits);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for(size_t i = 0; i < splits.size(); ++i) {
+          if (i % rpc.numprocs() != rpc.procid()) continue;
+          const file_split& split = splits[i];
+          const std::string& fname = graph_files[split.file_idx];
+          graphlab::hdfs::fstream in_file(hdfs, fname);
+          bool success = false;
+          if (split.compressed) {
+            boost::iostreams::filtering_stream<boost::iostreams::input> fin;
+            fin.push(boost::iostreams::gzip_decompressor());
+            fin.push(in_file);
+            success = parse_text_stream(fname, fin, 0, size_t(-1),
+                                        line_parser, block_parser);
+            fin.pop(); fin.pop();
+          } else {
+            const size_t seek_pos = split.begin > 0 ? split.begin - 1 : 0;
+            if (seek_pos > 0 && !in_file->seek(seek_pos)) {
+              logstream(LOG_FATAL)
+                << "\n\tUnable to seek in file: " << fname << std::endl;
+            }
+            success = parse_text_stream(fname, in_file, split.begin, split.end,
+                                        line_parser, block_parser);
+          }
+          if(!success) {
+            logstream(LOG_FATAL)
+              << "\n\tError parsing file: " << fname << std::endl;
+          }
+        }
+        rpc.full_barrier();
+        return;
+      }
+
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
@@ -2338,7 +2690,9 @@ namespace graphlab {
           boost::iostreams::filtering_stream<boost::iostreams::input> fin;
           if(gzip) fin.push(boost::iostreams::gzip_decompressor());
           fin.push(in_file);
-          const bool success = load_from_stream(graph_files[i], fin, line_parser);
+          const bool success = parse_text_stream(graph_files[i], fin, 0,
+                                                 size_t(-1), line_parser,
+                                                 block_parser);
           if(!success) {
             logstream(LOG_FATAL)
               << "\n\tError parsing file: " << graph_files[i] << std::endl;
@@ -2348,7 +2702,9 @@ namespace graphlab {
         }
       }
       rpc.full_barrier();
-    } // end of load from hdfs
+    } // end of load text from hdfs
+
+  public:
 
 
     /**
@@ -2431,6 +2787,30 @@ namespace graphlab {
       rpc.full_barrier();
     } // end of load
 
+    /**
+     *  \brief Load the graph from a given path using a block parser.
+     *  This function should be called on all machines simultaneously.
+     *
+     *  Files are matched exactly as in
+     *  \ref load(const std::string& path, line_parser_type line_parser) "load()",
+     *  but instead of one std::string per line the block_parser receives
+     *  large buffers of complete lines, which lets it scan the text
+     *  directly and add edges in batches with add_edges().
+     *
+     *  \param prefix The file prefix to read from.
+     *  \param block_parser A user defined block parsing function
+     */
+    void load_blocks(std::string prefix, block_parser_type block_parser) {
+      rpc.full_barrier();
+      if (prefix.length() == 0) return;
+      if(boost::starts_with(prefix, "hdfs://")) {
+        load_blocks_from_hdfs(prefix, block_parser);
+      } else {
+        load_blocks_from_posixfs(prefix, block_parser);
+      }
+      rpc.full_barrier();
+    } // end of load blocks
+
     /**
      * \brief Constructs a synthetic power law graph. Must be called on
      * all machines simultaneously.
@@ -2547,24 +2927,25 @@ namespace graphlab {
      */
     void load_format(const std::string& path, const std::string& format) {
       line_parser_type line_parser;
+      block_parser_type block_parser;
       if (format == "snap") {
-        line_parser = builtin_parsers::snap_parser<distributed_graph>;
-        load(path, line_parser);
+        block_parser = builtin_parsers::snap_block_parser<distributed_graph>;
+        load_blocks(path, block_parser);
       } else if (format == "adj") {
-        line_parser = builtin_parsers::adj_parser<distributed_graph>;
-        load(path, line_parser);
+        block_parser = builtin_parsers::adj_block_parser<distributed_graph>;
+        load_blocks(path, block_parser);
       } else if (format == "adjc") {
         line_parser = builtin_parsers::adjc_parser<distributed_graph>;
         load(path, line_parser);
       } else if (format == "tsv") {
-        line_parser = builtin_parsers::tsv_parser<distributed_graph>;
-        load(path, line_parser);
+        block_parser = builtin_parsers::tsv_block_parser<distributed_graph>;
+        load_blocks(path, block_parser);
       } else if (format == "rtsv") { // debug
-        line_parser = builtin_parsers::rtsv_parser<distributed_graph>;
-        load(path, line_parser);
+        block_parser = builtin_parsers::rtsv_block_parser<distributed_graph>;
+        load_blocks(path, block_parser);
       } else if (format == "csv") {
-        line_parser = builtin_parsers::csv_parser<distributed_graph>;
-        load(path, line_parser);
+        block_parser = builtin_parsers::csv_block_parser<distributed_graph>;
+        load_blocks(path, block_parser);
       } else if (format == "graphjrl") {
         line_parser = builtin_parsers::graphjrl_parser<distributed_graph>;
         load(path, line_parser);
@@ -2746,7 +3127,8 @@ namespace graphlab {
       /// The number of in edges
       vertex_id_type num_in_edges, num_out_edges;
       /** The set of proc that mirror this vertex.  The owner should
-          NOT be in this set.*/
+          NOT be in this set. Small sets are stored inline in the record,
+          so most records do not allocate.*/
       mirror_type _mirrors;
       vertex_record() :
         owner(-1), gvid(-1), num_in_edges(0), num_out_edges(0) { }
@@ -3330,12 +3712,97 @@ namespace graphlab {
     /** Command option to enable data affinity. Currently only supported by bipartite */
     bool data_affinity;
 
+    /** Command option to parse input files in line aligned byte ranges
+     * spread over all machines, instead of one file per machine */
+    bool split_ingress;
+
+    /** The minimum size in bytes of a byte range used by split ingress */
+    size_t split_size;
+
+    /** Command option to compress the local adjacency after finalize */
+    bool compress_adjacency;
+
+    /** Command option to relabel the local vertices after finalize:
+     * none, degree or rcm */
+    std::string reorder_method;
+
     // logs for graph partitioning ...
     double edge_balance;
     double vertex_balance;
 
     lock_manager_type lock_manager;
 
+    /**
+     * \internal
+     * Relabels the local vertices in the order chosen by the reorder
+     * option, with the masters first. The local graph is rebuilt in the
+     * new lvids, and lvid2record and vid2lvid are permuted to match.
+     * Every edge id changes too.
+     */
+    void reorder_local_vertices() {
+      graphlab::timer ti; ti.start();
+      typedef typename local_graph_type::edge_type lgraph_edge_type;
+      const size_t nlocal = local_graph.num_vertices();
+      std::vector<bool> is_master(nlocal);
+      for (size_t i = 0; i < nlocal; ++i) {
+        is_master[i] = (lvid2record[i].owner == rpc.procid());
+      }
+      std::vector<lvid_type> new2old = (reorder_method == "rcm") ?
+          local_vertex_order::reverse_cuthill_mckee(local_graph, is_master) :
+          local_vertex_order::by_degree(local_graph, is_master);
+      std::vector<lvid_type> old2new(nlocal);
+      for (size_t i = 0; i < nlocal; ++i) old2new[new2old[i]] = i;
+
+      const size_t nlocal_edges = local_graph.num_edges();
+      std::vector<edge_id_type> csr_ptr, csr_eid, csc_ptr, csc_eid;
+      std::vector<lvid_type> csr_nbr, csc_nbr;
+      std::vector<edge_data_type> edata;
+      std::vector<edge_id_type> old2new_eid(nlocal_edges);
+      csr_nbr.reserve(nlocal_edges); edata.reserve(nlocal_edges);
+      // only vertices up to the last one with neighbors carry an offset
+      for (size_t u = 0; u < nlocal; ++u) {
+        const lvid_type v = new2old[u];
+        if (local_graph.num_out_edges(v) == 0) continue;
+        csr_ptr.resize(u + 1, csr_nbr.size());
+        foreach(const lgraph_edge_type& e, local_graph.out_edges(v)) {
+          old2new_eid[e.id()] = csr_nbr.size();
+          csr_nbr.push_back(old2new[e.target().id()]);
+          edata.push_back(e.data());
+        }
+      }
+      csr_eid.resize(csr_nbr.size());
+      for (size_t i = 0; i < csr_eid.size(); ++i) csr_eid[i] = i;
+      csc_nbr.reserve(nlocal_edges); csc_eid.reserve(nlocal_edges);
+      for (size_t u = 0; u < nlocal; ++u) {
+        const lvid_type v = new2old[u];
+        if (local_graph.num_in_edges(v) == 0) continue;
+        csc_ptr.resize(u + 1, csc_nbr.size());
+        foreach(const lgraph_edge_type& e, local_graph.in_edges(v)) {
+          csc_nbr.push_back(old2new[e.source().id()]);
+          csc_eid.push_back(old2new_eid[e.id()]);
+        }
+      }
+      std::vector<edge_id_type>().swap(old2new_eid);
+      std::vector<vertex_data_type> vdata(nlocal);
+      for (size_t u = 0; u < nlocal; ++u) {
+        vdata[u] = local_graph.vertex_data(new2old[u]);
+      }
+      local_graph.load_adjacency(vdata, edata, csr_ptr, csr_nbr, csr_eid,
+                                 csc_ptr, csc_nbr, csc_eid);
+
+      std::vector<vertex_record> records(nlocal);
+      for (size_t u = 0; u < nlocal; ++u) {
+        records[u] = lvid2record[new2old[u]];
+        vid2lvid[records[u].gvid] = u;
+      }
+      lvid2record.swap(records);
+      if (rpc.procid() == 0) {
+        logstream(LOG_INFO) << "Local vertices reordered by " << reorder_method
+                            << " in " << ti.current_time() << " secs"
+                            << std::endl;
+      }
+    } // end of reorder_local_vertices
+
     void set_ingress_method(const std::string& method,
         size_t bufsize = 50000, bool usehash = false, bool userecent = false, 
         std::string favorite = "source",
@@ -3446,6 +3913,464 @@ namespace graphlab {
     } // end of load from stream
 
 
+    /**
+     * \internal
+     * A contiguous byte range [begin, end) of one input file. A line belongs
+     * to the split which contains its first byte. Compressed files cannot
+     * be entered at an arbitrary offset and always form a single split.
+     */
+    struct file_split {
+      size_t file_idx;
+      size_t begin, end;
+      bool compressed;
+      file_split(size_t file_idx = 0, size_t begin = 0, size_t end = 0,
+                 bool compressed = false) :
+        file_idx(file_idx), begin(begin), end(end), compressed(compressed) { }
+    };
+
+    /**
+     * \internal
+     * Cuts the input files into byte ranges so that every thread on every
+     * machine receives roughly the same amount of text. The result only
+     * depends on the file list and sizes, so all machines compute the same
+     * splits and split i is parsed by machine i % numprocs.
+     */
+    void compute_file_splits(const std::vector<std::string>& graph_files,
+                             const std::vector<size_t>& file_sizes,
+                             std::vector<file_split>& splits) {
+      splits.clear();
+      size_t total_bytes = 0;
+      for(size_t i = 0; i < file_sizes.size(); ++i) total_bytes += file_sizes[i];
+#ifdef _OPENMP
+      const size_t nthreads = omp_get_max_threads();
+#else
+      const size_t nthreads = 1;
+#endif
+      const size_t target_splits = rpc.numprocs() * nthreads;
+      const size_t chunk = std::max(split_size,
+                                    (total_bytes + target_splits - 1) / target_splits);
+      for(size_t i = 0; i < graph_files.size(); ++i) {
+        if (boost::ends_with(graph_files[i], ".gz")) {
+          splits.push_back(file_split(i, 0, file_sizes[i], true));
+          continue;
+        }
+        for(size_t begin = 0; begin < file_sizes[i]; begin += chunk) {
+          splits.push_back(file_split(i, begin,
+                                      std::min(begin + chunk, file_sizes[i])));
+        }
+      }
+      if (rpc.procid() == 0) {
+        logstream(LOG_EMPH) << "Split ingress: " << total_bytes << " bytes in "
+                            << graph_files.size() << " files cut into "
+                            << splits.size() << " splits" << std::endl;
+      }
+    } // end of compute file splits
+
+    /**
+       \internal
+       Parses the lines of a stream which begin inside the byte range
+       [begin, end). The stream must be positioned at begin - 1 (or at 0
+       when begin is 0), so that the partial line owned by the previous
+       split can be skipped.
+     */
+    template<typename Fstream>
+    bool load_split_from_stream(std::string filename, Fstream& fin,
+                                size_t begin, size_t end,
+                                line_parser_type& line_parser) {
+      size_t linecount = 0;
+      size_t pos = 0;
+      std::string line;
+      if (begin > 0) {
+        // discard the tail of the line which starts in the previous split
+        pos = begin - 1;
+        std::getline(fin, line);
+        pos += line.length() + 1;
+      }
+      timer ti; ti.start();
+      while(pos < end && fin.good() && !fin.eof()) {
+        std::getline(fin, line);
+        if(fin.fail()) break;
+        pos += line.length() + 1;
+        if(line.empty()) continue;
+        const bool success = line_parser(*this, filename, line);
+        if (!success) {
+          logstream(LOG_WARNING)
+            << "Error parsing line " << linecount << " in "
+            << filename << ": " << std::endl
+            << "\t\"" << line << "\"" << std::endl;
+          return false;
+        }
+        ++linecount;
+        if (ti.current_time() > 5.0) {
+          logstream(LOG_INFO) << linecount << " Lines read" << std::endl;
+          ti.start();
+        }
+      }
+      return true;
+    } // end of load split from stream
+
+
+    /**
+       \internal
+       Parses the lines of a stream which begin inside [begin, end) with
+       whichever of the two parsers is set. Whole streams are passed as
+       begin = 0 and end = size_t(-1).
+     */
+    template<typename Fstream>
+    bool parse_text_stream(const std::string& filename, Fstream& fin,
+                           size_t begin, size_t end,
+                           line_parser_type& line_parser,
+                           block_parser_type& block_parser) {
+      if (block_parser) {
+        return load_blocks_from_stream(filename, fin, begin, end, block_parser);
+      } else if (begin == 0 && end == size_t(-1)) {
+        return load_from_stream(filename, fin, line_parser);
+      } else {
+        return load_split_from_stream(filename, fin, begin, end, line_parser);
+      }
+    } // end of parse text stream
+
+    /**
+       \internal
+       Reads a stream in large blocks and hands every run of complete lines
+       to the block parser. Only lines beginning inside [begin, end) are
+       parsed; as with load_split_from_stream() the stream must be
+       positioned at begin - 1 when begin is not 0.
+     */
+    template<typename Fstream>
+    bool load_blocks_from_stream(const std::string& filename, Fstream& fin,
+                                 size_t begin, size_t end,
+                                 block_parser_type& block_parser) {
+      using builtin_parsers::block_parser_impl::find_newline;
+      using builtin_parsers::block_parser_impl::rfind_newline;
+      std::vector<char> buffer(4 * 1024 * 1024);
+      // absolute offset of buffer[0] in the file
+      size_t pos = begin > 0 ? begin - 1 : 0;
+      bool skip_partial_line = begin > 0;
+      size_t carry = 0;
+      size_t nbytes = 0;
+      timer ti; ti.start();
+      while(true) {
+        fin.read(&buffer[carry], buffer.size() - carry);
+        const size_t nread = fin.gcount();
+        const bool eof = !fin.good();
+        const char* data = &buffer[0];
+        const char* data_end = data + carry + nread;
+        const char* cur = data;
+        if (skip_partial_line) {
+          // discard the tail of the line which starts in the previous split
+          const char* nl = find_newline(cur, data_end);
+          if (nl == NULL) {
+            if (eof) return true;
+            pos += data_end - data; carry = 0;
+            continue;
+          }
+          cur = nl + 1;
+          skip_partial_line = false;
+        }
+        // parse up to the last complete line, or everything at the end
+        const char* last_nl = rfind_newline(cur, data_end);
+        const char* parse_end = eof ? data_end :
+                                (last_nl == NULL ? cur : last_nl + 1);
+        bool done = eof;
+        if (pos + (cur - data) >= end) {
+          parse_end = cur; done = true;
+        } else if (pos + (parse_end - data) > end) {
+          // the last owned line contains the byte just before end
+          const char* nl = find_newline(data + (end - pos) - 1, parse_end);
+          if (nl != NULL) parse_end = nl + 1;
+          done = true;
+        }
+        if (parse_end > cur) {
+          if (!block_parser(*this, filename, cur, parse_end)) return false;
+          nbytes += parse_end - cur;
+        }
+        if (done) break;
+        carry = data_end - parse_end;
+        pos += parse_end - data;
+        if (carry > 0) memmove(&buffer[0], parse_end, carry);
+        // a single line longer than the buffer
+        if (carry == buffer.size()) buffer.resize(2 * buffer.size());
+        if (ti.current_time() > 5.0) {
+          logstream(LOG_INFO) << nbytes << " Bytes parsed" << std::endl;
+          ti.start();
+        }
+      }
+      return true;
+    } // end of load blocks from stream
+
+
+    /// \internal Magic number and version of the partition snapshot format
+    static const uint64_t PARTITION_MAGIC = 0x31305452415047ULL; // "GPART01"
+    static const uint32_t PARTITION_VERSION = 1;
+
+    std::string partition_filename(const std::string& prefix) const {
+      return prefix + "_partition_" + tostr(rpc.procid() + 1) + "_of_" +
+             tostr(rpc.numprocs());
+    }
+
+    /**
+       \internal
+       Writes the local partition. Vertex records are written column by
+       column and the adjacency as plain id arrays, so that every array is
+       a single contiguous block in the archive.
+     */
+    void save_partition_to_archive(oarchive& oarc) const {
+      const size_t nlocal = local_graph.num_vertices();
+      // copied so that the in-class constants are not bound to references
+      const uint64_t magic = PARTITION_MAGIC;
+      const uint32_t version = PARTITION_VERSION;
+      oarc << magic << version
+           << uint32_t(rpc.numprocs()) << uint32_t(rpc.procid())
+           << uint32_t(sizeof(vertex_id_type)) << uint32_t(sizeof(lvid_type))
+           << uint32_t(sizeof(edge_id_type)) << int32_t(how_cuts)
+           << nverts << nedges << local_own_nverts << nreplicas
+           << edge_balance << vertex_balance;
+
+      std::vector<vertex_id_type> gvids(nlocal), num_in(nlocal), num_out(nlocal);
+      std::vector<procid_t> owners(nlocal);
+      std::vector<int32_t> dtypes(nlocal);
+      std::vector<size_t> mirror_ptr(nlocal + 1, 0);
+      std::vector<procid_t> mirror_procs;
+      for (size_t i = 0; i < nlocal; ++i) {
+        const vertex_record& rec = lvid2record[i];
+        gvids[i] = rec.gvid; owners[i] = rec.owner; dtypes[i] = rec.dtype;
+        num_in[i] = rec.num_in_edges; num_out[i] = rec.num_out_edges;
+        foreach(size_t proc, rec.mirrors()) mirror_procs.push_back(proc);
+        mirror_ptr[i + 1] = mirror_procs.size();
+      }
+      oarc << gvids << owners << dtypes << num_in << num_out
+           << mirror_ptr << mirror_procs;
+
+      // the local graph is not const-iterable, but is only read here
+      local_graph_type& lgraph = const_cast<local_graph_type&>(local_graph);
+      for (size_t dir = 0; dir < 2; ++dir) {
+        std::vector<edge_id_type> ptr;
+        std::vector<lvid_type> nbr;
+        std::vector<edge_id_type> eid;
+        nbr.reserve(lgraph.num_edges()); eid.reserve(lgraph.num_edges());
+        // only vertices up to the last one with neighbors carry an offset
+        for (size_t i = 0; i < nlocal; ++i) {
+          const size_t degree = dir == 0 ? lgraph.num_out_edges(i)
+                                         : lgraph.num_in_edges(i);
+          if (degree == 0) continue;
+          ptr.resize(i + 1, nbr.size());
+          if (dir == 0) {
+            foreach(const typename local_graph_type::edge_type& e, lgraph.out_edges(i)) {
+              nbr.push_back(e.target().id()); eid.push_back(e.id());
+            }
+          } else {
+            foreach(const typename local_graph_type::edge_type& e, lgraph.in_edges(i)) {
+              nbr.push_back(e.source().id()); eid.push_back(e.id());
+            }
+          }
+        }
+        oarc << ptr << nbr << eid;
+      }
+
+      std::vector<vertex_data_type> vdata(nlocal);
+      for (size_t i = 0; i < nlocal; ++i) vdata[i] = lgraph.vertex_data(i);
+      oarc << vdata;
+      std::vector<vertex_data_type>().swap(vdata);
+      std::vector<edge_data_type> edata(lgraph.num_edges());
+      for (size_t i = 0; i < edata.size(); ++i) edata[i] = lgraph.edge_data(i);
+      oarc << edata;
+    } // end of save partition to archive
+
+    /// \internal The bytes of a buffer archive which are not read yet
+    static size_t partition_bytes_left(const iarchive& iarc) {
+      return iarc.off < iarc.len ? iarc.len - iarc.off : 0;
+    }
+
+    /**
+       \internal
+       Decodes the size_t at the read position of a buffer archive
+       without consuming it. A size_t is written as a width tag followed
+       by 1, 2, 4 or 8 bytes. Returns the number of bytes it takes, or 0
+       if it is corrupt or runs past the end of the archive.
+     */
+    static size_t peek_partition_size(const iarchive& iarc, size_t& value) {
+      const size_t left = partition_bytes_left(iarc);
+      if (left < 1) return 0;
+      const unsigned char tag = iarc.buf[iarc.off];
+      if (tag > 3 || left < 1 + (size_t(1) << tag)) return 0;
+      const char* p = iarc.buf + iarc.off + 1;
+      switch(tag) {
+       case 0: { unsigned char v; memcpy(&v, p, 1); value = v; break; }
+       case 1: { uint16_t v; memcpy(&v, p, 2); value = v; break; }
+       case 2: { uint32_t v; memcpy(&v, p, 4); value = v; break; }
+       default: { uint64_t v; memcpy(&v, p, 8); value = v; break; }
+      }
+      return 1 + (size_t(1) << tag);
+    }
+
+    /// \internal Reads a size_t if it is intact, see peek_partition_size()
+    static bool read_partition_size(iarchive& iarc, size_t& value) {
+      if (peek_partition_size(iarc, value) == 0) return false;
+      iarc >> value;
+      return true;
+    }
+
+    /**
+       \internal
+       Reads a vector of a partition snapshot after checking its length
+       prefix, so that a corrupt length can neither allocate nor read
+       past the end of the mapping. The length must be expected, unless
+       expected is -1, and the elements of bulk serializable types must
+       fit in the rest of the archive.
+     */
+    template <typename T>
+    static bool read_partition_vector(iarchive& iarc, std::vector<T>& vec,
+                                      size_t expected = size_t(-1)) {
+      size_t n = 0;
+      const size_t width = peek_partition_size(iarc, n);
+      if (width == 0) return false;
+      if (expected != size_t(-1) && n != expected) return false;
+      if (gl_is_bulk_serializable<T>::value &&
+          n > (partition_bytes_left(iarc) - width) / sizeof(T)) {
+        return false;
+      }
+      iarc >> vec;
+      return !iarc.fail();
+    }
+
+    /**
+       \internal
+       Returns true if ptr and nbr describe rows of at most nlocal
+       vertices whose neighbors and edge ids are in range.
+     */
+    static bool check_partition_adjacency(const std::vector<edge_id_type>& ptr,
+                                          const std::vector<lvid_type>& nbr,
+                                          const std::vector<edge_id_type>& eid,
+                                          size_t nlocal) {
+      if (ptr.size() > nlocal || eid.size() != nbr.size()) return false;
+      for (size_t i = 0; i < ptr.size(); ++i) {
+        if (ptr[i] >= nbr.size() || (i > 0 && ptr[i] < ptr[i - 1])) return false;
+      }
+      for (size_t i = 0; i < nbr.size(); ++i) {
+        if (nbr[i] >= nlocal || eid[i] >= nbr.size()) return false;
+      }
+      return true;
+    }
+
+    /**
+       \internal
+       Reads a partition written by save_partition_to_archive() and
+       installs it as the finalized graph. Returns false if the snapshot
+       does not match this build or the current number of machines, or
+       if it is truncated or inconsistent. Every length is checked
+       before it is used, since the archive reads the mapping unchecked.
+     */
+    bool load_partition_from_archive(iarchive& iarc) {
+      size_t magic = 0; uint32_t version = 0;
+      if (!read_partition_size(iarc, magic) ||
+          partition_bytes_left(iarc) < 7 * sizeof(uint32_t)) {
+        logstream(LOG_ERROR) << "Truncated partition snapshot" << std::endl;
+        return false;
+      }
+      iarc >> version;
+      if (magic != PARTITION_MAGIC || version != PARTITION_VERSION) {
+        logstream(LOG_ERROR) << "Not a partition snapshot or unsupported version"
+                             << std::endl;
+        return false;
+      }
+      uint32_t numprocs, procid, vid_size, lvid_size, eid_size;
+      int32_t cuts;
+      iarc >> numprocs >> procid >> vid_size >> lvid_size >> eid_size >> cuts;
+      if (numprocs != rpc.numprocs() || procid != rpc.procid()) {
+        logstream(LOG_ERROR) << "Partition snapshot was saved by machine "
+                             << procid << " of " << numprocs << std::endl;
+        return false;
+      }
+      if (vid_size != sizeof(vertex_id_type) || lvid_size != sizeof(lvid_type) ||
+          eid_size != sizeof(edge_id_type)) {
+        logstream(LOG_ERROR) << "Partition snapshot uses different id widths"
+                             << std::endl;
+        return false;
+      }
+      if (cuts < 0 || cuts >= NUM_CUTS_TYPES) {
+        logstream(LOG_ERROR) << "Corrupt partition snapshot" << std::endl;
+        return false;
+      }
+      clear();
+      how_cuts = cuts_type(cuts);
+      if (!read_partition_size(iarc, nverts) ||
+          !read_partition_size(iarc, nedges) ||
+          !read_partition_size(iarc, local_own_nverts) ||
+          !read_partition_size(iarc, nreplicas) ||
+          partition_bytes_left(iarc) < 2 * sizeof(double)) {
+        logstream(LOG_ERROR) << "Truncated partition snapshot" << std::endl;
+        clear();
+        return false;
+      }
+      iarc >> edge_balance >> vertex_balance;
+
+      std::vector<vertex_id_type> gvids, num_in, num_out;
+      std::vector<procid_t> owners;
+      std::vector<int32_t> dtypes;
+      std::vector<size_t> mirror_ptr;
+      std::vector<procid_t> mirror_procs;
+      std::vector<edge_id_type> csr_ptr, csr_eid, csc_ptr, csc_eid;
+      std::vector<lvid_type> csr_nbr, csc_nbr;
+      std::vector<vertex_data_type> vdata;
+      std::vector<edge_data_type> edata;
+      bool ok = read_partition_vector(iarc, gvids);
+      const size_t nlocal = gvids.size();
+      ok = ok && read_partition_vector(iarc, owners, nlocal)
+              && read_partition_vector(iarc, dtypes, nlocal)
+              && read_partition_vector(iarc, num_in, nlocal)
+              && read_partition_vector(iarc, num_out, nlocal)
+              && read_partition_vector(iarc, mirror_ptr, nlocal + 1)
+              && read_partition_vector(iarc, mirror_procs)
+              && read_partition_vector(iarc, csr_ptr)
+              && read_partition_vector(iarc, csr_nbr)
+              && read_partition_vector(iarc, csr_eid, csr_nbr.size())
+              && read_partition_vector(iarc, csc_ptr)
+              && read_partition_vector(iarc, csc_nbr, csr_nbr.size())
+              && read_partition_vector(iarc, csc_eid, csr_nbr.size())
+              && read_partition_vector(iarc, vdata, nlocal)
+              && read_partition_vector(iarc, edata, csr_nbr.size());
+      ok = ok && mirror_ptr[0] == 0 &&
+           mirror_ptr[nlocal] == mirror_procs.size() &&
+           check_partition_adjacency(csr_ptr, csr_nbr, csr_eid, nlocal) &&
+           check_partition_adjacency(csc_ptr, csc_nbr, csc_eid, nlocal);
+      for (size_t i = 0; ok && i < nlocal; ++i) {
+        ok = owners[i] < numprocs && mirror_ptr[i] <= mirror_ptr[i + 1] &&
+             dtypes[i] >= 0 && dtypes[i] < NUM_ZONE_TYPES;
+      }
+      for (size_t j = 0; ok && j < mirror_procs.size(); ++j) {
+        ok = mirror_procs[j] < numprocs;
+      }
+      // the out edges are stored in edge id order
+      for (size_t i = 0; ok && i < csr_eid.size(); ++i) ok = csr_eid[i] == i;
+      if (!ok) {
+        logstream(LOG_ERROR) << "Truncated or corrupt partition snapshot"
+                             << std::endl;
+        clear();
+        return false;
+      }
+
+      lvid2record.resize(nlocal);
+      vid2lvid.rehash(2 * nlocal);
+      for (size_t i = 0; i < nlocal; ++i) {
+        vertex_record& rec = lvid2record[i];
+        rec.gvid = gvids[i]; rec.owner = owners[i];
+        rec.dtype = degree_type(dtypes[i]);
+        rec.num_in_edges = num_in[i]; rec.num_out_edges = num_out[i];
+        for (size_t j = mirror_ptr[i]; j < mirror_ptr[i + 1]; ++j) {
+          rec._mirrors.set_bit_unsync(mirror_procs[j]);
+        }
+        vid2lvid[gvids[i]] = i;
+      }
+      local_graph.load_adjacency(vdata, edata, csr_ptr, csr_nbr, csr_eid,
+                                 csc_ptr, csc_nbr, csc_eid);
+      // as in finalize(), since the snapshot stores the plain adjacency
+      if (compress_adjacency) local_graph.compress();
+      finalized = true;
+      return true;
+    } // end of load partition from archive
+
+
     template<typename Fstream, typename Writer>
     void save_vertex_to_stream(vertex_type& vertex, Fstream& fout, Writer writer) {
       fout << writer.save_vertex(vertex);
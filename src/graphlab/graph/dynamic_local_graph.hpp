@@ -52,6 +52,7 @@
 #include <graphlab/util/generics/shuffle.hpp>
 #include <graphlab/util/generics/counting_sort.hpp>
 #include <graphlab/util/generics/dynamic_csr_storage.hpp>
+#include <graphlab/util/generics/vector_zip.hpp>
 #include <graphlab/parallel/atomic.hpp>
 
 #include <graphlab/logger/logger.hpp>
@@ -281,17 +282,22 @@ namespace graphlab {
       std::vector< std::pair<lvid_type, edge_id_type> >  csr_values;
       std::vector< std::pair<lvid_type, edge_id_type> >  csc_values;
 
-      csr_values.reserve(dest_permute.size());
       edge_id_type begineid = edges.size();
-      for (size_t i = 0; i < dest_permute.size(); ++i) {
-        csr_values.push_back(std::pair<lvid_type, edge_id_type> (edge_buffer.target_arr[dest_permute[i]],
-                                                                 begineid + dest_permute[i]));
+      csr_values.resize(dest_permute.size());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(dest_permute.size()); ++i) {
+        csr_values[i] = std::pair<lvid_type, edge_id_type> (edge_buffer.target_arr[dest_permute[i]],
+                                                            begineid + dest_permute[i]);
       }
-      csc_values.reserve(src_permute.size());
-
-      for (size_t i = 0; i < src_permute.size(); ++i) {
-        csc_values.push_back(std::pair<lvid_type, edge_id_type> (edge_buffer.source_arr[src_permute[i]],
-                                                                 begineid + src_permute[i]));
+      csc_values.resize(src_permute.size());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(src_permute.size()); ++i) {
+        csc_values[i] = std::pair<lvid_type, edge_id_type> (edge_buffer.source_arr[src_permute[i]],
+                                                            begineid + src_permute[i]);
       }
       ASSERT_EQ(csc_values.size(), csr_values.size());
 
@@ -345,6 +351,46 @@ namespace graphlab {
 #endif
     } // End of finalize
 
+    /**
+     * \brief The dynamic graph keeps its adjacency editable, so it
+     * cannot be compressed. Logs a warning and keeps the graph as is.
+     */
+    void compress() {
+      logstream(LOG_WARNING) << "The dynamic local graph does not support "
+                             << "compress_adjacency." << std::endl;
+    }
+
+    /** \brief Always false. See compress() */
+    bool is_compressed() const { return false; }
+
+
+    /**
+     * \internal
+     * \brief Rebuilds a finalized local_graph directly from CSR (out edges)
+     * and CSC (in edges) arrays, skipping finalize(). ptr[v] is the offset
+     * of the first neighbor of v and vertices past the end of ptr have no
+     * neighbors. All input vectors are consumed.
+     */
+    void load_adjacency(std::vector<VertexData>& vdata,
+                        std::vector<EdgeData>& edata,
+                        std::vector<edge_id_type>& csr_ptr,
+                        std::vector<lvid_type>& csr_nbr,
+                        std::vector<edge_id_type>& csr_eid,
+                        std::vector<edge_id_type>& csc_ptr,
+                        std::vector<lvid_type>& csc_nbr,
+                        std::vector<edge_id_type>& csc_eid) {
+      clear();
+      ASSERT_EQ(csr_nbr.size(), edata.size());
+      ASSERT_EQ(csc_nbr.size(), edata.size());
+      vertices.swap(vdata);
+      edges.swap(edata);
+      std::vector<std::pair<lvid_type, edge_id_type> > csr_values =
+          vector_zip(csr_nbr, csr_eid);
+      _csr_storage.wrap(csr_ptr, csr_values);
+      std::vector<std::pair<lvid_type, edge_id_type> > csc_values =
+          vector_zip(csc_nbr, csc_eid);
+      _csc_storage.wrap(csc_ptr, csc_values);
+    } // end of load adjacency
 
     /** \brief Load the local_graph from an archive */
     void load(iarchive& arc) {
@@ -56,7 +56,7 @@ namespace graphlab {
     mutex local_graph_lock;
     mutex lvid2record_lock;
 
-    typedef fixed_dense_bitset<RPC_MAX_N_PROCS> bin_counts_type;
+    typedef fixed_dense_bitset<RPC_DENSE_MAX_N_PROCS> bin_counts_type;
 
     /** Type of the degree hash table: 
      * a map from vertex id to a bitset of length num_procs. */
@@ -91,7 +91,7 @@ namespace graphlab {
     /** A set of vertex in the current batch requiring query the DHT. */
     std::vector<boost::unordered_set<vertex_id_type> > query_set;
     /** The map from proc_id to num_edges on that proc */
-    std::vector<size_t> proc_num_edges;
+    proc_load_tracker proc_num_edges;
 
     DECLARE_TRACER(batch_ingress_add_edge);
     DECLARE_TRACER(batch_ingress_add_edges);
@@ -110,6 +110,8 @@ namespace graphlab {
       base_type(dc, graph), rpc(dc, this), 
       num_edges(0), bufsize(bufsize), query_set(dc.numprocs()),
       proc_num_edges(dc.numprocs()), usehash(usehash), userecent(userecent) { 
+       ASSERT_MSG(dc.numprocs() <= RPC_DENSE_MAX_N_PROCS,
+                  "Batch ingress supports at most %d processes", RPC_DENSE_MAX_N_PROCS);
        rpc.barrier(); 
 
       INITIALIZE_TRACER(batch_ingress_add_edge, "Time spent in add edge");
@@ -101,6 +101,12 @@ namespace graphlab {
       
     }
 
+    void set_exchange_compression(bool enable) {
+      base_type::set_exchange_compression(enable);
+      bipartite_edge_exchange.set_compression(enable);
+      bipartite_vertex_exchange.set_compression(enable);
+    }
+
     /** accumulate edges temporal rally point using random of "favorite" assignment. */
     void add_edge(vertex_id_type source, vertex_id_type target,
                   const EdgeData& edata) {
@@ -151,6 +157,8 @@ namespace graphlab {
       /*                                                                        */
       /**************************************************************************/
       bipartite_edge_exchange.flush(); bipartite_vertex_exchange.flush();
+      bipartite_edge_exchange.get_compression().report("Aweto edge exchange");
+      bipartite_vertex_exchange.get_compression().report("Aweto vertex exchange");
 
       /**
        * Fast pass for redundant finalization with no graph changes. 
@@ -57,7 +57,7 @@ namespace graphlab {
 
     typedef distributed_ingress_base<VertexData, EdgeData> base_type;
     // typedef typename boost::unordered_map<vertex_id_type, std::vector<size_t> > degree_hash_table_type;
-    typedef fixed_dense_bitset<RPC_MAX_N_PROCS> bin_counts_type; 
+    typedef fixed_dense_bitset<RPC_DENSE_MAX_N_PROCS> bin_counts_type; 
 
     /** Type of the degree hash table: 
      * a map from vertex id to a bitset of length num_procs. */
@@ -65,7 +65,7 @@ namespace graphlab {
     degree_hash_table_type dht;
 
     /** Array of number of edges on each proc. */
-    std::vector<size_t> proc_num_edges;
+    proc_load_tracker proc_num_edges;
 
     /** Ingress tratis. */
     bool usehash;
@@ -78,6 +78,8 @@ namespace graphlab {
     distributed_constrained_oblivious_ingress(distributed_control& dc, graph_type& graph, bool usehash = false, bool userecent = false) :
       base_type(dc, graph),
       dht(-1),proc_num_edges(dc.numprocs()), usehash(usehash), userecent(userecent) { 
+        ASSERT_MSG(dc.numprocs() <= RPC_DENSE_MAX_N_PROCS,
+                   "Constrained oblivious ingress supports at most %d processes", RPC_DENSE_MAX_N_PROCS);
         constraint = new sharding_constraint(dc.numprocs(), "grid"); 
      }
 
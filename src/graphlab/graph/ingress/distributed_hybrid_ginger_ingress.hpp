@@ -173,6 +173,16 @@ namespace graphlab {
 
     ~distributed_hybrid_ginger_ingress() { }
 
+    void set_exchange_compression(bool enable) {
+      base_type::set_exchange_compression(enable);
+      hybrid_edge_exchange.set_compression(enable);
+      hybrid_vertex_exchange.set_compression(enable);
+      high_edge_exchange.set_compression(enable);
+      low_edge_exchange.set_compression(enable);
+      resend_vertex_exchange.set_compression(enable);
+      mht_exchange.set_compression(enable);
+    }
+
     /** Add an edge to the ingress object using random hashing assignment.
      *  This function acts as the first phase for SNAP graph to deliver edges
      *  via the hashing value of its target vertex.
@@ -502,6 +512,12 @@ namespace graphlab {
                             << std::endl;
       }
 
+      hybrid_edge_exchange.get_compression().report("Ginger edge exchange");
+      hybrid_vertex_exchange.get_compression().report("Ginger vertex exchange");
+      high_edge_exchange.get_compression().report("Ginger high degree edge exchange");
+      low_edge_exchange.get_compression().report("Ginger low degree edge exchange");
+      mht_exchange.get_compression().report("Ginger mht exchange");
+
       // connect to base finalize()
       modified_base_finalize(nedges);
 
@@ -754,6 +770,8 @@ namespace graphlab {
 
           // receive vertex data re-sent by other machines            
           resend_vertex_exchange.flush();
+          resend_vertex_exchange.get_compression().report(
+              "Ginger resent vertex exchange");
           proc = -1;
           while(resend_vertex_exchange.recv(proc, vertex_buffer)) {
             foreach(const vertex_buffer_record& rec, vertex_buffer) {
@@ -121,6 +121,12 @@ namespace graphlab {
 
     ~distributed_hybrid_ingress() { }
 
+    void set_exchange_compression(bool enable) {
+      base_type::set_exchange_compression(enable);
+      hybrid_edge_exchange.set_compression(enable);
+      hybrid_vertex_exchange.set_compression(enable);
+    }
+
     /** Add an edge to the ingress object using random hashing assignment.
      *  This function acts as the first phase for SNAP graph to deliver edges
      *  via the hashing value of its target vertex.
@@ -287,6 +293,9 @@ namespace graphlab {
                             << std::endl;
       }
       
+      hybrid_edge_exchange.get_compression().report("Hybrid edge exchange");
+      hybrid_vertex_exchange.get_compression().report("Hybrid vertex exchange");
+
       // connect to base finalize()
       modified_base_finalize(nedges);
       
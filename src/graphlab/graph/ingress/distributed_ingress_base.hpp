@@ -26,9 +26,11 @@
 #include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/graph/graph_hash.hpp>
 #include <graphlab/graph/ingress/ingress_edge_decision.hpp>
+#include <graphlab/graph/ingress/edge_spill_store.hpp>
 #include <graphlab/graph/graph_gather_apply.hpp>
 #include <graphlab/util/memory_info.hpp>
 #include <graphlab/util/hopscotch_map.hpp>
+#include <boost/bind.hpp>
 #include <graphlab/rpc/buffered_exchange.hpp>
 #include <graphlab/macros_def.hpp>
 namespace graphlab {
@@ -111,6 +113,9 @@ namespace graphlab {
     /// Ingress decision object for computing the edge destination. 
     ingress_edge_decision<VertexData, EdgeData> edge_decision;
 
+    /// Received edges on local disk, or NULL if edges stay in memory
+    edge_spill_store<EdgeData>* edge_spill;
+
   public:
     distributed_ingress_base(distributed_control& dc, graph_type& graph) :
       rpc(dc, this), graph(graph), 
@@ -120,11 +125,39 @@ namespace graphlab {
 #else
       vertex_exchange(dc), edge_exchange(dc),
 #endif
-      edge_decision(dc) {
+      edge_decision(dc), edge_spill(NULL) {
       rpc.barrier();
     } // end of constructor
 
-    virtual ~distributed_ingress_base() { }
+    virtual ~distributed_ingress_base() {
+      if (edge_spill != NULL) {
+        edge_exchange.set_recv_handler(typename buffered_exchange<edge_buffer_record>::handler_type());
+        delete edge_spill;
+      }
+    }
+
+    /**
+     * \brief Spills the edges received by this machine to sorted runs
+     * of run_edges edges in files starting with prefix, instead of
+     * keeping them in memory until finalize(). Only ingress methods
+     * that build the local graph with the base finalize() use it.
+     */
+    void set_edge_spill(const std::string& prefix, size_t run_edges) {
+      ASSERT_TRUE(edge_spill == NULL);
+      edge_spill = new edge_spill_store<EdgeData>(
+          prefix + "." + tostr(rpc.procid()), run_edges);
+      edge_exchange.set_recv_handler(
+          boost::bind(&distributed_ingress_base::spill_edges, this, _1, _2));
+    }
+
+    /**
+     * \brief Compresses the send buffers of the ingress exchanges of this
+     * machine if enable is set. See buffered_exchange::set_compression().
+     */
+    virtual void set_exchange_compression(bool enable) {
+      edge_exchange.set_compression(enable);
+      vertex_exchange.set_compression(enable);
+    }
 
     /** \brief Add an edge to the ingress object. */
     virtual void add_edge(vertex_id_type source, vertex_id_type target,
@@ -139,6 +172,16 @@ namespace graphlab {
 #endif
     } // end of add edge
 
+    /** \brief Add a batch of edges carrying default edge data. Ingress
+     * methods may override this to amortize per edge overhead. */
+    virtual void add_edges(const std::vector<std::pair<vertex_id_type,
+                                                       vertex_id_type> >& edges) {
+      const EdgeData edata = EdgeData();
+      for (size_t i = 0; i < edges.size(); ++i) {
+        add_edge(edges[i].first, edges[i].second, edata);
+      }
+    } // end of add edges
+
 
     /** \brief Add an vertex to the ingress object. */
     virtual void add_vertex(vertex_id_type vid, const VertexData& vdata)  { 
@@ -233,12 +276,15 @@ namespace graphlab {
       /*                                                                        */
       /**************************************************************************/
       edge_exchange.flush(); vertex_exchange.flush();     
+      edge_exchange.get_compression().report("Ingress edge exchange");
+      vertex_exchange.get_compression().report("Ingress vertex exchange");
 
       /**
        * Fast pass for redundant finalization with no graph changes. 
        */
       {
         size_t changed_size = edge_exchange.size() + vertex_exchange.size();
+        if (edge_spill != NULL) changed_size += edge_spill->num_edges();
         rpc.all_reduce(changed_size);
         if (changed_size == 0) {
           logstream(LOG_INFO) << "Skipping Graph Finalization because no changes happened..." << std::endl;
@@ -255,7 +301,31 @@ namespace graphlab {
       /*                         Construct local graph                          */
       /*                                                                        */
       /**************************************************************************/
-      { // Add all the edges to the local graph
+      bool local_graph_built = false;
+      if (edge_spill != NULL) { // Build the local graph from the spilled runs
+        logstream(LOG_INFO) << "Graph Finalize: merging spilled edges" << std::endl;
+        edge_buffer_type edge_buffer;
+        procid_t proc(-1);
+        while(edge_exchange.recv(proc, edge_buffer)) {
+          edge_spill->add_records(edge_buffer);
+        }
+        edge_spill->flush();
+        if (lvid_start == 0) {
+          edge_spill->build_local_graph(graph.local_graph, vid2lvid_buffer);
+          local_graph_built = true;
+        } else {
+          const size_t nedges = edge_spill->num_edges() + 1;
+          graph.local_graph.reserve_edge_space(nedges + 1);
+          typename edge_spill_store<EdgeData>::merge_reader reader(*edge_spill);
+          typename edge_spill_store<EdgeData>::edge_record rec;
+          while (reader.next(rec)) {
+            add_local_edge(rec.source, rec.target, rec.edata,
+                           vid2lvid_buffer, lvid_start, updated_lvids);
+          }
+        }
+        edge_spill->clear();
+        ASSERT_EQ(graph.vid2lvid.size()  + vid2lvid_buffer.size(), graph.local_graph.num_vertices());
+      } else { // Add all the edges to the local graph
         logstream(LOG_INFO) << "Graph Finalize: constructing local graph" << std::endl;
         const size_t nedges = edge_exchange.size() + 1;
         graph.local_graph.reserve_edge_space(nedges + 1);      
@@ -263,48 +333,26 @@ namespace graphlab {
         procid_t proc(-1);
         while(edge_exchange.recv(proc, edge_buffer)) {
           foreach(const edge_buffer_record& rec, edge_buffer) {
-            // Get the source_vlid;
-            lvid_type source_lvid(-1);
-            if(graph.vid2lvid.find(rec.source) == graph.vid2lvid.end()) {
-              if (vid2lvid_buffer.find(rec.source) == vid2lvid_buffer.end()) {
-                source_lvid = lvid_start + vid2lvid_buffer.size();
-                vid2lvid_buffer[rec.source] = source_lvid;
-              } else {
-                source_lvid = vid2lvid_buffer[rec.source];
-              }
-            } else {
-              source_lvid = graph.vid2lvid[rec.source];
-              updated_lvids.set_bit(source_lvid);
-            }
-            // Get the target_lvid;
-            lvid_type target_lvid(-1);
-            if(graph.vid2lvid.find(rec.target) == graph.vid2lvid.end()) {
-              if (vid2lvid_buffer.find(rec.target) == vid2lvid_buffer.end()) {
-                target_lvid = lvid_start + vid2lvid_buffer.size();
-                vid2lvid_buffer[rec.target] = target_lvid;
-              } else {
-                target_lvid = vid2lvid_buffer[rec.target];
-              }
-            } else {
-              target_lvid = graph.vid2lvid[rec.target];
-              updated_lvids.set_bit(target_lvid);
-            }
-            graph.local_graph.add_edge(source_lvid, target_lvid, rec.edata);
-            // std::cout << "add edge " << rec.source << "\t" << rec.target << std::endl;
-//            std::cout << rpc.procid() << " add edge " << rec.source << "\t" << rec.target << std::endl;
+            add_local_edge(rec.source, rec.target, rec.edata,
+                           vid2lvid_buffer, lvid_start, updated_lvids);
           } // end of loop over add edges
         } // end for loop over buffers
         edge_exchange.clear();
 
         ASSERT_EQ(graph.vid2lvid.size()  + vid2lvid_buffer.size(), graph.local_graph.num_vertices());
+      }
+
+      {
         if(rpc.procid() == 0)  {
           memory_info::log_usage("Finished populating local graph.");
         }
 
         // Finalize local graph
-        logstream(LOG_INFO) << "Graph Finalize: finalizing local graph." 
-                            << std::endl;
-        graph.local_graph.finalize();
+        if (!local_graph_built) {
+          logstream(LOG_INFO) << "Graph Finalize: finalizing local graph." 
+                              << std::endl;
+          graph.local_graph.finalize();
+        }
         logstream(LOG_INFO) << "Local graph info: " << std::endl
                             << "\t nverts: " << graph.local_graph.num_vertices()
                             << std::endl
@@ -592,6 +640,39 @@ namespace graphlab {
   private:
     boost::function<void(vertex_data_type&, const vertex_data_type&)> vertex_combine_strategy;
 
+    /// Receive handler of edge_exchange when edges are spilled
+    void spill_edges(procid_t proc,
+                     typename buffered_exchange<edge_buffer_record>::buffer_type& edges) {
+      edge_spill->add_records(edges);
+    }
+
+    /**
+     * \brief Adds an edge to the local graph, numbering the endpoints
+     * that are not in the graph yet from lvid_start on.
+     */
+    void add_local_edge(vertex_id_type source, vertex_id_type target,
+                        const EdgeData& edata,
+                        typename graph_type::hopscotch_map_type& vid2lvid_buffer,
+                        lvid_type lvid_start, dense_bitset& updated_lvids) {
+      lvid_type lvid[2];
+      const vertex_id_type vid[2] = {source, target};
+      for (size_t i = 0; i < 2; ++i) {
+        if(graph.vid2lvid.find(vid[i]) == graph.vid2lvid.end()) {
+          if (vid2lvid_buffer.find(vid[i]) == vid2lvid_buffer.end()) {
+            lvid[i] = lvid_start + vid2lvid_buffer.size();
+            vid2lvid_buffer[vid[i]] = lvid[i];
+          } else {
+            lvid[i] = vid2lvid_buffer[vid[i]];
+          }
+        } else {
+          lvid[i] = graph.vid2lvid[vid[i]];
+          updated_lvids.set_bit(lvid[i]);
+        }
+      }
+      graph.local_graph.add_edge(lvid[0], lvid[1], edata);
+    }
+
+
     /**
      * \brief Gather the vertex distributed meta data.
      */
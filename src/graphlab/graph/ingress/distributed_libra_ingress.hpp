@@ -24,11 +24,11 @@
 #define GRAPHLAB_DISTRIBUTED_LIBRA_INGRESS_HPP
 
 #include <boost/functional/hash.hpp>
-#include <boost/dynamic_bitset.hpp>
 
 #include <graphlab/rpc/buffered_exchange.hpp>
 #include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/graph/ingress/distributed_ingress_base.hpp>
+#include <graphlab/graph/ingress/sparse_vid_set.hpp>
 #include <graphlab/graph/distributed_graph.hpp>
 #include <graphlab/graph/graph_hash.hpp>
 #include <graphlab/rpc/buffered_exchange.hpp>
@@ -134,6 +134,13 @@ namespace graphlab {
 
     ~distributed_libra_ingress() { }
 
+    void set_exchange_compression(bool enable) {
+      base_type::set_exchange_compression(enable);
+      edge_exchange.set_compression(enable);
+      vertex_exchange.set_compression(enable);
+      vertex_degree_exchange.set_compression(enable);
+    }
+
     /** Add an edge to the ingress object using random assignment. */
     void add_edge(vertex_id_type source, vertex_id_type target,
                   const EdgeData& edata) {
@@ -216,6 +223,8 @@ namespace graphlab {
       /*                                                                        */
       /**************************************************************************/
       edge_exchange.flush(); vertex_exchange.flush();
+      edge_exchange.get_compression().report("Libra edge exchange");
+      vertex_exchange.get_compression().report("Libra vertex exchange");
 
       /**
        * Fast pass for redundant finalization with no graph changes.
@@ -244,7 +253,7 @@ namespace graphlab {
             procid_t proc = -1;
             edge_recv_buffer.reserve(edge_exchange.size());
             edge_buffer_type edge_buffer;
-            std::vector< boost::dynamic_bitset<> > degree_exchange_set(rpc.numprocs());
+            std::vector<sparse_vid_set> degree_exchange_set(rpc.numprocs());
             while(edge_exchange.recv(proc, edge_buffer)) {
               foreach(const edge_buffer_record& rec, edge_buffer) {
                 edge_recv_buffer.push_back(rec);
@@ -254,32 +263,40 @@ namespace graphlab {
                 if(rec.hash_flag == 1) {
                     // this proc is the source vertex hashed to
                     const procid_t owning_proc = graph_hash::hash_vertex(rec.target, rseed) % rpc.numprocs();
-                    if(degree_exchange_set[owning_proc].size() < (rec.source + 1))
-                      degree_exchange_set[owning_proc].resize(rec.source + 1);
-                    degree_exchange_set[owning_proc][rec.source] = true;
+                    degree_exchange_set[owning_proc].insert(rec.source);
                 }
                 else if(rec.hash_flag == 2) {
                     // this proc is the target vertex hashed to
                     const procid_t owning_proc = graph_hash::hash_vertex(rec.source, rseed) % rpc.numprocs();
-                    if(degree_exchange_set[owning_proc].size() < (rec.target + 1))
-                      degree_exchange_set[owning_proc].resize(rec.target + 1);
-                    degree_exchange_set[owning_proc][rec.target] = true;
+                    degree_exchange_set[owning_proc].insert(rec.target);
                 }
               }
             }
             edge_exchange.clear();
 
+            // stream the degrees out in chunks, applying the degrees received
+            // meanwhile. These are degrees of vertices owned by other machines,
+            // so they never overwrite a degree which is still to be sent.
+            vertex_degree_buffer_type vertex_degree_buffer;
+            size_t nsent = 0;
             for(size_t idx = 0; idx < degree_exchange_set.size(); idx++) {
-                for(size_t vid = degree_exchange_set[idx].find_first();
-                    vid != degree_exchange_set[idx].npos;
-                    vid = degree_exchange_set[idx].find_next(vid)) {
+                foreach(const vertex_id_type vid, degree_exchange_set[idx].sorted_ids()) {
                     const vertex_degree_buffer_record record(vid, degree_set[vid]);
                     vertex_degree_exchange.send(idx, record);
+                    if(++nsent % DEGREE_EXCHANGE_CHUNK == 0) {
+                      while(vertex_degree_exchange.recv(proc, vertex_degree_buffer, true)) {
+                        foreach(const vertex_degree_buffer_record& rec, vertex_degree_buffer) {
+                          degree_set[rec.vid] = rec.degree;
+                        }
+                      }
+                    }
                 }
+                degree_exchange_set[idx].clear();
             }
             vertex_degree_exchange.flush();
+            vertex_degree_exchange.get_compression().report(
+                "Libra degree exchange");
 
-            vertex_degree_buffer_type vertex_degree_buffer;
             while(vertex_degree_exchange.recv(proc, vertex_degree_buffer)) {
                 foreach(const vertex_degree_buffer_record& rec, vertex_degree_buffer) {
                   degree_set[rec.vid] = rec.degree;
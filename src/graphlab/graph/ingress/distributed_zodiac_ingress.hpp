@@ -24,11 +24,12 @@
 #define GRAPHLAB_DISTRIBUTED_ZODIAC_INGRESS_HPP
 
 #include <boost/functional/hash.hpp>
-#include <boost/dynamic_bitset.hpp>
 #include <boost/unordered_set.hpp>
 
 #include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/graph/ingress/distributed_ingress_base.hpp>
+#include <graphlab/graph/ingress/sparse_vid_set.hpp>
+#include <graphlab/graph/ingress/sharded_mirror_table.hpp>
 #include <graphlab/graph/distributed_graph.hpp>
 #include <graphlab/graph/graph_hash.hpp>
 #include <graphlab/rpc/buffered_exchange.hpp>
@@ -37,6 +38,7 @@
 #include <graphlab/logger/logger.hpp>
 #include <graphlab/util/dense_bitset.hpp>
 #include <vector>
+#include <algorithm>
 
 #include <graphlab/macros_def.hpp>
 namespace graphlab {
@@ -73,8 +75,10 @@ namespace graphlab {
 
     /// threshold to divide high-degree and low-degree vertices
     size_t threshold;
-    /// interval to synchronize the mht
+    /// number of edges a thread places between two batches of mirrors
     size_t interval;
+    /// number of threads placing edges in sync_assign
+    size_t nthreads;
 
 //    typedef typename base_type::edge_buffer_record edge_buffer_record;
     struct edge_buffer_record {
@@ -97,15 +101,14 @@ namespace graphlab {
     typedef typename buffered_exchange<vertex_buffer_record>::buffer_type
         vertex_buffer_type;
 
-    typedef fixed_dense_bitset<RPC_MAX_N_PROCS> bin_counts_type;
+    typedef fixed_dense_bitset<RPC_DENSE_MAX_N_PROCS> bin_counts_type;
 
     /** Type of the mirror hash table:
      * a map from vertex id to a bitset of length num_procs. */
-    typedef typename boost::unordered_map<vertex_id_type, bin_counts_type>
-    mht_type;
+    typedef sharded_mirror_table<bin_counts_type> mht_type;
 
     /** distributed hash table stored on local machine */
-    boost::unordered_map<vertex_id_type, bin_counts_type > mht;
+    mht_type mht;
 
     typedef typename boost::unordered_map<vertex_id_type,
       std::vector<edge_buffer_record> > raw_map_type;
@@ -118,21 +121,8 @@ namespace graphlab {
       void load(iarchive& arc) { arc >> vid >> pid; }
       void save(oarchive& arc) const { arc << vid << pid; }
     };
-    buffered_exchange<mirror_buffer_record> mirror_exchange;
-    typedef typename buffered_exchange<mirror_buffer_record>::buffer_type
-      mirror_buffer_type;
-
-    struct proc_edges_incre_record {
-      procid_t pid;
-      size_t increment;
-      proc_edges_incre_record(const procid_t& pid = procid_t(-1), const size_t& increment = 0)
-        :pid(pid), increment(increment) { }
-      void load(iarchive& arc) { arc >> pid >> increment; }
-      void save(oarchive& arc) const { arc << pid << increment; }
-    };
-    buffered_exchange<proc_edges_incre_record> proc_edges_incre_exchange;
-    typedef typename buffered_exchange<proc_edges_incre_record>::buffer_type
-      proc_edges_incre_buffer_type;
+    /// the most new mirrors a thread buffers before sending them
+    static const size_t MIRROR_BATCH_SIZE = 4096;
 
     /* ingress exchange */
     buffered_exchange<edge_buffer_record> edge_exchange;
@@ -156,9 +146,11 @@ namespace graphlab {
     distributed_zodiac_ingress(distributed_control& dc, graph_type& graph, size_t threshold = 0, size_t interval = 10) :
     base_type(dc, graph), rpc(dc, this),
     graph(graph), threshold(threshold), interval(interval),
-    vertex_exchange(dc), edge_exchange(dc),
-    mirror_exchange(dc), proc_edges_incre_exchange(dc)
+    nthreads(num_threads()), mht(16 * nthreads),
+    edge_exchange(dc, nthreads), vertex_exchange(dc)
     {
+      ASSERT_MSG(dc.numprocs() <= RPC_DENSE_MAX_N_PROCS,
+                 "Zodiac ingress supports at most %d processes", RPC_DENSE_MAX_N_PROCS);
       /* fast pass for standalone case. */
       if(this->threshold < rpc.numprocs())
         this->threshold = rpc.numprocs();
@@ -168,6 +160,21 @@ namespace graphlab {
 
     ~distributed_zodiac_ingress() { }
 
+    void set_exchange_compression(bool enable) {
+      base_type::set_exchange_compression(enable);
+      edge_exchange.set_compression(enable);
+      vertex_exchange.set_compression(enable);
+    }
+
+    /// The number of threads sync_assign places edges with
+    static size_t num_threads() {
+#ifdef _OPENMP
+      return omp_get_max_threads();
+#else
+      return 1;
+#endif
+    }
+
     /** Add an edge to the ingress object using random assignment. */
     void add_edge(vertex_id_type source, vertex_id_type target,
                   const EdgeData& edata) {
@@ -205,176 +212,143 @@ namespace graphlab {
       vertex_exchange.send(owning_proc, record);
     } // end of add vertex
 
-    /** Greedy assign (source, target) to a machine using:
-     *  bitset<MAX_MACHINE> src_degree : the degree presence of source over machines
-     *  bitset<MAX_MACHINE> dst_degree : the degree presence of target over machines
-     *  vector<size_t>      proc_num_edges : the edge counts over machines
+    /** Degree aware assign (source, target) to a machine using:
+     *  bitset<MAX_MACHINE> src_mirror : the mirror presence of source over machines
+     *  bitset<MAX_MACHINE> dst_mirror : the mirror presence of target over machines
+     *  proc_load_tracker   proc_num_edges : the edge counts over machines
      * */
     procid_t edge_to_proc_degree (const vertex_id_type source,
         const vertex_id_type target,
         const bin_counts_type& src_mirror,
         const bin_counts_type& dst_mirror,
-        const std::vector<size_t>& proc_num_edges,
-        hopscotch_map<vertex_id_type, size_t>& degree_set) {
-      size_t numprocs = proc_num_edges.size();
-
-      // Compute the score of each proc.
-      procid_t best_proc = -1;
-      double maxscore = 0.0;
-      double epsilon = 1.0;
-      std::vector<double> proc_score(numprocs);
-      size_t minedges = *std::min_element(proc_num_edges.begin(), proc_num_edges.end());
-      size_t maxedges = *std::max_element(proc_num_edges.begin(), proc_num_edges.end());
-
-      size_t source_degree, target_degree;
-      source_degree = degree_set[source];
-      target_degree = degree_set[target];
+        const proc_load_tracker& proc_num_edges,
+        const hopscotch_map<vertex_id_type, size_t>& degree_set) {
+      // every endpoint of an edge in the assign buffers has a degree
+      const size_t source_degree = degree_set.find(source)->second;
+      const size_t target_degree = degree_set.find(target)->second;
 
       bool is_source_small = (target_degree >= source_degree);
       bool is_target_small = (target_degree <= source_degree);
-      for (size_t i = 0; i < numprocs; ++i) {
-        size_t sd = src_mirror.get(i);
-        size_t td = dst_mirror.get(i);
-        double bal = (maxedges - proc_num_edges[i])/(epsilon + maxedges - minedges);
-        bool sd1 = (sd > 0);
-        bool td1 = (td > 0);
-        bool sd2 = (sd1 && is_source_small);
-        bool td2 = (td1 && is_target_small);
-        bool d0 = (sd2 && td2);
-        proc_score[i] = bal + sd1 + sd2 + td1 + td2 - d0;
-      }
-      maxscore = *std::max_element(proc_score.begin(), proc_score.end());
+      return edge_placement_scorer::degree_aware(source, target,
+          src_mirror, dst_mirror, proc_num_edges,
+          is_source_small, is_target_small);
+    }
 
-      std::vector<procid_t> top_procs;
-      for (size_t i = 0; i < numprocs; ++i)
-        if (std::fabs(proc_score[i] - maxscore) < 1e-5)
-          top_procs.push_back(i);
+    /** Applies a batch of mirrors created on another machine. Runs on
+     *  the rpc handler threads while the local threads keep placing
+     *  edges, which the concurrent mirror table allows. */
+    void apply_mirror_batch(const std::vector<mirror_buffer_record>& batch) {
+      foreach(const mirror_buffer_record& rec, batch) {
+        mht[rec.vid].set_bit(rec.pid);
+      }
+    }
 
-      // Hash the edge to one of the best procs.
-      typedef std::pair<vertex_id_type, vertex_id_type> edge_pair_type;
-      const edge_pair_type edge_pair(std::min(source, target),
-          std::max(source, target));
-      best_proc = top_procs[graph_hash::hash_edge(edge_pair) % top_procs.size()];
+    /** Sends the mirrors a thread created since its last batch to every
+     *  other machine, sorted by vertex id with the duplicates removed. */
+    void send_mirror_batch(std::vector<mirror_buffer_record>& batch) {
+      if (batch.empty()) return;
+      std::sort(batch.begin(), batch.end(), mirror_record_less);
+      batch.erase(std::unique(batch.begin(), batch.end(), mirror_record_equal),
+                  batch.end());
+      for (procid_t p = 0; p < rpc.numprocs(); ++p) {
+        if (p != rpc.procid())
+          rpc.remote_call(p, &distributed_zodiac_ingress::apply_mirror_batch, batch);
+      }
+      batch.clear();
+    }
 
-      return best_proc;
+    static bool mirror_record_less(const mirror_buffer_record& a,
+                                   const mirror_buffer_record& b) {
+      return a.vid < b.vid || (a.vid == b.vid && a.pid < b.pid);
+    }
+    static bool mirror_record_equal(const mirror_buffer_record& a,
+                                    const mirror_buffer_record& b) {
+      return a.vid == b.vid && a.pid == b.pid;
     }
 
-    void sync_assign(hopscotch_map<vertex_id_type, size_t>& degree_set,
+    /** Places the edges of edge_buffer on all threads. Each thread takes
+     *  a contiguous slice and balances it against a private copy of
+     *  proc_num_edges, while the mirror table is shared. The mirrors a
+     *  thread creates are sent to the other machines in one batch every
+     *  interval edges (or MIRROR_BATCH_SIZE new mirrors), so a machine
+     *  places edges knowing every remote mirror that is older than that
+     *  bound. The placement depends on the thread interleaving and on the
+     *  arrival of the batches.
+     */
+    void sync_assign(const hopscotch_map<vertex_id_type, size_t>& degree_set,
         const std::vector<edge_buffer_record>& edge_buffer,
-        std::vector<size_t>& proc_num_edges) {
-      procid_t l_procid = rpc.procid();
-      procid_t proc(-1);
-//      std::vector<size_t> proc_incre_edges(rpc.numprocs());
-//      foreach(size_t& num_edges, proc_incre_edges) {
-//        num_edges = 0;
-//      }
-      size_t edge_count = 0;
-      foreach(const edge_buffer_record& rec, edge_buffer) {
-        if(mht.count(rec.source) == 0)
-          mht[rec.source].clear();
-        if(mht.count(rec.target) == 0)
-          mht[rec.target].clear();
-        const procid_t best_pid = edge_to_proc_degree(rec.source, rec.target,
-                                    mht[rec.source], mht[rec.target],
-                                    proc_num_edges, degree_set);
-
-        edge_exchange.send(best_pid, rec);
-
-        if(mht[rec.source].get(best_pid) == false) {
-            const mirror_buffer_record mirror_record(rec.source, best_pid);
-            for(procid_t pid = 0; pid < rpc.numprocs(); pid++) {
-              if(pid == l_procid)
-                mht[rec.source].set_bit(best_pid);
-              else {
-                mirror_exchange.send(pid, mirror_record);
-//                      mirror_exchange.partial_flush(0);
-              }
-            }
+        proc_load_tracker& proc_num_edges) {
+      const size_t nprocs = rpc.numprocs();
+      std::vector<proc_load_tracker> thread_num_edges(nthreads, proc_num_edges);
+      size_t nbatches = 0;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads) reduction(+ : nbatches)
+#endif
+      {
+#ifdef _OPENMP
+        const size_t thread_id = omp_get_thread_num();
+        const size_t nworkers = omp_get_num_threads();
+#else
+        const size_t thread_id = 0;
+        const size_t nworkers = 1;
+#endif
+        proc_load_tracker& loads = thread_num_edges[thread_id];
+        std::vector<mirror_buffer_record> batch;
+        size_t batch_edges = 0;
+        const size_t begin = edge_buffer.size() * thread_id / nworkers;
+        const size_t end = edge_buffer.size() * (thread_id + 1) / nworkers;
+        for (size_t i = begin; i < end; ++i) {
+          const edge_buffer_record& rec = edge_buffer[i];
+          bin_counts_type& src_mirror = mht[rec.source];
+          bin_counts_type& dst_mirror = mht[rec.target];
+          const procid_t best_pid = edge_to_proc_degree(rec.source, rec.target,
+                                      src_mirror, dst_mirror,
+                                      loads, degree_set);
+
+          edge_exchange.send(best_pid, rec, thread_id);
+          if (!src_mirror.set_bit(best_pid))
+            batch.push_back(mirror_buffer_record(rec.source, best_pid));
+          if (!dst_mirror.set_bit(best_pid))
+            batch.push_back(mirror_buffer_record(rec.target, best_pid));
+          loads.increment(best_pid);
+
+          if(++batch_edges >= interval || batch.size() >= MIRROR_BATCH_SIZE) {
+            nbatches += !batch.empty();
+            send_mirror_batch(batch);
+            batch_edges = 0;
+          }
         }
+        nbatches += !batch.empty();
+        send_mirror_batch(batch);
+      }
 
-        if(mht[rec.target].get(best_pid) == false) {
-            const mirror_buffer_record mirror_record(rec.target, best_pid);
-            for(procid_t pid = 0; pid < rpc.numprocs(); pid++) {
-              if(pid == l_procid)
-                mht[rec.target].set_bit(best_pid);
-              else {
-                mirror_exchange.send(pid, mirror_record);
-//                      mirror_exchange.partial_flush(0);
-              }
-            }
-        }
+      // wait for the batches of every machine to be applied ...
+      rpc.full_barrier();
 
-        proc_num_edges[best_pid]++;
-//        proc_incre_edges[best_pid]++;
-
-        if(edge_count % interval == 0) {
-//          // send the increment of proc_num_edges
-//          for (procid_t p = 0; p < rpc.numprocs(); p++) {
-//            const proc_edges_incre_record edges_incre_record(p, proc_incre_edges[p]);
-//            for (procid_t i = 0; i < rpc.numprocs(); i++)
-//              if (i != l_procid)
-//                proc_edges_incre_exchange.send(i, edges_incre_record);
-//            proc_incre_edges[p] = 0;
-//          }
-
-          // flush increment and mirrors
-//          proc_edges_incre_exchange.partial_flush(0);
-          mirror_exchange.partial_flush(0);
-
-//          // update number of edges
-//          if(proc_edges_incre_exchange.size() > 0) {
-//              proc_edges_incre_buffer_type proc_edges_incre_buffer;
-//              proc = -1;
-//              while(proc_edges_incre_exchange.recv(proc, proc_edges_incre_buffer)) {
-//                  foreach(const proc_edges_incre_record& rec, proc_edges_incre_buffer) {
-//                    proc_num_edges[rec.pid] += rec.increment;
-//                  }
-//              } // end of while
-//              proc_edges_incre_exchange.clear();
-//          } // end of mirror_exchange.size() > 0
-
-          if(mirror_exchange.size() > 0) {
-              mirror_buffer_type mirror_buffer;
-              proc = -1;
-              while(mirror_exchange.recv(proc, mirror_buffer)) {
-                  foreach(const mirror_buffer_record& rec, mirror_buffer) {
-                    if(mht.count(rec.vid) == 0)
-                      mht[rec.vid].clear();
-                    mht[rec.vid].set_bit(rec.pid);
-                  }
-              } // end of while
-              mirror_exchange.clear();
-          } // end of mirror_exchange.size() > 0
-      } // end of internal
-
-        edge_count++;
-      } // end of foreach
-
-      // synchronize the residual ...
-      mirror_exchange.flush();
-      if(mirror_exchange.size() > 0) {
-          mirror_buffer_type mirror_buffer;
-          proc = -1;
-          while(mirror_exchange.recv(proc, mirror_buffer)) {
-              foreach(const mirror_buffer_record& rec, mirror_buffer) {
-                if(mht.count(rec.vid) == 0)
-                  mht[rec.vid].clear();
-                mht[rec.vid].set_bit(rec.pid);
-              }
-          } // end of while
-          mirror_exchange.clear();
-      } // end of mirror_exchange.size() > 0
-//      proc_edges_incre_exchange.flush();
-//      if(proc_edges_incre_exchange.size() > 0) {
-//          proc_edges_incre_buffer_type proc_edges_incre_buffer;
-//          proc = -1;
-//          while(proc_edges_incre_exchange.recv(proc, proc_edges_incre_buffer)) {
-//              foreach(const proc_edges_incre_record& rec, proc_edges_incre_buffer) {
-//                proc_num_edges[rec.pid] += rec.increment;
-//              }
-//          } // end of while
-//          proc_edges_incre_exchange.clear();
-//      } // end of mirror_exchange.size() > 0
+      // ... and add the edges placed by every thread to the loads
+      std::vector<size_t> placed(nprocs, 0);
+      for (size_t t = 0; t < thread_num_edges.size(); ++t) {
+        for (procid_t p = 0; p < nprocs; ++p)
+          placed[p] += thread_num_edges[t][p] - proc_num_edges[p];
+      }
+      for (procid_t p = 0; p < nprocs; ++p)
+        proc_num_edges.add(p, placed[p]);
+
+      if (rpc.procid() == 0) {
+        size_t nverts = 0, nmirrors = 0;
+        for (size_t shard = 0; shard < mht.num_shards(); ++shard) {
+          foreach(const typename mht_type::entry_type& entry,
+                  mht.shard_entries(shard)) {
+            ++nverts;
+            nmirrors += entry.second.popcount();
+          }
+        }
+        logstream(LOG_INFO) << "Mirror sync: interval = " << interval
+                            << " edges, " << nbatches << " batches sent, "
+                            << "replication factor of the assigned edges: "
+                            << (nverts ? (double)nmirrors / nverts : 0.0)
+                            << std::endl;
+      }
     }
 
     void finalize() {
@@ -467,7 +441,7 @@ namespace graphlab {
             edge_recv_buffer.reserve(edge_exchange.size());
             edge_buffer_type edge_buffer;
             // count degree
-            std::vector< boost::dynamic_bitset<> > degree_exchange_set(nprocs);
+            std::vector<sparse_vid_set> degree_exchange_set(nprocs);
             while(edge_exchange.recv(proc, edge_buffer)) {
               foreach(const edge_buffer_record& rec, edge_buffer) {
 //                if(rec.hash_flag == 0 || ((rec.source >= rec.target) + 1) == rec.hash_flag)
@@ -479,16 +453,12 @@ namespace graphlab {
                 if(rec.hash_flag == 1) {
                     // this proc is the source vertex hashed to and target_id < source_id
                     const procid_t owning_proc = graph_hash::hash_vertex(rec.target) % nprocs;
-                    if(degree_exchange_set[owning_proc].size() < (rec.source + 1))
-                      degree_exchange_set[owning_proc].resize(rec.source + 1);
-                    degree_exchange_set[owning_proc][rec.source] = true;
+                    degree_exchange_set[owning_proc].insert(rec.source);
                 }
                 else if(rec.hash_flag == 2) {
                     // this proc is the target vertex hashed to
                     const procid_t owning_proc = graph_hash::hash_vertex(rec.source) % nprocs;
-                    if(degree_exchange_set[owning_proc].size() < (rec.target + 1))
-                      degree_exchange_set[owning_proc].resize(rec.target + 1);
-                    degree_exchange_set[owning_proc][rec.target] = true;
+                    degree_exchange_set[owning_proc].insert(rec.target);
                 }
 
               }
@@ -496,17 +466,27 @@ namespace graphlab {
             edge_exchange.clear();
 
             // send degree
+            // stream the degrees out in chunks, applying the degrees received
+            // meanwhile. These are degrees of vertices owned by other machines,
+            // so they never overwrite a degree which is still to be sent.
+            vertex_degree_buffer_type vertex_degree_buffer;
+            size_t nsent = 0;
             for(size_t idx = 0; idx < degree_exchange_set.size(); idx++) {
-                for(size_t vid = degree_exchange_set[idx].find_first();
-                    vid != degree_exchange_set[idx].npos;
-                    vid = degree_exchange_set[idx].find_next(vid)) {
+                foreach(const vertex_id_type vid, degree_exchange_set[idx].sorted_ids()) {
                     const vertex_degree_buffer_record record(vid, degree_set[vid]);
                     vertex_degree_exchange.send(idx, record);
+                    if(++nsent % DEGREE_EXCHANGE_CHUNK == 0) {
+                      while(vertex_degree_exchange.recv(proc, vertex_degree_buffer, true)) {
+                        foreach(const vertex_degree_buffer_record& rec, vertex_degree_buffer) {
+                          degree_set[rec.vid] = rec.degree;
+                        }
+                      }
+                    }
                 }
+                degree_exchange_set[idx].clear();
             }
             vertex_degree_exchange.flush();
 
-            vertex_degree_buffer_type vertex_degree_buffer;
             proc = -1;
             while(vertex_degree_exchange.recv(proc, vertex_degree_buffer)) {
                 foreach(const vertex_degree_buffer_record& rec, vertex_degree_buffer) {
@@ -562,10 +542,7 @@ namespace graphlab {
 //            rpc.full_barrier();
 
             // initialize
-            std::vector<size_t> proc_num_edges(nprocs);
-            foreach(size_t& num_edges, proc_num_edges) {
-              num_edges = 0;
-            }
+            proc_load_tracker proc_num_edges(nprocs);
 
             // assign the low edges
             rpc.full_barrier();
@@ -574,35 +551,32 @@ namespace graphlab {
             std::vector<edge_buffer_record>().swap(low_edge_buffer);
 
             // set up the map from vid to its master proc
-            for(mht_type::iterator it = mht.begin(); it != mht.end(); it++) {
-//                if(graph_hash::hash_vertex(it->first) % nprocs == l_procid) {
-                    std::vector<procid_t> master_candidates;
-                    for(size_t idx = 0; idx < nprocs; idx++) {
-                        if(it->second.get(idx) > 0)
-                          master_candidates.push_back(idx);
-                    }
-                    master_map[it->first] = master_candidates[graph_hash::hash_vertex(it->first) % master_candidates.size()];
-                    // for debug
-//                    std::cout << l_procid << ":\t" << it->first << ":\t" << master_map[it->first] << std::endl;
-//                }
+            for(size_t shard = 0; shard < mht.num_shards(); ++shard) {
+              foreach(const typename mht_type::entry_type& entry,
+                      mht.shard_entries(shard)) {
+                std::vector<procid_t> master_candidates;
+                for(size_t idx = 0; idx < nprocs; idx++) {
+                  if(entry.second.get(idx) > 0)
+                    master_candidates.push_back(idx);
+                }
+                master_map[entry.first] = master_candidates[graph_hash::hash_vertex(entry.first) % master_candidates.size()];
+              }
             }
 
             // assign high edges
             foreach(const edge_buffer_record& rec, high_edge_buffer) {
-              if(mht.count(rec.source) == 0)
-                mht[rec.source].clear();
-              if(mht.count(rec.target) == 0)
-                mht[rec.target].clear();
+              bin_counts_type& src_mirror = mht[rec.source];
+              bin_counts_type& dst_mirror = mht[rec.target];
               const procid_t best_pid = edge_to_proc_degree(rec.source, rec.target,
-                                          mht[rec.source], mht[rec.target],
+                                          src_mirror, dst_mirror,
                                           proc_num_edges, degree_set);
 
               edge_exchange.send(best_pid, rec);
 
-              mht[rec.source].set_bit(best_pid);
-              mht[rec.target].set_bit(best_pid);
+              src_mirror.set_bit(best_pid);
+              dst_mirror.set_bit(best_pid);
 
-              proc_num_edges[best_pid]++;
+              proc_num_edges.increment(best_pid);
             }
 //            sync_assign(degree_set, high_edge_buffer, proc_num_edges);
 
@@ -610,6 +584,8 @@ namespace graphlab {
 
         } // end of if (!standalone)
       } // end of Prepare zodiac ingress
+      edge_exchange.get_compression().report("Zodiac edge exchange");
+      vertex_exchange.get_compression().report("Zodiac vertex exchange");
 
       /**************************************************************************/
       /*                                                                        */
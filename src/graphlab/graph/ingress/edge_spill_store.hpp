@@ -0,0 +1,377 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_EDGE_SPILL_STORE_HPP
+#define GRAPHLAB_EDGE_SPILL_STORE_HPP
+
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/graph/ingress/sparse_vid_set.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/util/stl_util.hpp>
+
+namespace graphlab {
+
+  /**
+   * \brief Stores the edges received during ingress on local disk as
+   * sorted runs, and reads them back in (source, target) order.
+   *
+   * Edges are collected in memory until run_edges of them are buffered.
+   * The full buffer is then handed to a background writer thread, which
+   * sorts it and writes it to its own file, so that adding threads (the
+   * RPC handlers of the edge exchange) do not wait on the sort and the
+   * disk. At most MAX_PENDING_RUNS full runs wait for the writer, and
+   * adding threads block while the queue is full. A merge_reader
+   * performs a k-way merge of all the runs once flush() has joined the
+   * writer. The run files are removed by clear() and by the destructor.
+   */
+  template <typename EdgeData>
+  class edge_spill_store {
+  public:
+    struct edge_record {
+      vertex_id_type source, target;
+      EdgeData edata;
+      edge_record(vertex_id_type source = vertex_id_type(-1),
+                  vertex_id_type target = vertex_id_type(-1),
+                  const EdgeData& edata = EdgeData()) :
+        source(source), target(target), edata(edata) { }
+      bool operator<(const edge_record& other) const {
+        return source < other.source ||
+          (source == other.source && target < other.target);
+      }
+      void load(iarchive& arc) { arc >> source >> target >> edata; }
+      void save(oarchive& arc) const { arc << source << target << edata; }
+    };
+
+    /** Runs are written to files named prefix.<pid>.<run>. Each run
+     *  holds run_edges edges. */
+    edge_spill_store(const std::string& prefix, size_t run_edges) :
+      prefix(prefix + "." + tostr(getpid())),
+      run_edges(std::max(run_edges, size_t(1))), nruns(0), nadded(0),
+      writer(NULL), stopping(false) { }
+
+    ~edge_spill_store() { clear(); }
+
+    /** Adds the edges of records, which have source, target and edata
+     *  fields. Safe to call from several threads. */
+    template <typename RecordVector>
+    void add_records(const RecordVector& records) {
+      lock.lock();
+      for (size_t i = 0; i < records.size(); ++i) {
+        buffer.push_back(edge_record(records[i].source, records[i].target,
+                                     records[i].edata));
+      }
+      nadded += records.size();
+      if (buffer.size() >= run_edges) {
+        std::vector<edge_record>* full = new std::vector<edge_record>();
+        full->swap(buffer);
+        queue_run(full);
+      }
+      lock.unlock();
+    }
+
+    /** Waits for the writer and writes the edges still in memory to a
+     *  run. Must not be called while other threads add edges. */
+    void flush() {
+      join_writer();
+      if (buffer.empty()) return;
+      std::vector<edge_record> full;
+      full.swap(buffer);
+      write_run(nruns++, full);
+    }
+
+    /// The number of edges added since the last clear()
+    size_t num_edges() const {
+      lock.lock();
+      const size_t ret = nadded;
+      lock.unlock();
+      return ret;
+    }
+
+    /// Removes all the runs
+    void clear() {
+      join_writer();
+      for (size_t i = 0; i < nruns; ++i) {
+        std::remove(run_filename(i).c_str());
+      }
+      nruns = 0;
+      nadded = 0;
+      std::vector<edge_record>().swap(buffer);
+    }
+
+    /**
+     * Builds an empty local graph from the edges of a flushed store
+     * without buffering them in memory, and numbers its vertices in
+     * vid2lvid. The vertex data is default constructed.
+     *
+     * The first merge pass numbers the vertices in increasing vid
+     * order, so the merged order, sorted by source vid, is also sorted
+     * by source lvid. The second pass writes the out edges straight
+     * into the CSR arrays and the in edges are derived from them.
+     */
+    template <typename LocalGraph, typename Vid2LvidMap>
+    void build_local_graph(LocalGraph& lgraph, Vid2LvidMap& vid2lvid) const {
+      typedef typename LocalGraph::vertex_data_type vertex_data_type;
+      edge_record rec;
+      std::vector<vertex_id_type> vids;
+      {
+        sparse_vid_set vid_set;
+        merge_reader reader(*this);
+        while (reader.next(rec)) {
+          vid_set.insert(rec.source);
+          vid_set.insert(rec.target);
+        }
+        vids = vid_set.sorted_ids();
+      }
+      for (size_t i = 0; i < vids.size(); ++i) vid2lvid[vids[i]] = i;
+
+      const size_t nedges = num_edges();
+      std::vector<EdgeData> edata;
+      std::vector<edge_id_type> csr_ptr, csr_eid, csc_ptr, csc_eid;
+      std::vector<lvid_type> csr_nbr, csc_nbr;
+      std::vector<edge_id_type> in_degree(vids.size(), 0);
+      edata.reserve(nedges); csr_nbr.reserve(nedges);
+      {
+        merge_reader reader(*this);
+        lvid_type source_lvid = 0;
+        while (reader.next(rec)) {
+          while (vids[source_lvid] < rec.source) ++source_lvid;
+          const lvid_type target_lvid = vid2lvid[rec.target];
+          // only vertices up to the last one with neighbors carry an offset
+          if (csr_ptr.size() <= source_lvid)
+            csr_ptr.resize(source_lvid + 1, csr_nbr.size());
+          csr_nbr.push_back(target_lvid);
+          edata.push_back(rec.edata);
+          ++in_degree[target_lvid];
+        }
+      }
+      csr_eid.resize(csr_nbr.size());
+      for (size_t i = 0; i < csr_eid.size(); ++i) csr_eid[i] = i;
+
+      // in_degree becomes the next free csc slot of every vertex
+      edge_id_type offset = 0;
+      for (size_t v = 0; v < in_degree.size(); ++v) {
+        const edge_id_type degree = in_degree[v];
+        if (degree > 0) csc_ptr.resize(v + 1, offset);
+        in_degree[v] = offset;
+        offset += degree;
+      }
+      csc_nbr.resize(csr_nbr.size()); csc_eid.resize(csr_nbr.size());
+      for (size_t v = 0; v < csr_ptr.size(); ++v) {
+        const size_t end = v + 1 < csr_ptr.size() ? csr_ptr[v + 1] : csr_nbr.size();
+        for (size_t e = csr_ptr[v]; e < end; ++e) {
+          const edge_id_type slot = in_degree[csr_nbr[e]]++;
+          csc_nbr[slot] = v;
+          csc_eid[slot] = e;
+        }
+      }
+      std::vector<edge_id_type>().swap(in_degree);
+
+      std::vector<vertex_data_type> vdata(vids.size());
+      lgraph.load_adjacency(vdata, edata, csr_ptr, csr_nbr, csr_eid,
+                            csc_ptr, csc_nbr, csc_eid);
+    }
+
+    /**
+     * Reads all the edges of a flushed store in (source, target) order.
+     * \code
+     *   typename edge_spill_store<E>::merge_reader reader(store);
+     *   typename edge_spill_store<E>::edge_record rec;
+     *   while (reader.next(rec)) { ... }
+     * \endcode
+     */
+    class merge_reader {
+    public:
+      explicit merge_reader(const edge_spill_store& store) :
+        heads(store.nruns), remaining(store.nruns, 0) {
+        for (size_t i = 0; i < store.nruns; ++i) {
+          const std::string fname = store.run_filename(i);
+          files.push_back(new std::ifstream(fname.c_str(), std::ios::binary));
+          if (!files.back()->good()) {
+            logstream(LOG_FATAL) << "Cannot open edge spill file " << fname
+                                 << std::endl;
+          }
+          archives.push_back(new iarchive(*files.back()));
+          (*archives.back()) >> remaining[i];
+          if (advance(i)) heap.push_back(i);
+        }
+        std::make_heap(heap.begin(), heap.end(), head_greater(heads));
+      }
+
+      ~merge_reader() {
+        for (size_t i = 0; i < files.size(); ++i) {
+          delete archives[i];
+          delete files[i];
+        }
+      }
+
+      /// Reads the next edge into rec. Returns false after the last one.
+      bool next(edge_record& rec) {
+        if (heap.empty()) return false;
+        std::pop_heap(heap.begin(), heap.end(), head_greater(heads));
+        const size_t run = heap.back();
+        rec = heads[run];
+        if (advance(run)) {
+          std::push_heap(heap.begin(), heap.end(), head_greater(heads));
+        } else {
+          heap.pop_back();
+        }
+        return true;
+      }
+
+    private:
+      struct head_greater {
+        const std::vector<edge_record>& heads;
+        head_greater(const std::vector<edge_record>& heads) : heads(heads) { }
+        bool operator()(size_t a, size_t b) const { return heads[b] < heads[a]; }
+      };
+
+      std::vector<std::ifstream*> files;
+      std::vector<iarchive*> archives;
+      std::vector<edge_record> heads;
+      std::vector<size_t> remaining;
+      std::vector<size_t> heap;
+
+      // reads the next head of run i
+      bool advance(size_t i) {
+        if (remaining[i] == 0) return false;
+        read_record(*archives[i], heads[i]);
+        --remaining[i];
+        return true;
+      }
+    }; // end of merge_reader
+
+  private:
+    /// The most full runs waiting for the writer thread
+    static const size_t MAX_PENDING_RUNS = 2;
+
+    const std::string prefix;
+    const size_t run_edges;
+    mutex lock;
+    /// Signalled when a run is queued or taken, or the writer must stop
+    conditional cond;
+    std::vector<edge_record> buffer;
+    /// Full runs waiting for the writer, with their run numbers
+    std::deque<std::pair<size_t, std::vector<edge_record>*> > pending;
+    size_t nruns;
+    size_t nadded;
+    thread* writer;
+    bool stopping;
+
+    std::string run_filename(size_t run) const {
+      return prefix + "." + tostr(run);
+    }
+
+    /// Queues a full run for the writer. Called with the lock held.
+    void queue_run(std::vector<edge_record>* full) {
+      while (pending.size() >= MAX_PENDING_RUNS) cond.wait(lock);
+      pending.push_back(std::make_pair(nruns++, full));
+      if (writer == NULL) {
+        writer = new thread();
+        writer->launch(boost::bind(&edge_spill_store::write_pending_runs, this));
+      }
+      cond.broadcast();
+    }
+
+    /// Body of the writer thread
+    void write_pending_runs() {
+      lock.lock();
+      while (true) {
+        while (pending.empty() && !stopping) cond.wait(lock);
+        if (pending.empty()) break;
+        std::pair<size_t, std::vector<edge_record>*> run = pending.front();
+        pending.pop_front();
+        cond.broadcast();
+        lock.unlock();
+        write_run(run.first, *run.second);
+        delete run.second;
+        lock.lock();
+      }
+      lock.unlock();
+    }
+
+    /// Writes the queued runs and stops the writer thread
+    void join_writer() {
+      lock.lock();
+      thread* running = writer;
+      stopping = true;
+      cond.broadcast();
+      lock.unlock();
+      if (running == NULL) return;
+      running->join();
+      delete running;
+      lock.lock();
+      writer = NULL;
+      stopping = false;
+      lock.unlock();
+    }
+
+    // Records with POD edge data are copied as raw bytes. The runs are
+    // only read back by this process, so the layout needs no encoding.
+    static void write_records(oarchive& oarc, const std::vector<edge_record>& edges) {
+      if (gl_is_pod<EdgeData>::value) {
+        if (!edges.empty()) {
+          serialize(oarc, &edges[0], sizeof(edge_record) * edges.size());
+        }
+      } else {
+        for (size_t i = 0; i < edges.size(); ++i) oarc << edges[i];
+      }
+    }
+
+    static void read_record(iarchive& iarc, edge_record& rec) {
+      if (gl_is_pod<EdgeData>::value) {
+        deserialize(iarc, &rec, sizeof(edge_record));
+      } else {
+        iarc >> rec;
+      }
+    }
+
+    void write_run(size_t run, std::vector<edge_record>& edges) {
+      std::sort(edges.begin(), edges.end());
+      const std::string fname = run_filename(run);
+      std::ofstream fout(fname.c_str(), std::ios::binary);
+      oarchive oarc(fout);
+      oarc << edges.size();
+      write_records(oarc, edges);
+      fout.flush();
+      if (!fout.good()) {
+        logstream(LOG_FATAL) << "Cannot write edge spill file " << fname
+                             << std::endl;
+      }
+      std::vector<edge_record>().swap(edges);
+    }
+  }; // end of edge_spill_store
+
+} // end of namespace graphlab
+
+#endif
@@ -29,10 +29,199 @@
 #include <graphlab/util/dense_bitset.hpp>
 #include <boost/random/uniform_int_distribution.hpp>
 #include <math.h>
+#include <algorithm>
+#include <vector>
 
 namespace graphlab {
   template<typename VertexData, typename EdgeData>
   class distributed_graph;
+
+  /**
+   * \brief The number of edges assigned to each machine by a greedy
+   * ingress method.
+   *
+   * Next to the counts, the tracker maintains the smallest and largest
+   * count and the balance term of every machine,
+   * (max - count) / (1 + max - min), so that scoring an edge does not
+   * rescan the counts. The balance terms are recomputed only when the
+   * smallest or the largest count changes, which happens about once per
+   * numprocs increments when the placement is balanced.
+   */
+  class proc_load_tracker {
+  public:
+    explicit proc_load_tracker(size_t numprocs = 0) { resize(numprocs); }
+
+    /// Resets the counts of numprocs machines to zero
+    void resize(size_t numprocs) {
+      counts.assign(numprocs, 0);
+      balance.assign(numprocs, 0.0);
+      minload = maxload = 0;
+      nmin = numprocs;
+    }
+
+    size_t size() const { return counts.size(); }
+    size_t operator[](size_t p) const { return counts[p]; }
+    size_t min_load() const { return minload; }
+    size_t max_load() const { return maxload; }
+    /// The balance term of every machine
+    const double* balance_terms() const { return &balance[0]; }
+
+    /// Assigns n more edges to machine p
+    void add(size_t p, size_t n) {
+      if (n == 0) return;
+      counts[p] += n;
+      maxload = std::max(maxload, counts[p]);
+      minload = *std::min_element(counts.begin(), counts.end());
+      nmin = std::count(counts.begin(), counts.end(), minload);
+      for (size_t i = 0; i < counts.size(); ++i) balance[i] = term(i);
+    }
+
+    /// Assigns one more edge to machine p
+    void increment(size_t p) {
+      const size_t old = counts[p]++;
+      bool rescale = false;
+      if (old == maxload) {
+        ++maxload;
+        rescale = true;
+      }
+      if (old == minload && --nmin == 0) {
+        minload = *std::min_element(counts.begin(), counts.end());
+        nmin = std::count(counts.begin(), counts.end(), minload);
+        rescale = true;
+      }
+      if (rescale) {
+        for (size_t i = 0; i < counts.size(); ++i) balance[i] = term(i);
+      } else {
+        balance[p] = term(p);
+      }
+    }
+
+  private:
+    std::vector<size_t> counts;
+    std::vector<double> balance;
+    size_t minload, maxload;
+    /// number of machines whose count equals minload
+    size_t nmin;
+
+    double term(size_t p) const {
+      const double epsilon = 1.0;
+      return (maxload - counts[p])/(epsilon + maxload - minload);
+    }
+  }; // end of proc_load_tracker
+
+
+  /**
+   * \brief Scores the machines for an edge and picks the best one, for
+   * the greedy and the degree aware placement heuristics.
+   *
+   * The score of a machine is its balance term from a proc_load_tracker
+   * plus a locality term from the presence bitsets of the two endpoints.
+   * The edge is hashed to one of the machines with the top score. Scores
+   * live in fixed size arrays on the stack, so no memory is allocated per
+   * edge, and the presence bits are expanded a word at a time so the per
+   * machine loops are branch free and can be vectorized. The scores are
+   * the same as those of the original per edge vectors, so the placement
+   * does not change.
+   */
+  struct edge_placement_scorer {
+    typedef fixed_dense_bitset<RPC_DENSE_MAX_N_PROCS> bin_counts_type;
+    static const size_t MAX_PROCS = RPC_DENSE_MAX_N_PROCS;
+    static const size_t WORD_BITS = 8 * sizeof(size_t);
+
+    /** Greedy score: balance + (source present) + (target present).
+     *  If candidates is not NULL only the ncandidates machines it lists
+     *  are scored, otherwise machines 0 to ncandidates - 1 are. With
+     *  usehash, a machine that the endpoint hashes to counts as present.
+     */
+    static procid_t greedy(const vertex_id_type source,
+                           const vertex_id_type target,
+                           const bin_counts_type& src_degree,
+                           const bin_counts_type& dst_degree,
+                           const procid_t* candidates, size_t ncandidates,
+                           const proc_load_tracker& loads,
+                           bool usehash) {
+      const size_t numprocs = loads.size();
+      unsigned char sd[MAX_PROCS], td[MAX_PROCS];
+      expand(src_degree, numprocs, sd);
+      expand(dst_degree, numprocs, td);
+      if (usehash) {
+        sd[source % numprocs] = 1;
+        td[target % numprocs] = 1;
+      }
+      const double* bal = loads.balance_terms();
+      double score[MAX_PROCS];
+      if (candidates == NULL) {
+        for (size_t i = 0; i < ncandidates; ++i) {
+          score[i] = bal[i] + (sd[i] + td[i]);
+        }
+      } else {
+        for (size_t j = 0; j < ncandidates; ++j) {
+          const size_t i = candidates[j];
+          score[j] = bal[i] + (sd[i] + td[i]);
+        }
+      }
+      return pick_top(source, target, score, candidates, ncandidates);
+    }
+
+    /** Degree aware score of constell and zodiac: an endpoint present on
+     *  a machine adds 1, and 1 more if it is the lower degree endpoint,
+     *  except that the bonus is counted once when both endpoints have the
+     *  same degree and are both present.
+     */
+    static procid_t degree_aware(const vertex_id_type source,
+                                 const vertex_id_type target,
+                                 const bin_counts_type& src_mirror,
+                                 const bin_counts_type& dst_mirror,
+                                 const proc_load_tracker& loads,
+                                 bool is_source_small, bool is_target_small) {
+      const size_t numprocs = loads.size();
+      unsigned char sd[MAX_PROCS], td[MAX_PROCS];
+      expand(src_mirror, numprocs, sd);
+      expand(dst_mirror, numprocs, td);
+      const double* bal = loads.balance_terms();
+      const unsigned char ss = is_source_small, ts = is_target_small;
+      double score[MAX_PROCS];
+      for (size_t i = 0; i < numprocs; ++i) {
+        const unsigned char sd2 = sd[i] & ss, td2 = td[i] & ts;
+        // summed in the same order as the original expression
+        score[i] = bal[i] + sd[i] + sd2 + td[i] + td2 - (sd2 & td2);
+      }
+      return pick_top(source, target, score, NULL, numprocs);
+    }
+
+  private:
+    /// Writes bit i of bits to out[i] for i < n
+    static void expand(const bin_counts_type& bits, size_t n,
+                       unsigned char* out) {
+      for (size_t base = 0; base < n; base += WORD_BITS) {
+        const size_t word = bits.containing_word(base);
+        const size_t len = std::min<size_t>(size_t(WORD_BITS), n - base);
+        for (size_t b = 0; b < len; ++b) out[base + b] = (word >> b) & 1;
+      }
+    }
+
+    /// Hashes the edge to one of the machines within 1e-5 of the top score
+    static procid_t pick_top(const vertex_id_type source,
+                             const vertex_id_type target,
+                             const double* score, const procid_t* candidates,
+                             size_t n) {
+      const double maxscore = *std::max_element(score, score + n);
+      size_t ntop = 0;
+      for (size_t j = 0; j < n; ++j) {
+        ntop += std::fabs(score[j] - maxscore) < 1e-5;
+      }
+      typedef std::pair<vertex_id_type, vertex_id_type> edge_pair_type;
+      const edge_pair_type edge_pair(std::min(source, target),
+          std::max(source, target));
+      size_t k = graph_hash::hash_edge(edge_pair) % ntop;
+      for (size_t j = 0; j < n; ++j) {
+        if (std::fabs(score[j] - maxscore) < 1e-5 && k-- == 0) {
+          return candidates == NULL ? procid_t(j) : candidates[j];
+        }
+      }
+      return procid_t(-1);
+    }
+  }; // end of edge_placement_scorer
  
  template<typename VertexData, typename EdgeData>
  class ingress_edge_decision {
@@ -40,7 +229,7 @@ namespace graphlab {
     public:
       typedef graphlab::vertex_id_type vertex_id_type;
       typedef distributed_graph<VertexData, EdgeData> graph_type;
-      typedef fixed_dense_bitset<RPC_MAX_N_PROCS> bin_counts_type;     
+      typedef fixed_dense_bitset<RPC_DENSE_MAX_N_PROCS> bin_counts_type;     
 
     public:
       /** \brief A decision object for computing the edge assingment. */
@@ -82,107 +271,54 @@ namespace graphlab {
       /** Greedy assign (source, target) to a machine using: 
        *  bitset<MAX_MACHINE> src_degree : the degree presence of source over machines
        *  bitset<MAX_MACHINE> dst_degree : the degree presence of target over machines
-       *  vector<size_t>      proc_num_edges : the edge counts over machines
+       *  proc_load_tracker   proc_num_edges : the edge counts over machines
        * */
       procid_t edge_to_proc_greedy (const vertex_id_type source, 
           const vertex_id_type target,
           bin_counts_type& src_degree,
           bin_counts_type& dst_degree,
-          std::vector<size_t>& proc_num_edges,
+          proc_load_tracker& proc_num_edges,
           bool usehash = false,
           bool userecent = false) {
-        size_t numprocs = proc_num_edges.size();
-
-        // Compute the score of each proc.
-        procid_t best_proc = -1; 
-        double maxscore = 0.0;
-        double epsilon = 1.0; 
-        std::vector<double> proc_score(numprocs); 
-        size_t minedges = *std::min_element(proc_num_edges.begin(), proc_num_edges.end());
-        size_t maxedges = *std::max_element(proc_num_edges.begin(), proc_num_edges.end());
-
-        for (size_t i = 0; i < numprocs; ++i) {
-          size_t sd = src_degree.get(i) + (usehash && (source % numprocs == i));
-          size_t td = dst_degree.get(i) + (usehash && (target % numprocs == i));
-          double bal = (maxedges - proc_num_edges[i])/(epsilon + maxedges - minedges);
-          proc_score[i] = bal + ((sd > 0) + (td > 0));
-        }
-        maxscore = *std::max_element(proc_score.begin(), proc_score.end());
-
-        std::vector<procid_t> top_procs; 
-        for (size_t i = 0; i < numprocs; ++i)
-          if (std::fabs(proc_score[i] - maxscore) < 1e-5)
-            top_procs.push_back(i);
-
-        // Hash the edge to one of the best procs.
-        typedef std::pair<vertex_id_type, vertex_id_type> edge_pair_type;
-        const edge_pair_type edge_pair(std::min(source, target), 
-            std::max(source, target));
-        best_proc = top_procs[graph_hash::hash_edge(edge_pair) % top_procs.size()];
-
-        ASSERT_LT(best_proc, numprocs);
+        const procid_t best_proc = edge_placement_scorer::greedy(source, target,
+            src_degree, dst_degree, NULL, proc_num_edges.size(),
+            proc_num_edges, usehash);
+        ASSERT_LT(best_proc, proc_num_edges.size());
         if (userecent) {
           src_degree.clear();
           dst_degree.clear();
         }
         src_degree.set_bit(best_proc);
         dst_degree.set_bit(best_proc);
-        ++proc_num_edges[best_proc];
+        proc_num_edges.increment(best_proc);
         return best_proc;
       };
 
       /** Greedy assign (source, target) to a machine using: 
        *  bitset<MAX_MACHINE> src_degree : the degree presence of source over machines
        *  bitset<MAX_MACHINE> dst_degree : the degree presence of target over machines
-       *  vector<size_t>      proc_num_edges : the edge counts over machines
+       *  proc_load_tracker   proc_num_edges : the edge counts over machines
        * */
       procid_t edge_to_proc_greedy (const vertex_id_type source, 
           const vertex_id_type target,
           bin_counts_type& src_degree,
           bin_counts_type& dst_degree,
-          std::vector<procid_t>& candidates,
-          std::vector<size_t>& proc_num_edges,
+          const std::vector<procid_t>& candidates,
+          proc_load_tracker& proc_num_edges,
           bool usehash = false,
           bool userecent = false
           ) {
-        size_t numprocs = proc_num_edges.size();
-
-        // Compute the score of each proc.
-        procid_t best_proc = -1; 
-        double maxscore = 0.0;
-        double epsilon = 1.0; 
-        std::vector<double> proc_score(candidates.size()); 
-        size_t minedges = *std::min_element(proc_num_edges.begin(), proc_num_edges.end());
-        size_t maxedges = *std::max_element(proc_num_edges.begin(), proc_num_edges.end());
-
-        for (size_t j = 0; j < candidates.size(); ++j) {
-          size_t i = candidates[j];
-          size_t sd = src_degree.get(i) + (usehash && (source % numprocs == i));
-          size_t td = dst_degree.get(i) + (usehash && (target % numprocs == i));
-          double bal = (maxedges - proc_num_edges[i])/(epsilon + maxedges - minedges);
-          proc_score[j] = bal + ((sd > 0) + (td > 0));
-        }
-        maxscore = *std::max_element(proc_score.begin(), proc_score.end());
-
-        std::vector<procid_t> top_procs; 
-        for (size_t j = 0; j < candidates.size(); ++j)
-          if (std::fabs(proc_score[j] - maxscore) < 1e-5)
-            top_procs.push_back(candidates[j]);
-
-        // Hash the edge to one of the best procs.
-        typedef std::pair<vertex_id_type, vertex_id_type> edge_pair_type;
-        const edge_pair_type edge_pair(std::min(source, target), 
-            std::max(source, target));
-        best_proc = top_procs[graph_hash::hash_edge(edge_pair) % top_procs.size()];
-
-        ASSERT_LT(best_proc, numprocs);
+        const procid_t best_proc = edge_placement_scorer::greedy(source, target,
+            src_degree, dst_degree, &candidates[0], candidates.size(),
+            proc_num_edges, usehash);
+        ASSERT_LT(best_proc, proc_num_edges.size());
         if (userecent) {
           src_degree.clear();
           dst_degree.clear();
         }
         src_degree.set_bit(best_proc);
         dst_degree.set_bit(best_proc);
-        ++proc_num_edges[best_proc];
+        proc_num_edges.increment(best_proc);
         return best_proc;
       };
 
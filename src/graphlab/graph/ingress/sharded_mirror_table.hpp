@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_SHARDED_MIRROR_TABLE_HPP
+#define GRAPHLAB_SHARDED_MIRROR_TABLE_HPP
+
+#include <deque>
+#include <vector>
+#include <utility>
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/util/hopscotch_map.hpp>
+
+namespace graphlab {
+
+  /**
+   * \brief A concurrent map from vertex ids to the mirror sets built
+   * by the streaming ingress methods.
+   *
+   * The vertex ids are hashed to a power of two number of shards. Each
+   * shard is guarded by its own spinlock and keeps its values in a deque
+   * indexed by a hopscotch_map, so a value never moves once it is
+   * inserted. operator[] therefore costs a single lookup and returns a
+   * reference that stays valid, without any lock, until clear(). The
+   * values must be safe to update concurrently on their own (for
+   * instance a fixed_dense_bitset through its atomic set_bit()).
+   */
+  template <typename ValueType>
+  class sharded_mirror_table {
+  public:
+    typedef std::pair<vertex_id_type, ValueType> entry_type;
+    typedef std::deque<entry_type> shard_entries_type;
+
+    /** Creates a table with at least min_shards shards. Use about
+     *  a few shards per thread to keep the lock contention low. */
+    explicit sharded_mirror_table(size_t min_shards = 64) : shift(64) {
+      size_t nshards = 1;
+      while (nshards < min_shards) {
+        nshards <<= 1;
+        --shift;
+      }
+      shards.resize(nshards);
+    }
+
+    /// Returns the value of vid, inserting a default one if missing
+    ValueType& operator[](vertex_id_type vid) {
+      shard& s = shards[shard_of(vid)];
+      s.lock.lock();
+      typename index_type::const_iterator it = s.index.find(vid);
+      ValueType* ret;
+      if (it != s.index.end()) {
+        ret = it->second;
+      } else {
+        s.entries.push_back(entry_type(vid, ValueType()));
+        ret = &(s.entries.back().second);
+        s.index[vid] = ret;
+      }
+      s.lock.unlock();
+      return *ret;
+    }
+
+    /// Returns the number of shards
+    size_t num_shards() const { return shards.size(); }
+
+    /** Returns the entries of shard i in insertion order. Must not be
+     *  called while other threads insert into the table. */
+    const shard_entries_type& shard_entries(size_t i) const {
+      return shards[i].entries;
+    }
+
+    /// Returns the number of vertices in the table
+    size_t size() const {
+      size_t ret = 0;
+      for (size_t i = 0; i < shards.size(); ++i)
+        ret += shards[i].entries.size();
+      return ret;
+    }
+
+    /// Removes all the vertices and releases the memory
+    void clear() {
+      for (size_t i = 0; i < shards.size(); ++i) {
+        shards[i].index.clear();
+        shard_entries_type().swap(shards[i].entries);
+      }
+    }
+
+  private:
+    typedef hopscotch_map<vertex_id_type, ValueType*> index_type;
+
+    struct shard {
+      simple_spinlock lock;
+      index_type index;
+      shard_entries_type entries;
+    };
+
+    std::vector<shard> shards;
+    /// 64 - log2(number of shards)
+    size_t shift;
+
+    /** Picks the shard from the top bits of a multiplicative hash, so
+     *  that the shards and the hopscotch_maps, which hash on the low
+     *  bits, do not see correlated keys. */
+    size_t shard_of(vertex_id_type vid) const {
+      if (shift == 64) return 0;
+      return size_t((uint64_t(vid) * 0x9E3779B97F4A7C15ULL) >> shift);
+    }
+  }; // end of sharded_mirror_table
+
+} // end of namespace graphlab
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_SPARSE_VID_SET_HPP
+#define GRAPHLAB_SPARSE_VID_SET_HPP
+
+#include <vector>
+#include <algorithm>
+#include <graphlab/graph/graph_basic_types.hpp>
+
+namespace graphlab {
+
+  /**
+   * \brief A set of vertex ids stored as a sorted run of distinct ids
+   * followed by an unsorted tail of recent insertions.
+   *
+   * The tail is merged into the run whenever it grows larger than the
+   * run, so the memory used is proportional to the number of distinct
+   * ids inserted rather than to the largest id, and each insertion costs
+   * amortized O(log n). Used by the ingress methods to collect the
+   * vertices whose degree must be sent to another machine.
+   */
+  class sparse_vid_set {
+  public:
+    sparse_vid_set() : nsorted(0) { }
+
+    /// Adds vid to the set
+    inline void insert(vertex_id_type vid) {
+      ids.push_back(vid);
+      const size_t maxtail = nsorted > MIN_TAIL ? nsorted : size_t(MIN_TAIL);
+      if (ids.size() - nsorted > maxtail) compact();
+    }
+
+    /// Returns the distinct ids of the set in increasing order
+    const std::vector<vertex_id_type>& sorted_ids() {
+      compact();
+      return ids;
+    }
+
+    /// Returns the number of distinct ids in the set
+    size_t size() {
+      compact();
+      return ids.size();
+    }
+
+    /// Removes all ids and releases the memory
+    void clear() {
+      std::vector<vertex_id_type>().swap(ids);
+      nsorted = 0;
+    }
+
+  private:
+    static const size_t MIN_TAIL = 4096;
+    std::vector<vertex_id_type> ids;
+    /// ids[0, nsorted) is sorted and distinct
+    size_t nsorted;
+
+    void compact() {
+      if (nsorted == ids.size()) return;
+      std::sort(ids.begin() + nsorted, ids.end());
+      std::inplace_merge(ids.begin(), ids.begin() + nsorted, ids.end());
+      ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+      nsorted = ids.size();
+    }
+  }; // end of sparse_vid_set
+
+  /**
+   * The number of degree records an ingress method sends from its
+   * sparse_vid_sets before it drains the degrees received so far, so
+   * that the receive buffers do not grow with the whole exchange.
+   */
+  static const size_t DEGREE_EXCHANGE_CHUNK = 1 << 16;
+
+} // end of namespace graphlab
+
+#endif
@@ -52,6 +52,7 @@
 #include <graphlab/util/generics/counting_sort.hpp>
 #include <graphlab/util/generics/vector_zip.hpp>
 #include <graphlab/util/generics/csr_storage.hpp>
+#include <graphlab/util/generics/delta_csr_storage.hpp>
 #include <graphlab/parallel/atomic.hpp>
 
 #include <graphlab/logger/logger.hpp>
@@ -165,12 +166,12 @@ namespace graphlab {
     // CONSTRUCTORS ============================================================>
     
     /** Create an empty local_graph. */
-    local_graph() : finalized(false) { }
+    local_graph() : finalized(false), compressed(false) { }
 
     /** Create a local_graph with nverts vertices. */
     local_graph(size_t nverts) :
       vertices(nverts),
-      finalized(false) { }
+      finalized(false), compressed(false) { }
 
     // METHODS =================================================================>
     
@@ -183,10 +184,13 @@ namespace graphlab {
      */
     void clear() {
       finalized = false;
+      compressed = false;
       vertices.clear();
       edges.clear();
       _csc_storage.clear();
       _csr_storage.clear();
+      _packed_csr.clear();
+      _packed_csc.clear();
       std::vector<VertexData>().swap(vertices);
       std::vector<EdgeData>().swap(edges);
       edge_buffer.clear();
@@ -217,56 +221,38 @@ namespace graphlab {
       // Begin of counting sort.
       counting_sort(edge_buffer.source_arr, permute, &src_counting_prefix_sum);
 
-      // Inplace permute of edge_data, edge_src, edge_target array.
+      // Permute the edge arrays into source order. The parallel gathers
+      // copy one array at a time; edge data larger than a csc entry is
+      // permuted in place instead, so it never sets the peak memory.
 #ifdef DEBUG_GRAPH
-      logstream(LOG_DEBUG) << "Graph2 finalize: Inplace permute by source id" << std::endl;
+      logstream(LOG_DEBUG) << "Graph2 finalize: Permute by source id" << std::endl;
 #endif
-      lvid_type swap_src; lvid_type swap_target; EdgeData  swap_data;
-      for (size_t i = 0; i < permute.size(); ++i) {
-        if (i != permute[i]) {
-          // Reserve the ith entry;
-          size_t j = i;
-          swap_data = edge_buffer.data[i];
-          swap_src = edge_buffer.source_arr[i];
-          swap_target = edge_buffer.target_arr[i];
-          // Begin swap cycle:
-          while (j != permute[j]) {
-            size_t next = permute[j];
-            if (next != i) {
-              edge_buffer.data[j] = edge_buffer.data[next];
-              edge_buffer.source_arr[j] = edge_buffer.source_arr[next];
-              edge_buffer.target_arr[j] = edge_buffer.target_arr[next];
-              permute[j] = j;
-              j = next;
-            } else {
-              // end of cycle
-              edge_buffer.data[j] = swap_data;
-              edge_buffer.source_arr[j] = swap_src;
-              edge_buffer.target_arr[j] = swap_target;
-              permute[j] = j;
-              break;
-            }
-          }
-        }
+      outofplace_shuffle(edge_buffer.source_arr, permute);
+      outofplace_shuffle(edge_buffer.target_arr, permute);
+      if (sizeof(EdgeData) <= sizeof(std::pair<lvid_type, edge_id_type>)) {
+        outofplace_shuffle(edge_buffer.data, permute);
+      } else {
+        inplace_shuffle(edge_buffer.data.begin(), edge_buffer.data.end(),
+                        permute);
       }
 #ifdef DEBUG_GRAPH
       logstream(LOG_DEBUG) << "Graph2 finalize: Sort by dest id" << std::endl;
 #endif
       counting_sort(edge_buffer.target_arr, permute, &dest_counting_prefix_sum); 
-      // Shuffle source array
-#ifdef DEBUG_GRAPH
-      logstream(LOG_DEBUG) << "Graph2 finalize: Outofplace permute by dest id" << std::endl;
+      // The in edges are (source, edge id) in target order
+      std::vector<std::pair<lvid_type, edge_id_type> > csc_value(permute.size());
+#ifdef _OPENMP
+#pragma omp parallel for
 #endif
-
-      outofplace_shuffle(edge_buffer.source_arr, permute);
-      // Use inplace shuffle to reduce peak memory footprint:
-      // inplace_shuffle(edge_buffer.source_arr, permute);
-      // counting_sort(edge_buffer.target_arr, permute);
+      for (ssize_t i = 0; i < ssize_t(permute.size()); ++i) {
+        csc_value[i].first = edge_buffer.source_arr[permute[i]];
+        csc_value[i].second = permute[i];
+      }
+      std::vector<edge_id_type>().swap(permute);
+      std::vector<lvid_type>().swap(edge_buffer.source_arr);
 
       // warp into csr csc storage.
       _csr_storage.wrap(src_counting_prefix_sum, edge_buffer.target_arr);
-      std::vector<std::pair<lvid_type, edge_id_type> > csc_value = vector_zip(edge_buffer.source_arr, permute);
-      //ASSERT_EQ(csc_value.size(), edge_buffer.size());
       _csc_storage.wrap(dest_counting_prefix_sum, csc_value); 
       edges.swap(edge_buffer.data);
       ASSERT_EQ(_csr_storage.num_values(), _csc_storage.num_values());
@@ -280,6 +266,103 @@ namespace graphlab {
       finalized = true;
     } // End of finalize
 
+    /**
+     * \brief Replaces the CSR and CSC adjacency of a finalized local_graph
+     * by delta encoded varints. This usually cuts the adjacency from 12
+     * bytes per edge to 3 to 5.
+     *
+     * The out edges of every vertex are first sorted by target, which
+     * renumbers the edges, so no edge id may be kept across this call.
+     * Edges cannot be iterated backward cheaply afterwards, and
+     * random access into an edge list costs linear time.
+     */
+    void compress() {
+      ASSERT_TRUE(finalized);
+      if (compressed) return;
+      graphlab::timer mytimer; mytimer.start();
+      const size_t nedges = edges.size();
+      const ssize_t nsources = _csr_storage.num_keys();
+      // sort every out edge list by target; permute[new eid] = old eid
+      std::vector<edge_id_type> csr_ptr(_csr_storage.get_index());
+      std::vector<lvid_type> csr_nbr(nedges);
+      std::vector<lvid_type> csr_source(nedges);
+      std::vector<edge_id_type> permute(nedges);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+      for (ssize_t v = 0; v < nsources; ++v) {
+        const size_t begin = csr_ptr[v];
+        std::vector<std::pair<lvid_type, edge_id_type> > row;
+        for (csr_type::iterator it = _csr_storage.begin(v);
+             it != _csr_storage.end(v); ++it) {
+          row.push_back(std::make_pair(*it, edge_id_type(begin + row.size())));
+        }
+        std::sort(row.begin(), row.end());
+        for (size_t i = 0; i < row.size(); ++i) {
+          csr_nbr[begin + i] = row[i].first;
+          permute[begin + i] = row[i].second;
+          csr_source[begin + i] = v;
+        }
+      }
+      _csr_storage.clear();
+      _csc_storage.clear();
+      outofplace_shuffle(edges, permute);
+
+      // sorting the sorted out edges by target keeps the sources, and the
+      // edge ids, of every in edge list increasing
+      std::vector<edge_id_type> csc_ptr;
+      counting_sort(csr_nbr, permute, &csc_ptr);
+      _packed_csr.build(csr_ptr, csr_nbr);
+      std::vector<edge_id_type>().swap(csr_ptr);
+      std::vector<lvid_type>().swap(csr_nbr);
+      std::vector<lvid_type> csc_nbr(nedges);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(nedges); ++i) {
+        csc_nbr[i] = csr_source[permute[i]];
+      }
+      std::vector<lvid_type>().swap(csr_source);
+      _packed_csc.build(csc_ptr, csc_nbr, &permute);
+      compressed = true;
+      logstream(LOG_INFO) << "Graph compressed in " << mytimer.current_time()
+                          << " secs to " << estimate_sizeof() << " bytes"
+                          << std::endl;
+    } // End of compress
+
+    /** \brief Returns true if the adjacency is compressed by compress() */
+    bool is_compressed() const { return compressed; }
+
+    /**
+     * \internal
+     * \brief Rebuilds a finalized local_graph directly from CSR (out edges)
+     * and CSC (in edges) arrays, skipping finalize(). ptr[v] is the offset
+     * of the first neighbor of v and vertices past the end of ptr have no
+     * neighbors. Out edges must be numbered in CSR order. All input vectors
+     * are consumed.
+     */
+    void load_adjacency(std::vector<VertexData>& vdata,
+                        std::vector<EdgeData>& edata,
+                        std::vector<edge_id_type>& csr_ptr,
+                        std::vector<lvid_type>& csr_nbr,
+                        std::vector<edge_id_type>& csr_eid,
+                        std::vector<edge_id_type>& csc_ptr,
+                        std::vector<lvid_type>& csc_nbr,
+                        std::vector<edge_id_type>& csc_eid) {
+      clear();
+      ASSERT_EQ(csr_nbr.size(), edata.size());
+      ASSERT_EQ(csc_nbr.size(), edata.size());
+      for (size_t i = 0; i < csr_eid.size(); ++i) ASSERT_EQ(csr_eid[i], i);
+      vertices.swap(vdata);
+      edges.swap(edata);
+      _csr_storage.wrap(csr_ptr, csr_nbr);
+      std::vector<std::pair<lvid_type, edge_id_type> > csc_value =
+          vector_zip(csc_nbr, csc_eid);
+      _csc_storage.wrap(csc_ptr, csc_value);
+      std::vector<edge_id_type>().swap(csr_eid);
+      finalized = true;
+    } // end of load adjacency
+
     /** \brief Get the number of vertices */
     size_t num_vertices() const {
       return vertices.size();
@@ -420,22 +503,49 @@ namespace graphlab {
     /** \brief Load the local_graph from an archive */
     void load(iarchive& arc) {
       clear();    
+      size_t magic = 0;
+      arc >> magic;
+      if (magic != ARCHIVE_MAGIC) {
+        // unversioned archive: the word read is the number of vertices
+        load_unversioned(arc, magic);
+        return;
+      }
+      uint32_t version = 0;
+      arc >> version;
+      if (version != ARCHIVE_VERSION) {
+        logstream(LOG_ERROR) << "Unsupported local_graph archive version "
+                             << version << std::endl;
+        // leave the graph empty and let the caller see arc.fail()
+        if (arc.in != NULL) arc.in->setstate(std::ios::failbit);
+        else arc.off = arc.len + 1;
+        return;
+      }
       // read the vertices
       arc >> vertices
           >> edges 
           >> _csr_storage
           >> _csc_storage
-          >> finalized;
+          >> finalized
+          >> compressed
+          >> _packed_csr
+          >> _packed_csc;
     } // end of load
 
     /** \brief Save the local_graph to an archive */
     void save(oarchive& arc) const {
+      // copied so that the in-class constants are not bound to references
+      const uint64_t magic = ARCHIVE_MAGIC;
+      const uint32_t version = ARCHIVE_VERSION;
+      arc << magic << version;
       // Write the number of edges and vertices
       arc << vertices
           << edges
           << _csr_storage  
           << _csc_storage
-          << finalized;
+          << finalized
+          << compressed
+          << _packed_csr
+          << _packed_csc;
     } // end of save
     
     /** swap two graphs */
@@ -445,7 +555,10 @@ namespace graphlab {
       std::swap(edges, other.edges);
       std::swap(_csr_storage, other._csr_storage);
       std::swap(_csc_storage, other._csc_storage);
+      _packed_csr.swap(other._packed_csr);
+      _packed_csc.swap(other._packed_csc);
       std::swap(finalized, other.finalized);
+      std::swap(compressed, other.compressed);
     } // end of swap
 
 
@@ -502,6 +615,7 @@ namespace graphlab {
      * \brief Returns the number of in edges of the vertex with the given id. */
     size_t num_in_edges(const lvid_type v) const {
       ASSERT_TRUE(finalized);
+      if (compressed) return _packed_csc.num_values(v);
       return (_csc_storage.end(v) - _csc_storage.begin(v));
     }
 
@@ -510,6 +624,7 @@ namespace graphlab {
      * \brief Returns the number of in edges of the vertex with the given id. */
     size_t num_out_edges(const lvid_type v) const {
       ASSERT_TRUE(finalized);
+      if (compressed) return _packed_csr.num_values(v);
       return (_csr_storage.end(v) - _csr_storage.begin(v));
     }
 
@@ -517,6 +632,11 @@ namespace graphlab {
      * \internal
      * \brief Returns a list of in edges of the vertex with the given id. */
     edge_list_type in_edges(lvid_type v) {
+      if (compressed) {
+        return boost::make_iterator_range(
+            edge_iterator(*this, _packed_csc.begin(v), v, false),
+            edge_iterator(*this, _packed_csc.end(v), v, false));
+      }
       edge_iterator begin = edge_iterator(*this, _csc_storage.begin(v), v);
       edge_iterator end = edge_iterator(*this, _csc_storage.end(v), v);
       return boost::make_iterator_range(begin, end);
@@ -526,6 +646,11 @@ namespace graphlab {
      * \internal
      * \brief Returns a list of out edges of the vertex with the given id. */
     edge_list_type out_edges(lvid_type v) {
+      if (compressed) {
+        return boost::make_iterator_range(
+            edge_iterator(*this, _packed_csr.begin(v), v, true),
+            edge_iterator(*this, _packed_csr.end(v), v, true));
+      }
 
       csr_type::iterator base_begin = _csr_storage.begin(v);
       csr_type::iterator base_end = _csr_storage.end(v);
@@ -572,6 +697,7 @@ namespace graphlab {
         sizeof(VertexData) * vertices.capacity();
       size_t elist_size = _csr_storage.estimate_sizeof() 
           + _csc_storage.estimate_sizeof()
+          + _packed_csr.estimate_sizeof() + _packed_csc.estimate_sizeof()
           + sizeof(edges) + sizeof(EdgeData)*edges.capacity();
       size_t ebuffer_size = edge_buffer.estimate_sizeof();
       // std::cerr << "local_graph: tmplist size: " << (double)elist_size/(1024*1024)
@@ -613,6 +739,11 @@ namespace graphlab {
     typedef boost::zip_iterator<csr_iterator_tuple> csr_edge_iterator;
     typedef csc_type::iterator csc_edge_iterator;
 
+    /** The compressed out edges hold (target, implicit edge id) and the
+     *  compressed in edges (source, edge id) */
+    typedef delta_csr_storage<lvid_type, edge_id_type> packed_type;
+    typedef packed_type::iterator packed_edge_iterator;
+
     class edge_iterator : 
         public boost::iterator_facade <
         edge_iterator,
@@ -626,6 +757,10 @@ namespace graphlab {
            edge_iterator(local_graph& lgraph_ref,
                          csr_edge_iterator iter, lvid_type destid) 
                : lgraph_ref(lgraph_ref), _type(CSR), csr_iter(iter), vid(destid) {}
+           edge_iterator(local_graph& lgraph_ref,
+                         packed_edge_iterator iter, lvid_type vid, bool out)
+               : lgraph_ref(lgraph_ref), _type(out ? PACKED_CSR : PACKED_CSC),
+                 packed_iter(iter), vid(vid) {}
 
          private:
            friend class boost::iterator_core_access;
@@ -634,6 +769,7 @@ namespace graphlab {
              switch (_type) {
               case CSC: ++csc_iter; break;
               case CSR: ++csr_iter; break;
+              case PACKED_CSR: case PACKED_CSC: ++packed_iter; break;
               default: return;
              }
            }
@@ -643,6 +779,8 @@ namespace graphlab {
              switch (_type) {
               case CSC: return csc_iter == other.csc_iter;
               case CSR: return csr_iter == other.csr_iter;
+              case PACKED_CSR: case PACKED_CSC:
+                return packed_iter == other.packed_iter;
               default: return true;
              }
            }
@@ -653,6 +791,8 @@ namespace graphlab {
              switch (_type) {
               case CSC: --csc_iter; break;
               case CSR: --csr_iter; break;
+              case PACKED_CSR: case PACKED_CSC:
+                packed_iter.seek(packed_iter.position() - 1); break;
               default: return;
              }
            }
@@ -660,6 +800,8 @@ namespace graphlab {
              switch (_type) {
               case CSC: csc_iter+=n; break;
               case CSR: csr_iter+=n; break;
+              case PACKED_CSR: case PACKED_CSC:
+                packed_iter.seek(packed_iter.position() + n); break;
               default: return;
              }
            } 
@@ -667,6 +809,9 @@ namespace graphlab {
              switch (_type) {
               case CSC: return other.csc_iter - csc_iter;
               case CSR: return other.csr_iter - csr_iter;
+              case PACKED_CSR: case PACKED_CSC:
+                return ptrdiff_t(other.packed_iter.position())
+                    - ptrdiff_t(packed_iter.position());
               default: return 0;
              }
            }
@@ -686,14 +831,21 @@ namespace graphlab {
                                  val.template get<0>(),
                                  val.template get<1>());
               }
+              case PACKED_CSR:
+                return edge_type(lgraph_ref, vid, packed_iter.value(),
+                                 packed_iter.id());
+              case PACKED_CSC:
+                return edge_type(lgraph_ref, packed_iter.value(), vid,
+                                 packed_iter.id());
               default: return edge_type(lgraph_ref, -1, -1, -1);
              }
            }
-           enum list_type {CSR, CSC}; 
+           enum list_type {CSR, CSC, PACKED_CSR, PACKED_CSC};
            local_graph& lgraph_ref;
            const list_type _type;
            csc_edge_iterator csc_iter;
            csr_edge_iterator csr_iter;
+           packed_edge_iterator packed_iter;
            const lvid_type vid;
         }; // end of edge_iterator
 
@@ -711,6 +863,11 @@ namespace graphlab {
     csc_type _csc_storage;
     std::vector<EdgeData> edges;
 
+    /** The adjacency once compress() is called. The CSR and CSC storage
+        are empty then. */
+    packed_type _packed_csr;
+    packed_type _packed_csc;
+
     /** The edge data is a vector of edges where each edge stores its
         source, destination, and data. Used for temporary storage. The
         data is transferred into CSR+CSC representation in
@@ -722,6 +879,42 @@ namespace graphlab {
         performance. */
     bool finalized;
 
+    /** Mark whether the adjacency is in _packed_csr and _packed_csc */
+    bool compressed;
+
+    /**
+     * Written before the local graph in save(). Archives without it
+     * predate the packed adjacency and are read by load_unversioned().
+     * The first word of those is the number of vertices, which never
+     * reaches the magic.
+     *
+     * Version 1: storage kind and packed adjacency after finalized.
+     */
+    static const uint64_t ARCHIVE_MAGIC = 0x3148504152474c47ULL; // "GLGRAPH1"
+    static const uint32_t ARCHIVE_VERSION = 1;
+
+    /**
+     * Reads the layout save() wrote before the version tag. It is the
+     * versioned layout without the tag and without the packed adjacency.
+     */
+    void load_unversioned(iarchive& arc, size_t nverts) {
+      if (gl_is_bulk_serializable<VertexData>::value) {
+        vertices.resize(nverts);
+        if (nverts > 0) {
+          deserialize(arc, &vertices[0], sizeof(VertexData) * nverts);
+        }
+      } else {
+        vertices.reserve(nverts);
+        deserialize_iterator<iarchive, VertexData>
+          (arc, std::inserter(vertices, vertices.end()));
+      }
+      arc >> edges
+          >> _csr_storage
+          >> _csc_storage
+          >> finalized;
+      compressed = false;
+    } // end of load_unversioned
+
 
     /**************************************************************************/
     /*                                                                        */
@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_LOCAL_VERTEX_ORDER_HPP
+#define GRAPHLAB_LOCAL_VERTEX_ORDER_HPP
+
+#include <vector>
+#include <algorithm>
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/macros_def.hpp>
+
+namespace graphlab {
+
+  /**
+   * \brief Vertex orderings used to relabel the local vertices of a
+   * distributed_graph after finalize.
+   *
+   * Each ordering returns new2old, the old lvid of every new lvid. The
+   * vertices with first[v] set (the masters) always come before the
+   * others, so that the engines sweep the masters over a dense range of
+   * lvids. Within each group the vertices are ordered by the chosen
+   * method.
+   */
+  namespace local_vertex_order {
+
+    namespace order_impl {
+      template <typename LocalGraph>
+      struct degree_greater {
+        LocalGraph& g;
+        degree_greater(LocalGraph& g) : g(g) { }
+        bool operator()(lvid_type a, lvid_type b) const {
+          return g.num_in_edges(a) + g.num_out_edges(a) >
+              g.num_in_edges(b) + g.num_out_edges(b);
+        }
+      };
+
+      template <typename LocalGraph>
+      struct degree_less {
+        LocalGraph& g;
+        degree_less(LocalGraph& g) : g(g) { }
+        bool operator()(lvid_type a, lvid_type b) const {
+          return g.num_in_edges(a) + g.num_out_edges(a) <
+              g.num_in_edges(b) + g.num_out_edges(b);
+        }
+      };
+
+      struct in_first_group {
+        const std::vector<bool>& first;
+        in_first_group(const std::vector<bool>& first) : first(first) { }
+        bool operator()(lvid_type v) const { return first[v]; }
+      };
+    } // end of order_impl
+
+    /**
+     * Orders the vertices by decreasing number of local edges, so the
+     * high degree vertices, which most gathers and scatters touch, share
+     * the same cache lines.
+     */
+    template <typename LocalGraph>
+    std::vector<lvid_type> by_degree(LocalGraph& g,
+                                     const std::vector<bool>& first) {
+      std::vector<lvid_type> new2old(g.num_vertices());
+      for (size_t i = 0; i < new2old.size(); ++i) new2old[i] = i;
+      std::stable_sort(new2old.begin(), new2old.end(),
+                       order_impl::degree_greater<LocalGraph>(g));
+      std::stable_partition(new2old.begin(), new2old.end(),
+                            order_impl::in_first_group(first));
+      return new2old;
+    }
+
+    /**
+     * Reverse Cuthill-McKee ordering of the local graph with the edge
+     * directions ignored: a breadth first search started from a vertex
+     * of lowest degree, which visits the neighbors of every vertex by
+     * increasing degree, reversed. Neighbors receive nearby lvids.
+     */
+    template <typename LocalGraph>
+    std::vector<lvid_type> reverse_cuthill_mckee(LocalGraph& g,
+                                                 const std::vector<bool>& first) {
+      typedef typename LocalGraph::edge_type edge_type;
+      const size_t nverts = g.num_vertices();
+      // start points in increasing degree order
+      std::vector<lvid_type> by_degree(nverts);
+      for (size_t i = 0; i < nverts; ++i) by_degree[i] = i;
+      std::stable_sort(by_degree.begin(), by_degree.end(),
+                       order_impl::degree_less<LocalGraph>(g));
+      std::vector<bool> visited(nverts, false);
+      std::vector<lvid_type> order;
+      order.reserve(nverts);
+      std::vector<lvid_type> nbrs;
+      for (size_t s = 0; s < nverts; ++s) {
+        if (visited[by_degree[s]]) continue;
+        size_t head = order.size();
+        order.push_back(by_degree[s]);
+        visited[by_degree[s]] = true;
+        while (head < order.size()) {
+          const lvid_type v = order[head++];
+          nbrs.clear();
+          foreach(const edge_type& e, g.out_edges(v)) {
+            if (!visited[e.target().id()]) nbrs.push_back(e.target().id());
+          }
+          foreach(const edge_type& e, g.in_edges(v)) {
+            if (!visited[e.source().id()]) nbrs.push_back(e.source().id());
+          }
+          std::stable_sort(nbrs.begin(), nbrs.end(),
+                           order_impl::degree_less<LocalGraph>(g));
+          foreach(lvid_type u, nbrs) {
+            if (!visited[u]) {
+              visited[u] = true;
+              order.push_back(u);
+            }
+          }
+        }
+      }
+      std::reverse(order.begin(), order.end());
+      std::stable_partition(order.begin(), order.end(),
+                            order_impl::in_first_group(first));
+      return order;
+    }
+
+  } // end of local_vertex_order
+} // end of namespace graphlab
+
+#include <graphlab/macros_undef.hpp>
+#endif
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_GRAPH_MIRROR_SET_HPP
+#define GRAPHLAB_GRAPH_MIRROR_SET_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <algorithm>
+#include <stdint.h>
+#include <graphlab/rpc/dc_types.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+namespace graphlab {
+
+  /**
+   * \brief The set of machines holding a mirror of a vertex.
+   *
+   * Most vertices of a power-law graph have no mirror or only a few, so a
+   * bitset over all machines wastes memory in every vertex record. The
+   * mirror_set occupies a single word: up to INLINE_CAPACITY machine ids
+   * are stored sorted inside the word, and larger sets spill into a heap
+   * allocated bitset which grows with the largest machine id inserted.
+   * The set is therefore not bounded by a compile time number of machines.
+   *
+   * The interface follows fixed_dense_bitset. set_bit() is safe to call
+   * concurrently with other calls to set_bit(); the word reserves a bit
+   * which is used as a spin lock while the set is modified. Iteration
+   * yields the machine ids in increasing order.
+   */
+  class mirror_set {
+  public:
+    /// Number of machine ids stored without a heap allocation
+    static const size_t INLINE_CAPACITY = 3;
+
+    mirror_set() : word(INLINE_FLAG) { }
+
+    mirror_set(const mirror_set& other) : word(copy_word(other.word)) { }
+
+    ~mirror_set() { release(word); }
+
+    inline mirror_set& operator=(const mirror_set& other) {
+      if (this != &other) {
+        const size_t w = copy_word(other.word);
+        release(word);
+        word = w;
+      }
+      return *this;
+    }
+
+    /// Removes all machines from the set
+    inline void clear() {
+      release(word);
+      word = INLINE_FLAG;
+    }
+
+    inline bool empty() const { return popcount() == 0; }
+
+    /// Returns the number of machines in the set
+    inline size_t popcount() const {
+      if (word & INLINE_FLAG) return inline_count(word);
+      else return block(word)->count;
+    }
+
+    /// Returns true if machine b is in the set
+    inline bool get(size_t b) const {
+      if (word & INLINE_FLAG) {
+        const size_t n = inline_count(word);
+        for (size_t i = 0; i < n; ++i) {
+          if (inline_get(word, i) == b) return true;
+        }
+        return false;
+      }
+      const heap_block* blk = block(word);
+      if (b >= blk->nwords * WORD_BITS) return false;
+      return blk->bits[b / WORD_BITS] & (size_t(1) << (b % WORD_BITS));
+    }
+
+    //! Atomically adds machine b to the set returning the old value
+    inline bool set_bit(size_t b) {
+      size_t w = lock();
+      const bool ret = insert(w, b);
+      unlock(w);
+      return ret;
+    }
+
+    /** Adds machine b to the set returning the old value.
+        Unlike set_bit(), this does not take the lock bit and is unsafe
+        if the set is modified by multiple threads.
+    */
+    inline bool set_bit_unsync(size_t b) {
+      return insert(word, b);
+    }
+
+    /** Returns true with b containing the smallest machine in the set.
+        If the set is empty, this function returns false.
+    */
+    inline bool first_bit(size_t& b) const {
+      if (word & INLINE_FLAG) {
+        if (inline_count(word) == 0) return false;
+        b = inline_get(word, 0);
+        return true;
+      }
+      return block_next(block(word), 0, b);
+    }
+
+    /** Where b is a machine in the set, this function will return in b
+        the next larger machine in the set, and return true.
+        If there is no larger machine, this function returns false.
+    */
+    inline bool next_bit(size_t& b) const {
+      if (word & INLINE_FLAG) {
+        const size_t n = inline_count(word);
+        for (size_t i = 0; i < n; ++i) {
+          const size_t p = inline_get(word, i);
+          if (p > b) { b = p; return true; }
+        }
+        return false;
+      }
+      return block_next(block(word), b + 1, b);
+    }
+
+    struct bit_pos_iterator {
+      typedef std::input_iterator_tag iterator_category;
+      typedef size_t value_type;
+      typedef size_t difference_type;
+      typedef const size_t reference;
+      typedef const size_t* pointer;
+      size_t pos;
+      const mirror_set* ms;
+      bit_pos_iterator() : pos(-1), ms(NULL) { }
+      bit_pos_iterator(const mirror_set* const ms, size_t pos) :
+        pos(pos), ms(ms) { }
+
+      size_t operator*() const {
+        return pos;
+      }
+      size_t operator++() {
+        if (ms->next_bit(pos) == false) pos = (size_t)(-1);
+        return pos;
+      }
+      size_t operator++(int) {
+        size_t prevpos = pos;
+        if (ms->next_bit(pos) == false) pos = (size_t)(-1);
+        return prevpos;
+      }
+      bool operator==(const bit_pos_iterator& other) const {
+        return other.pos == pos;
+      }
+      bool operator!=(const bit_pos_iterator& other) const {
+        return other.pos != pos;
+      }
+    };
+
+    typedef bit_pos_iterator iterator;
+    typedef bit_pos_iterator const_iterator;
+
+    bit_pos_iterator begin() const {
+      size_t pos;
+      if (first_bit(pos) == false) pos = size_t(-1);
+      return bit_pos_iterator(this, pos);
+    }
+
+    bit_pos_iterator end() const {
+      return bit_pos_iterator(this, (size_t)(-1));
+    }
+
+    mirror_set& operator|=(const mirror_set& other) {
+      size_t b;
+      if (other.first_bit(b)) {
+        do { set_bit_unsync(b); } while (other.next_bit(b));
+      }
+      return *this;
+    }
+
+    bool operator==(const mirror_set& other) const {
+      if (popcount() != other.popcount()) return false;
+      size_t b;
+      if (other.first_bit(b)) {
+        do { if (!get(b)) return false; } while (other.next_bit(b));
+      }
+      return true;
+    }
+
+    bool operator!=(const mirror_set& other) const {
+      return !(*this == other);
+    }
+
+    /// Serializes the set as a list of machine ids
+    inline void save(oarchive& oarc) const {
+      oarc << popcount();
+      size_t b;
+      if (first_bit(b)) {
+        do { oarc << procid_t(b); } while (next_bit(b));
+      }
+    }
+
+    /// Deserializes a set written by save()
+    inline void load(iarchive& iarc) {
+      clear();
+      size_t n;
+      iarc >> n;
+      for (size_t i = 0; i < n; ++i) {
+        procid_t p;
+        iarc >> p;
+        set_bit_unsync(p);
+      }
+    }
+
+  private:
+    /** The heap representation: a bitset of nwords words which also
+        tracks the number of bits set. */
+    struct heap_block {
+      uint32_t nwords;
+      uint32_t count;
+      size_t bits[1];
+    };
+
+    static const size_t WORD_BITS = 8 * sizeof(size_t);
+    // bit 0 marks the inline representation. Heap blocks are at least
+    // word aligned so the bit is clear in a block pointer.
+    static const size_t INLINE_FLAG = 1;
+    // bit 1 is held while set_bit() modifies the set
+    static const size_t LOCK_FLAG = 2;
+    // bits 2-3 hold the inline count, bits 16-63 hold the inline ids
+    static const size_t COUNT_SHIFT = 2;
+    static const size_t COUNT_MASK = 3;
+    static const size_t SLOT_BITS = 16;
+
+    size_t word;
+
+    static inline size_t inline_count(size_t w) {
+      return (w >> COUNT_SHIFT) & COUNT_MASK;
+    }
+    static inline size_t inline_get(size_t w, size_t i) {
+      return (w >> (SLOT_BITS * (i + 1))) & 0xFFFF;
+    }
+    static inline size_t inline_set(size_t w, size_t i, size_t p) {
+      const size_t shift = SLOT_BITS * (i + 1);
+      return (w & ~(size_t(0xFFFF) << shift)) | (p << shift);
+    }
+    static inline heap_block* block(size_t w) {
+      return reinterpret_cast<heap_block*>(w & ~LOCK_FLAG);
+    }
+
+    static heap_block* allocate_block(size_t nwords) {
+      heap_block* blk = reinterpret_cast<heap_block*>(
+          malloc(sizeof(heap_block) + (nwords - 1) * sizeof(size_t)));
+      ASSERT_TRUE(blk != NULL);
+      blk->nwords = nwords;
+      blk->count = 0;
+      memset(blk->bits, 0, nwords * sizeof(size_t));
+      return blk;
+    }
+
+    static inline size_t copy_word(size_t w) {
+      if (w & INLINE_FLAG) return w & ~LOCK_FLAG;
+      const heap_block* src = block(w);
+      heap_block* blk = allocate_block(src->nwords);
+      memcpy(blk->bits, src->bits, src->nwords * sizeof(size_t));
+      blk->count = src->count;
+      return reinterpret_cast<size_t>(blk);
+    }
+
+    static inline void release(size_t w) {
+      if ((w & INLINE_FLAG) == 0) free(block(w));
+    }
+
+    static bool block_next(const heap_block* blk, size_t from, size_t& b) {
+      size_t i = from / WORD_BITS;
+      if (i >= blk->nwords) return false;
+      size_t x = blk->bits[i] & (size_t(-1) << (from % WORD_BITS));
+      while (x == 0) {
+        if (++i >= blk->nwords) return false;
+        x = blk->bits[i];
+      }
+      b = i * WORD_BITS + __builtin_ctzl(x);
+      return true;
+    }
+
+    /// Inserts b into the representation w, returning the old value
+    static bool insert(size_t& w, size_t b) {
+      ASSERT_LT(b, size_t(1) << SLOT_BITS);
+      if (w & INLINE_FLAG) {
+        const size_t n = inline_count(w);
+        size_t i = 0;
+        for (; i < n; ++i) {
+          const size_t p = inline_get(w, i);
+          if (p == b) return true;
+          if (p > b) break;
+        }
+        if (n < INLINE_CAPACITY) {
+          for (size_t j = n; j > i; --j) w = inline_set(w, j, inline_get(w, j - 1));
+          w = inline_set(w, i, b);
+          w = (w & ~(COUNT_MASK << COUNT_SHIFT)) | ((n + 1) << COUNT_SHIFT);
+          return false;
+        }
+        // spill to a bitset large enough for the largest id
+        const size_t maxid = std::max(b, inline_get(w, n - 1));
+        heap_block* blk = allocate_block(maxid / WORD_BITS + 1);
+        for (size_t j = 0; j < n; ++j) {
+          const size_t p = inline_get(w, j);
+          blk->bits[p / WORD_BITS] |= size_t(1) << (p % WORD_BITS);
+        }
+        blk->bits[b / WORD_BITS] |= size_t(1) << (b % WORD_BITS);
+        blk->count = n + 1;
+        w = reinterpret_cast<size_t>(blk) | (w & LOCK_FLAG);
+        return false;
+      }
+      heap_block* blk = block(w);
+      if (b >= blk->nwords * WORD_BITS) {
+        const size_t oldwords = blk->nwords;
+        const size_t nwords = b / WORD_BITS + 1;
+        blk = reinterpret_cast<heap_block*>(
+            realloc(blk, sizeof(heap_block) + (nwords - 1) * sizeof(size_t)));
+        ASSERT_TRUE(blk != NULL);
+        memset(blk->bits + oldwords, 0, (nwords - oldwords) * sizeof(size_t));
+        blk->nwords = nwords;
+        w = reinterpret_cast<size_t>(blk) | (w & LOCK_FLAG);
+      }
+      const size_t mask = size_t(1) << (b % WORD_BITS);
+      if (blk->bits[b / WORD_BITS] & mask) return true;
+      blk->bits[b / WORD_BITS] |= mask;
+      ++blk->count;
+      return false;
+    }
+
+    /// Spins until the lock bit is acquired, returning the locked word
+    inline size_t lock() {
+      while (true) {
+        const size_t w = *reinterpret_cast<volatile size_t*>(&word);
+        if ((w & LOCK_FLAG) == 0 &&
+            __sync_bool_compare_and_swap(&word, w, w | LOCK_FLAG)) {
+          return w | LOCK_FLAG;
+        }
+      }
+    }
+
+    /// Publishes the locked word w and releases the lock bit
+    inline void unlock(size_t w) {
+      __sync_synchronize();
+      *reinterpret_cast<volatile size_t*>(&word) = w & ~LOCK_FLAG;
+    }
+  }; // end of mirror_set
+
+} // end of namespace graphlab
+
+#endif
@@ -21,6 +21,13 @@
  */
 
 
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <cstring>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
 #include <boost/bind.hpp>
 #include <graphlab/util/random.hpp>
 #include <graphlab/parallel/fiber_control.hpp>
@@ -34,6 +41,9 @@ bool fiber_control::tls_created = false;
 bool fiber_control::instance_created = false;
 size_t fiber_control::instance_construct_params_nworkers = 0;
 size_t fiber_control::instance_construct_params_affinity_base = 0;
+bool fiber_control::instance_construct_params_guard_pages = false;
+size_t fiber_control::instance_construct_params_max_pooled_stack_bytes =
+    16 * 1024 * 1024;
 pthread_key_t fiber_control::tlskey;
 
 fiber_control::affinity_type fiber_control::all_affinity() {
@@ -43,27 +53,37 @@ fiber_control::affinity_type fiber_control::all_affinity() {
 }
 
 fiber_control::fiber_control(size_t nworkers, 
-                             size_t affinity_base)
+                             size_t affinity_base,
+                             bool guard_pages,
+                             size_t max_pooled_stack_bytes)
     :nworkers(nworkers),
     affinity_base(affinity_base),
     stop_workers(false),
-    flsdeleter(NULL) {
+    flsdeleter(NULL),
+    pools(nworkers + 1),
+    guard_pages(guard_pages),
+    max_pooled_stack_bytes(max_pooled_stack_bytes) {
   // initialize the thread local storage keys
   if (!tls_created) {
     pthread_key_create(&tlskey, fiber_control::tls_deleter);
     tls_created = true;
   }
 
+  ASSERT_LE(nworkers, MAX_WORKERS);
   // set up the queues.
   schedule.resize(nworkers);
   for (size_t i = 0;i < nworkers; ++i) {
     schedule[i].waiting = false;
+    schedule[i].idle = false;
     schedule[i].nwaiting = 0;
     schedule[i].affinity_queue = new inplace_lf_queue2<fiber>;
     schedule[i].priority_queue = new inplace_lf_queue2<fiber>;
     schedule[i].popped_affinity_queue = NULL;
     schedule[i].popped_priority_queue = NULL;
+    schedule[i].stealable_queue = new work_stealing_deque<fiber*>;
+    schedule[i].stealable_first = false;
   }
+  compute_steal_order();
   // launch the workers
   for (size_t i = 0;i < nworkers; ++i) {
     workers.launch(boost::bind(&fiber_control::worker_init, this, i), 
@@ -78,12 +98,19 @@ fiber_control::~fiber_control() {
     schedule[i].active_lock.lock();
     schedule[i].active_cond.broadcast();
     schedule[i].active_lock.unlock();
+  }
+  workers.join();
+  for (size_t i = 0;i < nworkers; ++i) {
     delete schedule[i].affinity_queue;
     delete schedule[i].priority_queue;
+    delete schedule[i].stealable_queue;
+  }
+  // free the fibers kept for recycling
+  for (size_t i = 0;i < pools.size(); ++i) {
+    foreach(stack_list& list, pools[i].lists) {
+      foreach(fiber* fib, list.fibers) free_fiber(fib);
+    }
   }
-  workers.join();
-
-
 
   pthread_key_delete(tlskey);
 }
@@ -115,6 +142,13 @@ fiber_control::fiber* fiber_control::get_active_fiber() {
 
 void fiber_control::active_queue_insert_tail(size_t workerid, fiber_control::fiber* value) {
   if (value->scheduleable) {
+    // a worker queues the fibers it schedules on itself where the idle
+    // workers may steal them, unless no other worker may run them
+    if (value->affinity_array.size() > 1 && workerid == get_worker_id()) {
+      schedule[workerid].stealable_queue->push(value);
+      if (idle_workers.value > 0) wake_idle_worker(workerid, value);
+      return;
+    }
 //     printf("%ld: Scheduling %ld on %ld\n", get_worker_id(), value->id, workerid);
     schedule[workerid].affinity_queue->enqueue(value);
     ++schedule[workerid].nwaiting;
@@ -163,12 +197,30 @@ fiber_control::fiber* fiber_control::try_pop_queue(inplace_lf_queue2<fiber>& lfq
   return ret;
 }
 
+// takes the top of a stealable queue, retrying while thieves race for it
+static fiber_control::fiber* pop_stealable(
+    work_stealing_deque<fiber_control::fiber*>& queue) {
+  fiber_control::fiber* ret = NULL;
+  while (!queue.empty()) {
+    if (queue.steal(ret)) return ret;
+  }
+  return NULL;
+}
+
 fiber_control::fiber* fiber_control::active_queue_remove(size_t workerid) {
   fiber_control::fiber* ret = NULL;
   thread_schedule& curts = schedule[workerid];
   ret = try_pop_queue(*curts.priority_queue, curts.popped_priority_queue);
   if (ret == NULL) {
-    ret = try_pop_queue(*curts.affinity_queue , curts.popped_affinity_queue);
+    // alternate between the two queues so that neither starves the other
+    curts.stealable_first = !curts.stealable_first;
+    if (curts.stealable_first) ret = pop_stealable(*curts.stealable_queue);
+    if (ret == NULL) {
+      ret = try_pop_queue(*curts.affinity_queue , curts.popped_affinity_queue);
+    }
+    if (ret == NULL && !curts.stealable_first) {
+      ret = pop_stealable(*curts.stealable_queue);
+    }
   }
   if (ret) {
     // printf("%ld: Running %ld\n", get_worker_id(), ret->id);
@@ -176,6 +228,102 @@ fiber_control::fiber* fiber_control::active_queue_remove(size_t workerid) {
   return ret;
 }
 
+// accepts the fibers whose affinity includes the worker
+struct affinity_includes {
+  size_t workerid;
+  affinity_includes(size_t workerid): workerid(workerid) { }
+  bool operator()(fiber_control::fiber* fib) const {
+    return fib->affinity.get(workerid);
+  }
+};
+
+fiber_control::fiber* fiber_control::steal_fiber(size_t workerid) {
+  fiber* ret = NULL;
+  foreach(size_t victim, schedule[workerid].steal_order) {
+    if (schedule[victim].stealable_queue->steal(ret,
+                                                affinity_includes(workerid))) {
+      fibers_stolen.inc();
+      return ret;
+    }
+  }
+  return NULL;
+}
+
+void fiber_control::wake_idle_worker(size_t workerid, fiber* fib) {
+  foreach(size_t other, schedule[workerid].steal_order) {
+    if (schedule[other].idle && fib->affinity.get(other)) {
+      schedule[other].active_lock.lock();
+      schedule[other].active_cond.signal();
+      schedule[other].active_lock.unlock();
+      return;
+    }
+  }
+}
+
+// the NUMA node of a cpu, from the nodeN link in its sysfs directory.
+// 0 if unknown
+static size_t cpu_numa_node(size_t cpu) {
+  std::stringstream path;
+  path << "/sys/devices/system/cpu/cpu" << cpu;
+  DIR* dir = opendir(path.str().c_str());
+  if (dir == NULL) return 0;
+  size_t node = 0;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (strncmp(entry->d_name, "node", 4) == 0) {
+      node = atol(entry->d_name + 4);
+      break;
+    }
+  }
+  closedir(dir);
+  return node;
+}
+
+// the distances from a NUMA node to the others. Empty if unknown
+static std::vector<size_t> numa_distances(size_t node) {
+  std::stringstream path;
+  path << "/sys/devices/system/node/node" << node << "/distance";
+  std::ifstream fin(path.str().c_str());
+  std::vector<size_t> ret;
+  size_t d;
+  while (fin >> d) ret.push_back(d);
+  return ret;
+}
+
+// orders the victims of a thief by NUMA distance, then by id
+struct victim_order {
+  const std::vector<size_t>* distance; // from the node of the thief
+  const std::vector<size_t>* node;     // of every worker
+  bool operator()(size_t a, size_t b) const {
+    return dist((*node)[a]) < dist((*node)[b]);
+  }
+  size_t dist(size_t n) const {
+    return n < distance->size() ? (*distance)[n] : size_t(-1);
+  }
+};
+
+void fiber_control::compute_steal_order() {
+  // the workers are pinned to the cpus from affinity_base, modulo the
+  // number of cpus
+  const size_t ncpus = std::max<size_t>(thread::cpu_count(), 1);
+  std::vector<size_t> node(nworkers);
+  for (size_t i = 0;i < nworkers; ++i) {
+    node[i] = cpu_numa_node((affinity_base + i) % ncpus);
+  }
+  for (size_t i = 0;i < nworkers; ++i) {
+    std::vector<size_t> distance = numa_distances(node[i]);
+    if (distance.empty()) distance.resize(node[i] + 1, 0);
+    // the thieves start after themselves so that they spread their steals
+    std::vector<size_t>& order = schedule[i].steal_order;
+    order.clear();
+    for (size_t j = 1;j < nworkers; ++j) order.push_back((i + j) % nworkers);
+    victim_order cmp;
+    cmp.distance = &distance;
+    cmp.node = &node;
+    std::stable_sort(order.begin(), order.end(), cmp);
+  }
+}
+
 void fiber_control::exit() {
   distributed_control* dc = distributed_control::get_instance();
   if (dc) dc->flush();
@@ -214,8 +362,23 @@ void fiber_control::worker_init(size_t workerid) {
   schedule[workerid].waiting = true;
   schedule[workerid].active_lock.lock();
   while(!stop_workers) {
-    // get a fiber to run
+    // get a fiber to run, or steal one
     fiber* next_fib = t->parent->active_queue_remove(workerid);
+    if (next_fib == NULL) next_fib = steal_fiber(workerid);
+    if (next_fib == NULL) {
+      // announce that this worker is idle before the last look, so that
+      // the workers queueing a stealable fiber afterwards wake it up
+      schedule[workerid].idle = true;
+      idle_workers.inc();
+      next_fib = steal_fiber(workerid);
+      if (next_fib == NULL) next_fib = active_queue_remove(workerid);
+      if (next_fib == NULL) {
+        // if there is no fiber. wait.
+        schedule[workerid].active_cond.wait(schedule[workerid].active_lock);
+      }
+      idle_workers.dec();
+      schedule[workerid].idle = false;
+    }
     if (next_fib != NULL) {
       // if there is a fiber. yield to it
       schedule[workerid].active_lock.unlock();
@@ -231,35 +394,129 @@ void fiber_control::worker_init(size_t workerid) {
       active_workers.dec();
       schedule[workerid].waiting = true;
       schedule[workerid].active_lock.lock();
-    } else {
-      // if there is no fiber. wait.
-      schedule[workerid].active_cond.wait(schedule[workerid].active_lock);
     }
   }
   schedule[workerid].active_lock.unlock();
 }
 
-struct trampoline_args {
-  boost::function<void(void)> fn;
-};
-
 // the trampoline to call the user function. This function never returns
-void fiber_control::trampoline(intptr_t _args) {
+void fiber_control::trampoline(intptr_t _fib) {
   // we may have launched to here by switching in from another fiber.
   // we will need to clean up the previous fiber
   tls* t = get_tls_ptr();
   if (t->prev_fiber) t->parent->reschedule_fiber(t->workerid, t->prev_fiber);
   t->prev_fiber = NULL;
 
-  trampoline_args* args = reinterpret_cast<trampoline_args*>(_args);
+  fiber* fib = reinterpret_cast<fiber*>(_fib);
   try {
-    args->fn();
+    fib->fn();
   } catch (...) {
   }
-  delete args;
+  // release the function, the fiber object will be recycled
+  fib->fn.clear();
   fiber_control::exit();
 }
 
+static size_t page_size() {
+  static size_t size = sysconf(_SC_PAGESIZE);
+  return size;
+}
+
+// the bytes mapped for a guarded stack, without the guard page
+static size_t guarded_stack_bytes(size_t stacksize) {
+  return (stacksize + page_size() - 1) / page_size() * page_size();
+}
+
+fiber_control::fiber* fiber_control::pop_pooled_fiber(fiber_pool& pool,
+                                                      size_t stacksize) {
+  if (pool.nfibers == 0) return NULL;
+  fiber* fib = NULL;
+  pool.lock.lock();
+  for (size_t i = 0;i < pool.lists.size(); ++i) {
+    stack_list& list = pool.lists[i];
+    if (list.stacksize == stacksize && !list.fibers.empty()) {
+      fib = list.fibers.back();
+      list.fibers.pop_back();
+      --pool.nfibers;
+      pool.stack_bytes -= stacksize;
+      break;
+    }
+  }
+  pool.lock.unlock();
+  return fib;
+}
+
+fiber_control::fiber* fiber_control::allocate_fiber(size_t stacksize) {
+  // the launches from outside the workers have their own pool
+  size_t own = std::min(get_worker_id(), nworkers);
+  fiber* fib = pop_pooled_fiber(pools[own], stacksize);
+  for (size_t i = 1;fib == NULL && i < pools.size(); ++i) {
+    fib = pop_pooled_fiber(pools[(own + i) % pools.size()], stacksize);
+  }
+  if (fib != NULL) {
+    fibers_recycled.inc();
+    return fib;
+  }
+  fib = new fiber;
+  fib->stacksize = stacksize;
+  fib->guarded = false;
+  if (guard_pages) {
+    // the stack grows downwards, towards the protected page
+    const size_t nbytes = page_size() + guarded_stack_bytes(stacksize);
+    void* mem = mmap(NULL, nbytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem != MAP_FAILED && mprotect(mem, page_size(), PROT_NONE) == 0) {
+      fib->stack = (char*)mem + page_size();
+      fib->guarded = true;
+    } else {
+      // every guarded stack takes two of the vm.max_map_count mappings
+      if (mem != MAP_FAILED) munmap(mem, nbytes);
+      static bool warned = false;
+      if (!warned) {
+        warned = true;
+        logstream(LOG_WARNING) << "Unable to map a guarded fiber stack. "
+                               << "Allocating unguarded stacks." << std::endl;
+      }
+    }
+  }
+  if (!fib->guarded) {
+    fib->stack = malloc(stacksize);
+    ASSERT_TRUE(fib->stack != NULL);
+  }
+  stacks_allocated.inc();
+  return fib;
+}
+
+void fiber_control::recycle_fiber(size_t workerid, fiber* fib) {
+  fiber_pool& pool = pools[std::min(workerid, nworkers)];
+  pool.lock.lock();
+  if (pool.stack_bytes + fib->stacksize <= max_pooled_stack_bytes) {
+    size_t i = 0;
+    while (i < pool.lists.size() && pool.lists[i].stacksize != fib->stacksize) ++i;
+    if (i == pool.lists.size()) {
+      pool.lists.push_back(stack_list());
+      pool.lists[i].stacksize = fib->stacksize;
+    }
+    pool.lists[i].fibers.push_back(fib);
+    ++pool.nfibers;
+    pool.stack_bytes += fib->stacksize;
+    pool.lock.unlock();
+  } else {
+    pool.lock.unlock();
+    free_fiber(fib);
+  }
+}
+
+void fiber_control::free_fiber(fiber* fib) {
+  if (fib->guarded) {
+    munmap((char*)fib->stack - page_size(),
+           page_size() + guarded_stack_bytes(fib->stacksize));
+  } else {
+    free(fib->stack);
+  }
+  delete fib;
+}
+
 size_t fiber_control::launch(boost::function<void(void)> fn, 
                              size_t stacksize, 
                              affinity_type affinity) {
@@ -269,13 +526,13 @@ size_t fiber_control::launch(boost::function<void(void)> fn,
   // make sure there is always a worker I can work on
   ASSERT_LT(b, nworkers);
 
-  // allocate a stack
-  fiber* fib = new fiber;
+  // allocate a stack, or recycle a terminated fiber and its stack
+  fiber* fib = allocate_fiber(stacksize);
   fib->parent = this;
-  fib->stack = malloc(stacksize);
   fib->id = fiber_id_counter.inc();
+  fib->affinity_array.clear();
   foreach(size_t b, affinity) {
-    if (b < nworkers) fib->affinity_array.push_back((unsigned char)b);
+    if (b < nworkers) fib->affinity_array.push_back((unsigned short)b);
     else break;
   }
   ASSERT_GT(fib->affinity_array.size(), 0);
@@ -287,10 +544,10 @@ size_t fiber_control::launch(boost::function<void(void)> fn,
   fib->terminate = false;
   fib->descheduled = false;
   fib->scheduleable = true;
+  fib->priority = false;
   // construct the initial context
-  trampoline_args* args = new trampoline_args;
-  args->fn = fn;
-  fib->initial_trampoline_args = (intptr_t)(args);
+  fib->fn = fn;
+  fib->initial_trampoline_args = (intptr_t)(fib);
   // stack grows downwards.
   fib->context = boost::context::make_fcontext((char*)fib->stack + stacksize,
                                                stacksize,
@@ -403,12 +660,12 @@ void fiber_control::reschedule_fiber(size_t workerid, fiber* fib) {
     fib->lock.unlock();
   } else if (fib->terminate) {
     fib->lock.unlock();
-    // previous fiber is dead. destroy it
-    free(fib->stack);
+    // previous fiber is dead. keep it and its stack for the next launch
     //VALGRIND_STACK_DEREGISTER(fib->stack);
     // delete the fiber local storage if any
     if (fib->fls && flsdeleter) flsdeleter(fib->fls);
-    delete fib;
+    fib->fls = NULL;
+    recycle_fiber(workerid, fib);
     // if we are out of threads, signal the join
     if (fibers_active.dec() == 0) {
       join_lock.lock();
@@ -483,7 +740,8 @@ bool fiber_control::worker_has_fibers_on_queue() {
   fiber_control* parentgroup = t->parent;
   size_t workerid = t->workerid;
   return !parentgroup->schedule[workerid].priority_queue->empty() ||
-          !parentgroup->schedule[workerid].affinity_queue->empty();
+          !parentgroup->schedule[workerid].affinity_queue->empty() ||
+          !parentgroup->schedule[workerid].stealable_queue->empty();
 }
 
 size_t fiber_control::get_worker_id() {
@@ -546,6 +804,13 @@ void fiber_control::instance_set_parameters(size_t nworkers = 0,
   instance_construct_params_affinity_base = affinity_base;
 }
 
+void fiber_control::instance_set_stack_parameters(bool guard_pages,
+                                                  size_t max_pooled_stack_bytes) {
+  ASSERT_FALSE(instance_created);
+  instance_construct_params_guard_pages = guard_pages;
+  instance_construct_params_max_pooled_stack_bytes = max_pooled_stack_bytes;
+}
+
 fiber_control& fiber_control::get_instance() {
   fiber_control::instance_created = true;
   // set sane defaults
@@ -553,7 +818,9 @@ fiber_control& fiber_control::get_instance() {
     instance_construct_params_nworkers = thread::cpu_count();
   }
   static fiber_control singleton(instance_construct_params_nworkers, 
-                                 instance_construct_params_affinity_base);
+                                 instance_construct_params_affinity_base,
+                                 instance_construct_params_guard_pages,
+                                 instance_construct_params_max_pooled_stack_bytes);
   return singleton;
 }
 
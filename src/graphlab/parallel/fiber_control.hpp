@@ -24,22 +24,32 @@
 #ifndef GRAPHLAB_FIBER_CONTROL_HPP
 #define GRAPHLAB_FIBER_CONTROL_HPP
 #include <cstdlib>
+#include <vector>
 #include <boost/context/all.hpp>
 #include <boost/function.hpp>
 #include <boost/lockfree/queue.hpp>
 #include <graphlab/util/dense_bitset.hpp>
 #include <graphlab/util/inplace_lf_queue2.hpp>
+#include <graphlab/parallel/work_stealing_deque.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/atomic.hpp>
 namespace graphlab {
 
 /**
  * The master controller for the user mode threading system
+ *
+ * Every worker runs the fibers of its queues: a priority queue, a queue
+ * of the fibers scheduled on it by other threads and a queue of the
+ * fibers it scheduled on itself. The fibers of the last queue which
+ * may also run on other workers are stolen by the idle workers, which
+ * try the workers of their own NUMA node first.
  */
 class fiber_control {
  public:
 
-  typedef fixed_dense_bitset<64> affinity_type;
+  /// The largest number of workers
+  static const size_t MAX_WORKERS = 1024;
+  typedef fixed_dense_bitset<MAX_WORKERS> affinity_type;
   static affinity_type all_affinity();
 
   struct fiber {
@@ -47,11 +57,14 @@ class fiber_control {
     fiber_control* parent;
     boost::context::fcontext_t* context;
     void* stack;
+    size_t stacksize;
+    bool guarded; // set if the stack was mmap'd below a guard page
     size_t id;
     affinity_type affinity;
-    std::vector<unsigned char> affinity_array;
+    std::vector<unsigned short> affinity_array;
     void* fls; // fiber local storage
     fiber* next;
+    boost::function<void (void)> fn; // the function the fiber runs
     intptr_t initial_trampoline_args;
     pthread_mutex_t* deschedule_lock; // if descheduled is set, we will
                                       // atomically deschedule and unlock
@@ -80,6 +93,8 @@ class fiber_control {
   atomic<size_t> fiber_id_counter;
   atomic<size_t> fibers_active;
   atomic<size_t> active_workers;
+  atomic<size_t> idle_workers;
+  atomic<size_t> fibers_stolen;
   mutex join_lock;
   conditional join_cond;
 
@@ -87,10 +102,12 @@ class fiber_control {
 
   // The scheduler is a simple queue. One for each worker
   struct thread_schedule {
-    thread_schedule():waiting(false) { }
+    thread_schedule():waiting(false), idle(false) { }
     mutex active_lock;
     conditional active_cond;
     volatile bool waiting;
+    volatile bool idle; // set while the worker looks for a fiber to steal
+                        // and sleeps
     size_t nwaiting;
     // a queue of fibers to evaluate before those in the thread_queue
     inplace_lf_queue2<fiber>* affinity_queue;
@@ -98,6 +115,16 @@ class fiber_control {
 
     inplace_lf_queue2<fiber>* priority_queue;
     fiber* popped_priority_queue;
+
+    // the fibers which may run on other workers, rescheduled or launched
+    // by this worker. Other workers steal them when idle.
+    work_stealing_deque<fiber*>* stealable_queue;
+    // alternates between the affinity queue and the stealable queue
+    bool stealable_first;
+
+    // the other workers by increasing NUMA distance, the order in which
+    // this worker steals from them
+    std::vector<size_t> steal_order;
   };
   std::vector<thread_schedule> schedule;
 
@@ -109,6 +136,12 @@ class fiber_control {
   void active_queue_insert_tail(size_t workerid, fiber* value);
   void active_queue_insert_tail(fiber* value);
   fiber* active_queue_remove(size_t workerid);
+  // steals a fiber which may run on workerid from the other workers
+  fiber* steal_fiber(size_t workerid);
+  // wakes up an idle worker, close to workerid, which may run fib
+  void wake_idle_worker(size_t workerid, fiber* fib);
+  // sets the steal order of the workers from the NUMA node of their cpus
+  void compute_steal_order();
 
   // a thread local storage for the worker to point to a fiber
   static bool tls_created;
@@ -144,13 +177,55 @@ class fiber_control {
 
   size_t pick_fiber_worker(fiber* fib);
 
+  /*
+   * Terminated fibers keep their stacks and are recycled by the next
+   * launches with the same stack size. There is a free list for each
+   * worker, where the fibers it terminates go, and one for the launches
+   * from outside the workers, which otherwise take from the worker
+   * free lists.
+   */
+  struct stack_list {
+    size_t stacksize;
+    std::vector<fiber*> fibers;
+  };
+  struct fiber_pool {
+    fiber_pool(): nfibers(0), stack_bytes(0) { }
+    simple_spinlock lock;
+    std::vector<stack_list> lists; // one for each stack size
+    volatile size_t nfibers;
+    size_t stack_bytes;
+  };
+  std::vector<fiber_pool> pools;
+  bool guard_pages;
+  size_t max_pooled_stack_bytes;
+  atomic<size_t> stacks_allocated;
+  atomic<size_t> fibers_recycled;
+
+  /// Takes a fiber with a stack of stacksize from the pools, or makes one
+  fiber* allocate_fiber(size_t stacksize);
+  /// Takes a fiber with a stack of stacksize from a pool. NULL if none
+  fiber* pop_pooled_fiber(fiber_pool& pool, size_t stacksize);
+  /// Returns a terminated fiber to the pool of the worker
+  void recycle_fiber(size_t workerid, fiber* fib);
+  /// Frees the fiber and its stack
+  void free_fiber(fiber* fib);
+
   // delete copy constructor
   fiber_control(fiber_control&) {};
   
  public:
 
-  /// Private constructor
-  fiber_control(size_t nworkers, size_t affinity_base);
+  /**
+   * Private constructor.
+   * \param guard_pages If set, the fiber stacks are mmap'd with a
+   *                    protected page below them, so that a stack
+   *                    overflow faults rather than corrupting the heap.
+   * \param max_pooled_stack_bytes The most bytes of stacks of terminated
+   *                    fibers kept by each worker for the next launches.
+   */
+  fiber_control(size_t nworkers, size_t affinity_base,
+                bool guard_pages = false,
+                size_t max_pooled_stack_bytes = 16 * 1024 * 1024);
 
   ~fiber_control();
 
@@ -189,6 +264,29 @@ class fiber_control {
   inline size_t total_threads_created() {
     return fiber_id_counter.value;
   }
+
+  /**
+   * Returns the number of fiber stacks ever allocated. The other
+   * launches recycled the stack of a terminated fiber.
+   */
+  inline size_t total_stacks_allocated() {
+    return stacks_allocated.value;
+  }
+
+  /**
+   * Returns the number of launches which recycled a terminated fiber
+   */
+  inline size_t total_fibers_recycled() {
+    return fibers_recycled.value;
+  }
+
+  /**
+   * Returns the number of fibers taken by idle workers from the queues
+   * of other workers
+   */
+  inline size_t total_fibers_stolen() {
+    return fibers_stolen.value;
+  }
   /**
    * Sets the TLS deletion function. The deletion function will be called
    * on every non-NULL TLS value.
@@ -249,6 +347,8 @@ class fiber_control {
   static bool instance_created; 
   static size_t instance_construct_params_nworkers; 
   static size_t instance_construct_params_affinity_base;
+  static bool instance_construct_params_guard_pages;
+  static size_t instance_construct_params_max_pooled_stack_bytes;
 
   /**
    * Sets the fiber control construction parameters.
@@ -264,6 +364,18 @@ class fiber_control {
   static void instance_set_parameters(size_t nworkers,
                                       size_t affinity_base);
 
+  /**
+   * Sets the stack parameters of the fiber control singleton.
+   * Must be called prior to any other calls to get_instance()
+   * \param guard_pages If set, every fiber stack has a protected page
+   *                    below it to catch stack overflows. Defaults to
+   *                    false.
+   * \param max_pooled_stack_bytes The most bytes of stacks each worker
+   *                    keeps to recycle. Defaults to 16MB.
+   */
+  static void instance_set_stack_parameters(bool guard_pages,
+                                            size_t max_pooled_stack_bytes);
+
   /**
    * Gets a reference to the main fiber control singleton
    */
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_WORK_STEALING_DEQUE_HPP
+#define GRAPHLAB_WORK_STEALING_DEQUE_HPP
+#include <stdint.h>
+#include <vector>
+namespace graphlab {
+
+/*
+ * A Chase-Lev work stealing deque of T, a pointer or another small
+ * trivially copyable type.
+ *
+ * Only the owner thread may push(), at the bottom. Any thread, the
+ * owner included, may steal() from the top: the deque is consumed in
+ * FIFO order. The circular array doubles when full. The replaced
+ * arrays may still be read by a concurrent steal() and are only freed
+ * with the deque.
+ */
+template <typename T>
+class work_stealing_deque {
+ public:
+  explicit work_stealing_deque(size_t initial_capacity = 64)
+      :top(0), bottom(0) {
+    size_t capacity = 1;
+    while (capacity < initial_capacity) capacity *= 2;
+    arr = new circular_array(capacity);
+  }
+
+  ~work_stealing_deque() {
+    delete arr;
+    for (size_t i = 0;i < retired.size(); ++i) delete retired[i];
+  }
+
+  /// Adds an element at the bottom. Only called by the owner thread.
+  void push(const T& value) {
+    int64_t b = __atomic_load_n(&bottom, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&top, __ATOMIC_ACQUIRE);
+    circular_array* a = arr;
+    if (b - t >= (int64_t)a->capacity) {
+      circular_array* bigger = new circular_array(2 * a->capacity);
+      for (int64_t i = t;i < b; ++i) bigger->put(i, a->get(i));
+      retired.push_back(a);
+      __atomic_store_n(&arr, bigger, __ATOMIC_RELEASE);
+      a = bigger;
+    }
+    a->put(b, value);
+    __atomic_store_n(&bottom, b + 1, __ATOMIC_RELEASE);
+  }
+
+  /**
+   * Takes the element at the top if accept(element) is true. Returns
+   * false if the deque is empty, if accept refused the element or if
+   * another thread took it first.
+   */
+  template <typename Accept>
+  bool steal(T& ret, Accept accept) {
+    int64_t t = __atomic_load_n(&top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) return false;
+    circular_array* a = __atomic_load_n(&arr, __ATOMIC_ACQUIRE);
+    T value = a->get(t);
+    if (!accept(value)) return false;
+    if (!__atomic_compare_exchange_n(&top, &t, t + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+      return false;
+    }
+    ret = value;
+    return true;
+  }
+
+  /// Takes the element at the top. Returns false if none was taken.
+  bool steal(T& ret) {
+    return steal(ret, accept_all());
+  }
+
+  bool empty() const {
+    return __atomic_load_n(&bottom, __ATOMIC_ACQUIRE) <=
+           __atomic_load_n(&top, __ATOMIC_ACQUIRE);
+  }
+
+  /// The number of elements. Only exact when no thread modifies the deque.
+  size_t approx_size() const {
+    int64_t n = __atomic_load_n(&bottom, __ATOMIC_ACQUIRE) -
+                __atomic_load_n(&top, __ATOMIC_ACQUIRE);
+    return n > 0 ? n : 0;
+  }
+
+ private:
+  struct accept_all {
+    bool operator()(const T&) const { return true; }
+  };
+
+  struct circular_array {
+    size_t capacity; // a power of 2
+    T* data;
+    explicit circular_array(size_t capacity)
+        :capacity(capacity), data(new T[capacity]) { }
+    ~circular_array() { delete [] data; }
+    T get(int64_t i) const {
+      return __atomic_load_n(&data[i & (capacity - 1)], __ATOMIC_RELAXED);
+    }
+    void put(int64_t i, T value) {
+      __atomic_store_n(&data[i & (capacity - 1)], value, __ATOMIC_RELAXED);
+    }
+  };
+
+  // top and bottom on separate cache lines: the thieves write top and
+  // the owner writes bottom
+  char pad0[64];
+  int64_t top;
+  char pad1[64];
+  int64_t bottom;
+  char pad2[64];
+  circular_array* arr;
+  std::vector<circular_array*> retired; // only touched by the owner
+
+  // not copyable
+  work_stealing_deque(const work_stealing_deque&);
+  work_stealing_deque& operator=(const work_stealing_deque&);
+};
+
+} // namespace graphlab
+
+#endif
@@ -24,10 +24,12 @@
 #ifndef GRAPHLAB_BUFFERED_EXCHANGE_HPP
 #define GRAPHLAB_BUFFERED_EXCHANGE_HPP
 
+#include <boost/function.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/fiber_control.hpp>
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/rpc/exchange_compression.hpp>
 #include <graphlab/util/mpi_tools.hpp>
 
 
@@ -63,6 +65,9 @@ namespace graphlab {
    * \note The buffered exchange sends data in the background, so recv can be
    * called even before the flush calls.
    *
+   * \note Bulk exchanges of compressible data, such as vertex ids, can
+   * trade CPU time for network bandwidth with set_compression(true).
+   *
    * \see graphlab::fiber_buffered_exchange
    */
   template<typename T>
@@ -95,10 +100,15 @@ namespace graphlab {
     std::vector< mutex >  send_locks;
     const size_t num_threads;
     const size_t max_buffer_size;
+    dc_impl::exchange_compression compression;
+
 
+  public:
+    /// Consumes a buffer received from a machine instead of queuing it
+    typedef boost::function<void (procid_t, buffer_type&)> handler_type;
 
-    // typedef boost::function<void (const T& tref)> handler_type;
-    // handler_type recv_handler;
+  private:
+    handler_type recv_handler;
 
   public:
     /**
@@ -162,7 +172,7 @@ namespace graphlab {
         oarchive* prevarc = swap_buffer(index);
         send_locks[index].unlock();
         // complete the send
-        rpc.split_call_end(proc, prevarc);
+        send_buffer(proc, prevarc);
       } else {
         send_locks[index].unlock();
       }
@@ -180,7 +190,7 @@ namespace graphlab {
           oarchive* prevarc = swap_buffer(index);
           send_locks[index].unlock();
           // complete the send
-          rpc.split_call_end(proc, prevarc);
+          send_buffer(proc, prevarc);
           rpc.dc().flush_soon(proc);
         }
       }
@@ -198,7 +208,7 @@ namespace graphlab {
         if (send_buffers[i].numinserts > 0) {
           oarchive* prevarc = swap_buffer(i);
           // complete the send
-          rpc.split_call_end(proc, prevarc);
+          send_buffer(proc, prevarc);
         }
         send_locks[i].unlock();
       }
@@ -271,10 +281,47 @@ namespace graphlab {
      */
     bool empty() const { return recv_buffers.empty(); }
 
+    /**
+     * Hands every buffer received from now on to handler, on the rpc
+     * handler threads, instead of queuing it for recv(). Buffers
+     * already queued stay available to recv(). The handler must be
+     * thread-safe. An empty handler restores queuing.
+     */
+    void set_recv_handler(const handler_type& handler) {
+      recv_lock.lock();
+      recv_handler = handler;
+      recv_lock.unlock();
+    }
+
+    /**
+     * Compresses the send buffers of this machine with lz_compress() if
+     * enable is set. Buffers which do not compress well are still sent
+     * as they are. The receivers need not enable compression.
+     */
+    void set_compression(bool enable) { compression.set_enabled(enable); }
+
+    /**
+     * Returns the compression ratio and time of the buffers sent and
+     * received by this machine.
+     */
+    const dc_impl::exchange_compression& get_compression() const {
+      return compression;
+    }
+
     void clear() { }
 
     void barrier() { rpc.barrier(); }
   private:
+    void rpc_recv_compressed(size_t len, wild_pointer w) {
+      size_t rawlen = 0;
+      char* raw = compression.decompress(reinterpret_cast<const char*>(w.ptr),
+                                         len, rawlen);
+      wild_pointer rawptr;
+      rawptr.ptr = raw;
+      rpc_recv(rawlen, rawptr);
+      free(raw);
+    }
+
     void rpc_recv(size_t len, wild_pointer w) {
       buffer_type tmp;
       iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
@@ -294,6 +341,12 @@ namespace graphlab {
       }
 
       recv_lock.lock();
+      if (recv_handler) {
+        handler_type handler = recv_handler;
+        recv_lock.unlock();
+        handler(src_proc, tmp);
+        return;
+      }
       recv_buffers.push_back(buffer_record());
       buffer_record& rec = recv_buffers.back();
       rec.proc = src_proc;
@@ -302,6 +355,17 @@ namespace graphlab {
     } // end of rpc rcv
 
 
+    // completes the send of a buffer returned by swap_buffer
+    void send_buffer(procid_t proc, oarchive* arc) {
+      if (compression.is_enabled()) {
+        oarchive* carc =
+            rpc.split_call_begin(&buffered_exchange::rpc_recv_compressed);
+        if (compression.compress(*arc, *carc)) std::swap(arc, carc);
+        rpc.split_call_cancel(carc);
+      }
+      rpc.split_call_end(proc, arc);
+    }
+
     // create a new buffer for send_buffer[index], returning the old buffer
     oarchive* swap_buffer(size_t index) {
       oarchive* swaparc = rpc.split_call_begin(&buffered_exchange::rpc_recv);
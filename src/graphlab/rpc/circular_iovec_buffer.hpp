@@ -25,6 +25,7 @@
 #define GRAPHLAB_RPC_CIRCULAR_IOVEC_BUFFER_HPP
 #include <vector>
 #include <sys/socket.h>
+#include <graphlab/rpc/send_buffer_pool.hpp>
 
 namespace graphlab{
 namespace dc_impl {
@@ -108,7 +109,8 @@ struct circular_iovec_buffer {
    * This buffer will take over all iovec pointers and free them when done.
    * This version of write allows the iovec that is sent to be different from the
    * iovec that is freed. (for instance, what is sent could be subarray of
-   * what is to be freed.
+   * what is to be freed. The length of actual_ptr_entry is the capacity
+   * passed to release_send_buffer().
    */
   inline void write(const iovec &entry, const iovec& actual_ptr_entry) {
     if (numel == v.size()) {
@@ -122,10 +124,11 @@ struct circular_iovec_buffer {
 
 
   /**
-   * Erases a single iovec from the head and free the pointer
+   * Erases a single iovec from the head and free the pointer, returning
+   * it to the send buffer pool if it has the pooled size.
    */
   inline void erase_from_head_and_free() {
-    free(v[head].iov_base);
+    release_send_buffer((char*)v[head].iov_base, v[head].iov_len);
     head = (head + 1) & (v.size() - 1);
     --numel;
   }
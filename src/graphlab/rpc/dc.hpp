@@ -85,7 +85,12 @@ struct dc_init_param{
   /** Additional construction options of the form
     "key1=value1,key2=value2".
 
-    There are no available options at this time.
+    \li \b shm=0 Sends everything through TCP, including to the processes
+                  on the same host which otherwise exchange through shared
+                  memory rings in /dev/shm. The environment variable
+                  GRAPHLAB_SHM_COMM=0 does the same.
+    \li \b shm_ring_size=BYTES The size of each shared memory ring.
+                  Defaults to \ref RPC_SHM_RING_BYTES.
 
     Internal options which should not be used
     \li \b __socket__=NUMBER Forces TCP comm to use this socket number for its
@@ -180,6 +185,7 @@ namespace dc_impl {
  * \li distributed_control::broadcast()
  * \li distributed_control::all_reduce()
  * \li distributed_control::all_reduce2()
+ * \li distributed_control::all_reduce_vector()
  * \li distributed_control::gather()
  * \li distributed_control::all_gather()
  *
@@ -1009,8 +1015,9 @@ class distributed_control{
   /**
    * \brief Writes a string to the send buffer and flushes
    */
-  inline void write_to_buffer(procid_t target, char* c, size_t len) {
-    senders[target]->write_to_buffer(c, len);
+  inline void write_to_buffer(procid_t target, char* c, size_t len,
+                              size_t capacity) {
+    senders[target]->write_to_buffer(c, len, capacity);
   }
 
 
@@ -1298,6 +1305,41 @@ class distributed_control{
   template <typename U, typename PlusEqual>
   inline void all_reduce2(U& data, PlusEqual plusequal, bool control = false);
 
+  /**
+   * \brief Adds up a vector contributed by each machine element by
+   * element, making the result available to all machines.
+   *
+   * Each machine calls all_reduce_vector() with a vector of the same
+   * length, of a serializable element type which implements operator+=.
+   * When all_reduce_vector() returns, element i of "data" is the sum of
+   * the elements i contributed by each machine.
+   *
+   * Small vectors are reduced with the all_reduce() tree, which moves
+   * every contribution through machine 0. Vectors of at least
+   * RPC_RING_ALL_REDUCE_BYTES (by default, see
+   * dc_dist_object::set_ring_all_reduce_bytes()) are reduced around a ring
+   * of the machines instead (a reduce-scatter followed by an all gather),
+   * where each machine sends and receives about twice the size of the
+   * vector whatever the number of machines. Blocks of POD elements are sent
+   * without per element serialization.
+   *
+   * Example:
+   * \code
+   * std::vector<double> counts(1000000, 1.0);
+   * dc.all_reduce_vector(counts);
+   * // all machines will have counts[i] = numprocs() here.
+   * \endcode
+   *
+   * \param data  The vector to reduce. Must have the same length on all
+   *              machines and must not be a std::vector<bool>.
+   * \param control Optional parameter. Defaults to false. If set to true,
+   *                this will marked as control plane communication and will
+   *                not register in bytes_received() or bytes_sent(). This must
+   *                be the same on all machines.
+   */
+  template <typename E>
+  inline void all_reduce_vector(std::vector<E>& data, bool control = false);
+
 
    /**
     \brief A distributed barrier which waits for all machines to call the
@@ -1448,6 +1490,11 @@ inline void distributed_control::all_reduce2(U& data, PlusEqual plusequal, bool
   distributed_services->all_reduce2(data, plusequal, control);
 }
 
+template <typename E>
+inline void distributed_control::all_reduce_vector(std::vector<E>& data, bool control) {
+  distributed_services->all_reduce_vector(data, control);
+}
+
 
 
 
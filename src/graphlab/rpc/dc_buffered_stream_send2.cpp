@@ -50,9 +50,15 @@ namespace dc_impl {
     return ret;
   }
 
-  void dc_buffered_stream_send2::write_to_buffer(char* c, size_t len)  {
+  void dc_buffered_stream_send2::write_to_buffer(char* c, size_t len,
+                                                 size_t capacity)  {
     lock.lock();
-    additional_flush_buffers.push_back(std::make_pair(c, len));
+    buffer_elem elem;
+    elem.buf = c;
+    elem.len = len;
+    elem.capacity = capacity;
+    elem.next = NULL;
+    additional_flush_buffers.push_back(elem);
     lock.unlock();
   }
 
@@ -92,11 +98,13 @@ namespace dc_impl {
       if (bufs.first != NULL) {
         while(bufs.first != bufs.second) {
           buffer_elem* prev = bufs.first;
-          iovec sendvec;
+          iovec sendvec, bufvec;
           sendvec.iov_base = bufs.first->buf;
           sendvec.iov_len = bufs.first->len;
+          bufvec.iov_base = bufs.first->buf;
+          bufvec.iov_len = bufs.first->capacity;
           sendlen += sendvec.iov_len;
-          outdata.write(sendvec);
+          outdata.write(sendvec, bufvec);
           buffer_elem** next = &bufs.first->next;
           volatile buffer_elem** n = (volatile buffer_elem**)(next);
           while(__unlikely__((*n) == NULL)) {
@@ -108,12 +116,16 @@ namespace dc_impl {
       }
     }
     for (size_t i = 0;i < additional_flush_buffers.size(); ++i) {
-      iovec sendvec;
-      sendvec.iov_base = additional_flush_buffers[i].first;
-      sendvec.iov_len = additional_flush_buffers[i].second;
+      iovec sendvec, bufvec;
+      sendvec.iov_base = additional_flush_buffers[i].buf;
+      sendvec.iov_len = additional_flush_buffers[i].len;
+      bufvec.iov_base = additional_flush_buffers[i].buf;
+      bufvec.iov_len = additional_flush_buffers[i].capacity;
       sendlen += sendvec.iov_len;
-      outdata.write(sendvec);
+      outdata.write(sendvec, bufvec);
     }
+    // the buffers now belong to outdata
+    additional_flush_buffers.clear();
     lock.unlock();
     return sendlen;
   }
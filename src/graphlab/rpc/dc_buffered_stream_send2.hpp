@@ -78,7 +78,7 @@ class dc_buffered_stream_send2: public dc_send{
 
   inline size_t bytes_sent();
 
-  void write_to_buffer(char* c, size_t len);
+  void write_to_buffer(char* c, size_t len, size_t capacity);
 
   void flush();
 
@@ -99,7 +99,7 @@ class dc_buffered_stream_send2: public dc_send{
   // get_outgoing_data is called
   std::vector<std::vector<std::pair<char*, size_t> > > to_send;
 
-  std::vector<std::pair<char*, size_t> > additional_flush_buffers;
+  std::vector<buffer_elem> additional_flush_buffers;
   mutex lock;
 };
 
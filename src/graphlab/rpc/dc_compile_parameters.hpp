@@ -35,9 +35,27 @@
 /**
   \ingroup rpc
   \def RPC_MAX_N_PROCS
-  \brief Maximum number of processes supported
+  \brief Maximum number of processes supported.
+  Bounded by the width of procid_t, where procid_t(-1) is reserved.
  */
-#define RPC_MAX_N_PROCS 128
+#define RPC_MAX_N_PROCS 65535
+
+/**
+  \ingroup rpc
+  \def RPC_DENSE_MAX_N_PROCS
+  \brief Maximum number of processes supported by structures which keep
+  a fixed width bitset over all processes, such as the greedy ingress
+  methods.
+ */
+#define RPC_DENSE_MAX_N_PROCS 128
+
+/**
+ * \ingroup RPC
+ * \def RPC_SHM_RING_BYTES
+ * The size of each shared memory ring between two processes on the same
+ * host. Every process allocates one ring for each process of its host.
+ */
+#define RPC_SHM_RING_BYTES (1024 * 1024)
 
 /**
  * \ingroup RPC
@@ -94,6 +112,14 @@
  */
 #define NUM_FULL_BUFFER_LIMIT 32 
 
+/**
+ * \ingroup RPC
+ * \def RPC_SEND_BUFFER_POOL_SIZE
+ * The most send buffers of INITIAL_BUFFER_SIZE bytes which are kept for
+ * reuse once they have been sent, instead of being freed.
+ */
+#define RPC_SEND_BUFFER_POOL_SIZE 256
+
 /**************************************************************************/
 /*                                                                        */
 /*                          RPC Handling Control                          */
@@ -145,5 +171,14 @@
  */
 #define DEFAULT_BUFFERED_EXCHANGE_SIZE FULL_BUFFER_SIZE_LIMIT
 
+/**
+ * \ingroup RPC
+ * \def RPC_RING_ALL_REDUCE_BYTES
+ * Vectors of at least this many bytes are combined by
+ * dc_dist_object::all_reduce_vector() around a ring of machines instead
+ * of up and down the all_reduce() tree.
+ */
+#define RPC_RING_ALL_REDUCE_BYTES (256 * 1024)
+
 
 #endif
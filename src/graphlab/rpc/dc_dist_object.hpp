@@ -28,6 +28,8 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <map>
+#include <cstring>
 #include <graphlab/parallel/atomic.hpp>
 #include <graphlab/parallel/fiber_conditional.hpp>
 #include <graphlab/rpc/dc_internal_types.hpp>
@@ -38,6 +40,7 @@
 #include <graphlab/rpc/function_ret_type.hpp>
 #include <graphlab/rpc/mem_function_arg_types_def.hpp>
 #include <graphlab/util/charstream.hpp>
+#include <graphlab/serialization/is_pod.hpp>
 #include <boost/preprocessor.hpp>
 #include <graphlab/util/tracepoint.hpp>
 #include <graphlab/rpc/request_reply_handler.hpp>
@@ -48,6 +51,63 @@
 
 namespace graphlab {
 
+namespace dc_impl {
+
+/**
+ * \internal
+ * Encodes and combines the chunks of a vector exchanged by
+ * dc_dist_object::all_reduce_vector(). Elements are serialized one at
+ * a time, and POD elements are copied as a block.
+ */
+template <bool IsPOD>
+struct ring_chunk_codec {
+  template <typename E>
+  static std::string encode(const E* begin, size_t len) {
+    charstream strm(128);
+    oarchive oarc(strm);
+    for (size_t i = 0;i < len; ++i) oarc << begin[i];
+    strm.flush();
+    return std::string(strm->c_str(), strm->size());
+  }
+  template <typename E>
+  static void add(const std::string& chunk, E* begin, size_t len) {
+    iarchive iarc(chunk.c_str(), chunk.length());
+    E tmp;
+    for (size_t i = 0;i < len; ++i) {
+      iarc >> tmp;
+      begin[i] += tmp;
+    }
+  }
+  template <typename E>
+  static void assign(const std::string& chunk, E* begin, size_t len) {
+    iarchive iarc(chunk.c_str(), chunk.length());
+    for (size_t i = 0;i < len; ++i) iarc >> begin[i];
+  }
+};
+
+template <>
+struct ring_chunk_codec<true> {
+  template <typename E>
+  static std::string encode(const E* begin, size_t len) {
+    return std::string(reinterpret_cast<const char*>(begin), len * sizeof(E));
+  }
+  template <typename E>
+  static void add(const std::string& chunk, E* begin, size_t len) {
+    ASSERT_EQ(chunk.length(), len * sizeof(E));
+    // the string is not necessarily aligned for E
+    std::vector<E> tmp(len);
+    if (len > 0) memcpy(&tmp[0], chunk.c_str(), chunk.length());
+    for (size_t i = 0;i < len; ++i) begin[i] += tmp[i];
+  }
+  template <typename E>
+  static void assign(const std::string& chunk, E* begin, size_t len) {
+    ASSERT_EQ(chunk.length(), len * sizeof(E));
+    if (len > 0) memcpy(begin, chunk.c_str(), chunk.length());
+  }
+};
+
+} // namespace dc_impl
+
 
 /**
 \ingroup rpc
@@ -235,6 +295,9 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
     ab_barrier_sense = 1;
     ab_barrier_release = -1;
 
+    //-------- Initialize the ring all reduce ------
+    ring_seq = 0;
+    ring_all_reduce_bytes = RPC_RING_ALL_REDUCE_BYTES;
 
     //-------- Initialize the full barrier ---------
 
@@ -1296,6 +1359,151 @@ private:
     all_reduce2(data, default_plus_equal<U>(), control);
   }
 
+
+
+/*****************************************************************************
+                      Implementation of Vector All Reduce
+ *****************************************************************************/
+ private:
+  /*
+   * The ring all reduce splits the vector into numprocs() chunks.
+   * Machine i sends to machine i+1 and receives from machine i-1. In the
+   * numprocs()-1 reduce-scatter steps, every machine sends a chunk and
+   * adds the chunk it receives into its own, after which machine i holds
+   * the sum of chunk i+1. In the numprocs()-1 all gather steps, the
+   * summed chunks are passed around the ring and overwrite the local
+   * ones. Every machine sends and receives about 2 * size bytes, however
+   * many machines there are.
+   */
+  size_t ring_seq;
+  size_t ring_all_reduce_bytes;
+  mutex ring_mut;
+  fiber_conditional ring_cond;
+  /// the received chunks by (ring_seq, step)
+  std::map<std::pair<size_t, size_t>, std::string> ring_chunks;
+
+  void __ring_receive(size_t seq, size_t step, std::string chunk) {
+    ring_mut.lock();
+    ring_chunks[std::make_pair(seq, step)].swap(chunk);
+    ring_cond.broadcast();
+    ring_mut.unlock();
+  }
+
+  std::string ring_wait(size_t seq, size_t step) {
+    std::string chunk;
+    std::pair<size_t, size_t> key(seq, step);
+    ring_mut.lock();
+    while(1) {
+      std::map<std::pair<size_t, size_t>, std::string>::iterator iter =
+          ring_chunks.find(key);
+      if (iter != ring_chunks.end()) {
+        chunk.swap(iter->second);
+        ring_chunks.erase(iter);
+        break;
+      }
+      ring_cond.wait(ring_mut);
+    }
+    ring_mut.unlock();
+    return chunk;
+  }
+
+  template <typename E>
+  void ring_send(size_t seq, size_t step, const std::vector<E>& data,
+                 size_t chunk, bool control) {
+    const size_t begin = ring_chunk_begin(chunk, data.size(), numprocs());
+    const size_t end = ring_chunk_begin(chunk + 1, data.size(), numprocs());
+    std::string s =
+        dc_impl::ring_chunk_codec<gl_is_pod<E>::value>::encode(&data[0] + begin,
+                                                              end - begin);
+    procid_t next = (procid_t)((procid() + 1) % numprocs());
+    if (control) {
+      internal_control_call(next, &dc_dist_object<T>::__ring_receive,
+                            seq, step, s);
+    }
+    else {
+      internal_call(next, &dc_dist_object<T>::__ring_receive,
+                    seq, step, s);
+    }
+  }
+
+  template <typename E>
+  void ring_all_reduce(std::vector<E>& data, bool control) {
+    typedef dc_impl::ring_chunk_codec<gl_is_pod<E>::value> codec;
+    const size_t nprocs = numprocs();
+    const size_t n = data.size();
+    const size_t seq = ring_seq++;
+    for (size_t step = 0;step < nprocs - 1; ++step) {
+      ring_send(seq, step, data,
+                ring_reduce_send_chunk(procid(), step, nprocs), control);
+      std::string s = ring_wait(seq, step);
+      size_t chunk = ring_reduce_recv_chunk(procid(), step, nprocs);
+      size_t begin = ring_chunk_begin(chunk, n, nprocs);
+      codec::add(s, &data[0] + begin,
+                 ring_chunk_begin(chunk + 1, n, nprocs) - begin);
+    }
+    for (size_t step = 0;step < nprocs - 1; ++step) {
+      ring_send(seq, nprocs - 1 + step, data,
+                ring_gather_send_chunk(procid(), step, nprocs), control);
+      std::string s = ring_wait(seq, nprocs - 1 + step);
+      size_t chunk = ring_gather_recv_chunk(procid(), step, nprocs);
+      size_t begin = ring_chunk_begin(chunk, n, nprocs);
+      codec::assign(s, &data[0] + begin,
+                    ring_chunk_begin(chunk + 1, n, nprocs) - begin);
+    }
+  }
+
+  template <typename E>
+  struct vector_plus_equal {
+    void operator()(std::vector<E>& u, const std::vector<E>& v) {
+      ASSERT_EQ(u.size(), v.size());
+      for (size_t i = 0;i < u.size(); ++i) u[i] += v[i];
+    }
+  };
+
+ public:
+  /// The first element of chunk c when n elements are split into p chunks
+  static size_t ring_chunk_begin(size_t c, size_t n, size_t p) {
+    return (n / p) * c + std::min(c, n % p);
+  }
+  /// The chunk machine i sends in reduce-scatter step s of p machines
+  static size_t ring_reduce_send_chunk(size_t i, size_t s, size_t p) {
+    return (i + p - s) % p;
+  }
+  /// The chunk machine i receives and adds in reduce-scatter step s
+  static size_t ring_reduce_recv_chunk(size_t i, size_t s, size_t p) {
+    return (i + 2 * p - s - 1) % p;
+  }
+  /// The chunk machine i sends in all gather step s of p machines
+  static size_t ring_gather_send_chunk(size_t i, size_t s, size_t p) {
+    return (i + 1 + p - s) % p;
+  }
+  /// The chunk machine i receives and overwrites in all gather step s
+  static size_t ring_gather_recv_chunk(size_t i, size_t s, size_t p) {
+    return (i + p - s) % p;
+  }
+
+  /**
+   * Sets the size in bytes from which all_reduce_vector() switches
+   * from the tree to the ring. Must be the same on all machines.
+   * Defaults to RPC_RING_ALL_REDUCE_BYTES.
+   */
+  void set_ring_all_reduce_bytes(size_t bytes) {
+    ring_all_reduce_bytes = bytes;
+  }
+
+  /// \copydoc distributed_control::all_reduce_vector()
+  template <typename E>
+  void all_reduce_vector(std::vector<E>& data, bool control = false) {
+    if (numprocs() == 1) return;
+    if (data.size() * sizeof(E) < ring_all_reduce_bytes ||
+        data.size() < numprocs()) {
+      all_reduce2(data, vector_plus_equal<E>(), control);
+    }
+    else {
+      ring_all_reduce(data, control);
+    }
+  }
+
 ////////////////////////////////////////////////////////////////////////////
 
 
@@ -139,6 +139,7 @@ struct terminator_token {
 struct buffer_elem {
   char* buf;
   size_t len;
+  size_t capacity; /// allocated bytes of buf. See release_send_buffer()
   buffer_elem* next;
 };
 
@@ -73,9 +73,10 @@ class dc_send{
   /**
    * Writes a string to an internal buffer to be flushed later.
    * This is a "slow path" to be used only when the thread local buffer
-   * is not available.
+   * is not available. capacity is the allocated size of c, which is
+   * freed with release_send_buffer() once sent.
    */
-  virtual void write_to_buffer(char* c, size_t len) = 0;
+  virtual void write_to_buffer(char* c, size_t len, size_t capacity) = 0;
 
   virtual size_t set_option(std::string opt, size_t val) {
     return 0;
@@ -113,6 +113,12 @@ namespace graphlab {
       rmi.all_reduce2(data, plusequal, control);
     }
 
+    /// \copydoc distributed_control::all_reduce_vector()
+    template <typename E>
+    void all_reduce_vector(std::vector<E>& data, bool control = false) {
+      rmi.all_reduce_vector(data, control);
+    }
+
     /// \copydoc distributed_control::barrier()
     inline void barrier() {
       rmi.barrier();
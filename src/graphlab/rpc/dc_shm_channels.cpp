@@ -0,0 +1,321 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <algorithm>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <time.h>
+#endif
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/util/stl_util.hpp>
+#include <graphlab/rpc/dc_shm_channels.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+#define SHM_INBOX_MAGIC 0x676c73686d626f78ULL
+#define SHM_INBOX_HEADER_BYTES 4096
+#define SHM_RING_HEADER_BYTES 256
+
+// The fields written by different processes are on separate cache lines
+struct dc_shm_channels::inbox_header {
+  uint64_t magic;
+  uint64_t nrings;
+  uint64_t ring_bytes;
+  char pad0[40];
+  uint32_t doorbell;
+  uint32_t sleeping;  // the reader is about to sleep on the doorbell
+  char pad1[56];
+  uint32_t nattached; // the number of processes which mapped the inbox
+};
+
+struct dc_shm_channels::ring_header {
+  uint64_t head;  // written by the writer
+  char pad0[56];
+  uint64_t tail;  // written by the reader
+  char pad1[56];
+  uint32_t writer_waiting; // the writer found the ring full
+};
+
+#ifdef __linux__
+static void futex_wait(uint32_t* addr, uint32_t val, size_t timeout_us) {
+  struct timespec t;
+  t.tv_sec = timeout_us / 1000000;
+  t.tv_nsec = (timeout_us % 1000000) * 1000;
+  syscall(SYS_futex, addr, FUTEX_WAIT, val, &t, NULL, 0);
+}
+
+static void futex_wake(uint32_t* addr) {
+  syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+#endif
+
+dc_shm_channels::dc_shm_channels()
+    :curid(0), ring_bytes(0), unlinked(true) { }
+
+size_t dc_shm_channels::inbox_bytes() const {
+  return SHM_INBOX_HEADER_BYTES +
+      locals.size() * (SHM_RING_HEADER_BYTES + ring_bytes);
+}
+
+dc_shm_channels::inbox_header*
+dc_shm_channels::header(const inbox& box) const {
+  return reinterpret_cast<inbox_header*>(box.base);
+}
+
+dc_shm_channels::ring_header*
+dc_shm_channels::ring(const inbox& box, size_t writer_rank) const {
+  return reinterpret_cast<ring_header*>(
+      box.base + SHM_INBOX_HEADER_BYTES +
+      writer_rank * (SHM_RING_HEADER_BYTES + ring_bytes));
+}
+
+char* dc_shm_channels::ring_data(const inbox& box, size_t writer_rank) const {
+  return reinterpret_cast<char*>(ring(box, writer_rank)) +
+      SHM_RING_HEADER_BYTES;
+}
+
+std::string dc_shm_channels::inbox_name(procid_t proc) const {
+  return prefix + tostr(proc);
+}
+
+bool dc_shm_channels::create(const std::string& prefix_, procid_t nprocs,
+                             procid_t curid_,
+                             const std::vector<procid_t>& local_procs,
+                             size_t ring_bytes_) {
+#ifdef __linux__
+  prefix = prefix_;
+  curid = curid_;
+  locals = local_procs;
+  ring_bytes = 4096;
+  while (ring_bytes < ring_bytes_) ring_bytes *= 2;
+  local_rank.assign(nprocs, -1);
+  for (size_t i = 0;i < locals.size(); ++i) local_rank[locals[i]] = (int)i;
+  ASSERT_GE(local_rank[curid], 0);
+  inboxes.resize(locals.size());
+
+  // remove the inbox of a crashed run which had the same name
+  std::string name = inbox_name(curid);
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    logstream(LOG_WARNING) << "Unable to create shared memory " << name << ": "
+                           << strerror(errno) << std::endl;
+    return false;
+  }
+  // reserve the pages now: touching an unbacked page of a full
+  // /dev/shm later raises SIGBUS
+  const size_t bytes = inbox_bytes();
+  int err = ftruncate(fd, bytes) < 0 ? errno : posix_fallocate(fd, 0, bytes);
+  char* base = NULL;
+  if (err == 0) {
+    void* ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) err = errno;
+    else base = (char*)ptr;
+  }
+  ::close(fd);
+  if (base == NULL) {
+    logstream(LOG_WARNING) << "Unable to allocate " << bytes
+                           << " bytes of shared memory " << name << ": "
+                           << strerror(err) << std::endl;
+    shm_unlink(name.c_str());
+    return false;
+  }
+  unlinked = false;
+  inbox& box = inboxes[local_rank[curid]];
+  box.base = base;
+  box.bytes = bytes;
+  inbox_header* hdr = header(box);
+  hdr->nrings = locals.size();
+  hdr->ring_bytes = ring_bytes;
+  hdr->nattached = 1;
+  __atomic_store_n(&hdr->magic, SHM_INBOX_MAGIC, __ATOMIC_RELEASE);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool dc_shm_channels::attach(procid_t target) {
+  if (target >= local_rank.size() || local_rank[target] < 0) return false;
+  inbox& box = inboxes[local_rank[target]];
+  if (box.base != NULL) return true;
+  if (!attached(curid)) return false;
+  std::string name = inbox_name(target);
+  int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) return false;
+  const size_t bytes = inbox_bytes();
+  struct stat st;
+  void* ptr = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size == bytes) {
+    ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+  if (ptr == MAP_FAILED) return false;
+  box.base = (char*)ptr;
+  box.bytes = bytes;
+  inbox_header* hdr = header(box);
+  if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != SHM_INBOX_MAGIC ||
+      hdr->nrings != locals.size() || hdr->ring_bytes != ring_bytes) {
+    munmap(box.base, box.bytes);
+    box.base = NULL;
+    return false;
+  }
+  __atomic_add_fetch(&hdr->nattached, 1, __ATOMIC_SEQ_CST);
+  return true;
+}
+
+size_t dc_shm_channels::write(procid_t target, const struct iovec* iov,
+                              size_t iovcnt) {
+  const inbox& box = inboxes[local_rank[target]];
+  const size_t rank = local_rank[curid];
+  ring_header* r = ring(box, rank);
+  char* data = ring_data(box, rank);
+  const uint64_t head = r->head;
+  const uint64_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+  size_t room = ring_bytes - (size_t)(head - tail);
+  size_t written = 0;
+  for (size_t i = 0;i < iovcnt && room > 0; ++i) {
+    const char* src = (const char*)iov[i].iov_base;
+    size_t len = std::min(iov[i].iov_len, room);
+    size_t pos = (head + written) & (ring_bytes - 1);
+    size_t first = std::min(len, ring_bytes - pos);
+    memcpy(data + pos, src, first);
+    memcpy(data, src + first, len - first);
+    written += len;
+    room -= len;
+  }
+  if (written > 0) {
+    __atomic_store_n(&r->head, head + written, __ATOMIC_RELEASE);
+    ring_doorbell(box, false);
+  }
+  return written;
+}
+
+bool dc_shm_channels::writable(procid_t target) const {
+  const inbox& box = inboxes[local_rank[target]];
+  ring_header* r = ring(box, local_rank[curid]);
+  return __atomic_load_n(&r->head, __ATOMIC_RELAXED) -
+      __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) < ring_bytes;
+}
+
+void dc_shm_channels::set_writer_waiting(procid_t target) {
+  const inbox& box = inboxes[local_rank[target]];
+  ring_header* r = ring(box, local_rank[curid]);
+  __atomic_store_n(&r->writer_waiting, 1, __ATOMIC_SEQ_CST);
+}
+
+size_t dc_shm_channels::read(procid_t source, char* buf, size_t len) {
+  const inbox& box = inboxes[local_rank[curid]];
+  const size_t rank = local_rank[source];
+  ring_header* r = ring(box, rank);
+  const char* data = ring_data(box, rank);
+  const uint64_t tail = r->tail;
+  const uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+  len = std::min(len, (size_t)(head - tail));
+  if (len == 0) return 0;
+  size_t pos = tail & (ring_bytes - 1);
+  size_t first = std::min(len, ring_bytes - pos);
+  memcpy(buf, data + pos, first);
+  memcpy(buf + first, data, len - first);
+  __atomic_store_n(&r->tail, tail + len, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&r->writer_waiting, __ATOMIC_SEQ_CST)) {
+    __atomic_store_n(&r->writer_waiting, 0, __ATOMIC_SEQ_CST);
+    if (attached(source)) ring_doorbell(inboxes[rank], false);
+  }
+  return len;
+}
+
+bool dc_shm_channels::readable(procid_t source) const {
+  const inbox& box = inboxes[local_rank[curid]];
+  ring_header* r = ring(box, local_rank[source]);
+  return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) !=
+      __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+}
+
+void dc_shm_channels::ring_doorbell(const inbox& box, bool always) {
+#ifdef __linux__
+  inbox_header* hdr = header(box);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (always || __atomic_load_n(&hdr->sleeping, __ATOMIC_SEQ_CST)) {
+    __atomic_add_fetch(&hdr->doorbell, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&hdr->doorbell);
+  }
+#endif
+}
+
+uint32_t dc_shm_channels::prepare_sleep() {
+  inbox_header* hdr = header(inboxes[local_rank[curid]]);
+  // every process mapped the inbox: it is no longer needed in /dev/shm
+  if (!unlinked &&
+      __atomic_load_n(&hdr->nattached, __ATOMIC_ACQUIRE) == locals.size()) {
+    unlink_inbox();
+  }
+  uint32_t doorbell = __atomic_load_n(&hdr->doorbell, __ATOMIC_ACQUIRE);
+  __atomic_store_n(&hdr->sleeping, 1, __ATOMIC_SEQ_CST);
+  return doorbell;
+}
+
+void dc_shm_channels::sleep(uint32_t doorbell, size_t timeout_us) {
+  inbox_header* hdr = header(inboxes[local_rank[curid]]);
+#ifdef __linux__
+  futex_wait(&hdr->doorbell, doorbell, timeout_us);
+#endif
+  __atomic_store_n(&hdr->sleeping, 0, __ATOMIC_SEQ_CST);
+}
+
+void dc_shm_channels::cancel_sleep() {
+  inbox_header* hdr = header(inboxes[local_rank[curid]]);
+  __atomic_store_n(&hdr->sleeping, 0, __ATOMIC_SEQ_CST);
+}
+
+void dc_shm_channels::wake() {
+  if (attached(curid)) ring_doorbell(inboxes[local_rank[curid]], true);
+}
+
+void dc_shm_channels::unlink_inbox() {
+  if (!unlinked) {
+    shm_unlink(inbox_name(curid).c_str());
+    unlinked = true;
+  }
+}
+
+void dc_shm_channels::close() {
+  unlink_inbox();
+  for (size_t i = 0;i < inboxes.size(); ++i) {
+    if (inboxes[i].base != NULL) {
+      munmap(inboxes[i].base, inboxes[i].bytes);
+      inboxes[i].base = NULL;
+    }
+  }
+}
+
+} // namespace dc_impl
+} // namespace graphlab
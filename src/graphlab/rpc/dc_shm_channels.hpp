@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef DC_SHM_CHANNELS_HPP
+#define DC_SHM_CHANNELS_HPP
+
+#include <sys/uio.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <graphlab/rpc/dc_types.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+/**
+ \ingroup rpc
+ \internal
+ Shared memory channels between the processes of a job which run on the
+ same host.
+
+ Every process creates an inbox in /dev/shm holding one single producer,
+ single consumer byte ring for each process of its host, itself
+ included. A process sends to a local peer by copying into its own ring
+ in the inbox of the peer, and receives by draining the rings of its
+ own inbox. The byte streams are the same as over a socket.
+
+ Each inbox has a doorbell: a reader about to sleep announces it and
+ waits on the doorbell with a futex, and the writers ring it after
+ writing. A writer which finds its ring full flags it, and the reader
+ rings the inbox of the writer once it made room.
+
+ Only available on Linux. create() fails elsewhere and the caller falls
+ back to TCP.
+*/
+class dc_shm_channels {
+ public:
+  dc_shm_channels();
+
+  ~dc_shm_channels() {
+    close();
+  }
+
+  /**
+   * Creates the inbox of this process, named prefix followed by curid,
+   * with a ring of ring_bytes (rounded up to a power of 2) for each of
+   * local_procs. local_procs are the processes of this host, curid
+   * included, in the same order on all of them. Returns false if the
+   * inbox could not be created.
+   */
+  bool create(const std::string& prefix, procid_t nprocs, procid_t curid,
+              const std::vector<procid_t>& local_procs, size_t ring_bytes);
+
+  /**
+   * Maps the inbox of the local process target. Returns false if it
+   * does not exist or does not match this inbox.
+   */
+  bool attach(procid_t target);
+
+  /// Whether data for target is sent through its inbox
+  bool attached(procid_t target) const {
+    return target < local_rank.size() && local_rank[target] >= 0 &&
+        inboxes[local_rank[target]].base != NULL;
+  }
+
+  /// The processes of this host, this one included
+  const std::vector<procid_t>& local_procs() const {
+    return locals;
+  }
+
+  /**
+   * Copies as much of iov as fits into the ring to target and wakes
+   * target if it sleeps. Returns the number of bytes written.
+   */
+  size_t write(procid_t target, const struct iovec* iov, size_t iovcnt);
+
+  /// Whether the ring to target has room
+  bool writable(procid_t target) const;
+
+  /**
+   * Flags the ring to target as full, so that target rings the inbox of
+   * this process once it made room. Check writable() again afterwards.
+   */
+  void set_writer_waiting(procid_t target);
+
+  /**
+   * Reads up to len bytes of the ring from source into buf. Returns the
+   * number of bytes read.
+   */
+  size_t read(procid_t source, char* buf, size_t len);
+
+  /// Whether the ring from source has data
+  bool readable(procid_t source) const;
+
+  /**
+   * Announces that the reader is about to sleep and returns the doorbell
+   * to pass to sleep(). The caller must then check for work again and
+   * call either sleep() or cancel_sleep().
+   */
+  uint32_t prepare_sleep();
+
+  /// Sleeps until the doorbell rings or for timeout_us microseconds
+  void sleep(uint32_t doorbell, size_t timeout_us);
+
+  /// Withdraws the announcement of prepare_sleep()
+  void cancel_sleep();
+
+  /// Wakes the reader of this process whether it announced it sleeps or not
+  void wake();
+
+  /// Unmaps all inboxes and removes the inbox of this process
+  void close();
+
+ private:
+  struct inbox_header;
+  struct ring_header;
+
+  struct inbox {
+    char* base;
+    size_t bytes;
+    inbox() : base(NULL), bytes(0) { }
+  };
+
+  std::string prefix;
+  procid_t curid;
+  size_t ring_bytes;     // a power of 2
+  std::vector<procid_t> locals;
+  std::vector<int> local_rank; // by procid, -1 if not local
+  std::vector<inbox> inboxes;  // by local rank
+  bool unlinked;
+
+  size_t inbox_bytes() const;
+  inbox_header* header(const inbox& box) const;
+  ring_header* ring(const inbox& box, size_t writer_rank) const;
+  char* ring_data(const inbox& box, size_t writer_rank) const;
+  std::string inbox_name(procid_t proc) const;
+  void ring_doorbell(const inbox& box, bool always);
+  void unlink_inbox();
+};
+
+} // namespace dc_impl
+} // namespace graphlab
+#endif
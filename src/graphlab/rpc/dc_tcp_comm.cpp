@@ -31,7 +31,9 @@
 #include <netinet/tcp.h>
 #include <ifaddrs.h>
 #include <poll.h>
+#include <sched.h>
 
+#include <cstdlib>
 #include <limits>
 #include <vector>
 #include <string>
@@ -40,8 +42,10 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/bind.hpp>
 #include <graphlab/logger/logger.hpp>
+#include <graphlab/util/stl_util.hpp>
 #include <graphlab/rpc/dc_tcp_comm.hpp>
 #include <graphlab/rpc/dc_internal_types.hpp>
+#include <graphlab/rpc/dc_compile_parameters.hpp>
 #include <graphlab/rpc/get_current_process_hash.cpp>
 #define compile_barrier() asm volatile("": : :"memory")
 
@@ -74,7 +78,7 @@ namespace graphlab {
       // insert machines into the address map
       all_addrs.resize(nprocs);
       portnums.resize(nprocs);
-      assert(triggered_timeouts.size() >= nprocs);
+      triggered_timeouts.resize(nprocs);
       triggered_timeouts.clear();
       // fill all the socks
       sock.resize(nprocs);
@@ -86,6 +90,7 @@ namespace graphlab {
         sock[i].inevent = NULL;
         sock[i].outevent = NULL;
         sock[i].wouldblock = false;
+        sock[i].use_shm = false;
         sock[i].data.msg_name = NULL;
         sock[i].data.msg_namelen = 0;
         sock[i].data.msg_control = NULL;
@@ -123,6 +128,8 @@ namespace graphlab {
       } else {
         open_listening();
       }
+      // the inbox must exist before this machine connects to the others
+      create_shm_inbox(initopts);
       // to improve the "synchronous" nature of the connection setup,
       // the last machine will do this in reverse order.
       // To wait for all machines to connect to it, before it
@@ -170,15 +177,59 @@ namespace graphlab {
         // barrier release message
         for(size_t i = 0;i < nprocs; ++i) connect(i);
       }
-      // everyone is connected.
+      // everyone is connected, and has created its inbox.
+      attach_shm_inboxes();
       // Construct the eventbase
       construct_events();
       // we reserve the last 2 cores for communication
       inthreads.launch(boost::bind(&dc_tcp_comm::receive_loop, this, inevbase), thread::cpu_count() - 2);
       outthreads.launch(boost::bind(&dc_tcp_comm::send_loop, this, outevbase), thread::cpu_count() - 1);
+      if (use_shm) {
+        shm_done = false;
+        shmthreads.launch(boost::bind(&dc_tcp_comm::shm_loop, this), thread::cpu_count() - 2);
+      }
       is_closed = false;
     }
 
+    void dc_tcp_comm::create_shm_inbox(const std::map<std::string,std::string> &initopts) {
+      use_shm = true;
+      char* envshm = getenv("GRAPHLAB_SHM_COMM");
+      if (envshm != NULL) use_shm = (atoi(envshm) != 0);
+      std::map<std::string, std::string>::const_iterator iter =
+        initopts.find("shm");
+      if (iter != initopts.end()) use_shm = (atoi(iter->second.c_str()) != 0);
+      size_t ring_bytes = RPC_SHM_RING_BYTES;
+      iter = initopts.find("shm_ring_size");
+      if (iter != initopts.end()) ring_bytes = atol(iter->second.c_str());
+      if (!use_shm) return;
+
+      std::vector<procid_t> local_procs;
+      for (procid_t i = 0;i < nprocs; ++i) {
+        if (all_addrs[i] == all_addrs[curid]) local_procs.push_back(i);
+      }
+      // the address and port of the first machine make the names unique
+      // to this job
+      std::string prefix = std::string("/graphlab_") + tostr(all_addrs[0]) +
+                           "_" + tostr(portnums[0]) + "_";
+      use_shm = shm.create(prefix, nprocs, curid, local_procs, ring_bytes);
+    }
+
+    void dc_tcp_comm::attach_shm_inboxes() {
+      if (!use_shm) return;
+      const std::vector<procid_t>& local_procs = shm.local_procs();
+      for (size_t i = 0;i < local_procs.size(); ++i) {
+        if (shm.attach(local_procs[i])) {
+          sock[local_procs[i]].use_shm = true;
+          shm_targets.push_back(local_procs[i]);
+        }
+      }
+      logstream(LOG_INFO) << "Proc " << procid() << " sends to "
+                          << shm_targets.size() << " of "
+                          << local_procs.size()
+                          << " local processes through shared memory"
+                          << std::endl;
+    }
+
     void dc_tcp_comm::construct_events() {
       int ret = evthread_use_pthreads();
       if (ret < 0) logstream(LOG_FATAL) << "Unable to initialize libevent with pthread support!" << std::endl;
@@ -253,6 +304,13 @@ namespace graphlab {
       // shutdown the listening thread
       listenthread.join();
 
+      // stop receiving from the shared memory
+      if (!shm_done) {
+        shm_done = true;
+        shm.wake();
+        shmthreads.join();
+      }
+
       // clear the outevent loop
       event_base_loopbreak(outevbase);
       outthreads.join();
@@ -290,11 +348,13 @@ namespace graphlab {
           sock[i].insock = -1;
         }
       }
+      shm.close();
       is_closed = true;
     }
 
 
     bool dc_tcp_comm::send_till_block(socket_info& sockinfo) {
+      if (sockinfo.use_shm) return send_till_block_shm(sockinfo);
       sockinfo.wouldblock = false;
       // while there is still data to be sent
       BEGIN_TRACEPOINT(tcp_send_call);
@@ -323,6 +383,28 @@ namespace graphlab {
       return true;
     }
 
+    bool dc_tcp_comm::send_till_block_shm(socket_info& sockinfo) {
+      sockinfo.wouldblock = false;
+      BEGIN_TRACEPOINT(tcp_send_call);
+      while(!sockinfo.outvec.empty()) {
+        sockinfo.outvec.fill_msghdr(sockinfo.data);
+        size_t ret = shm.write(sockinfo.id, sockinfo.data.msg_iov,
+                               sockinfo.data.msg_iovlen);
+        if (ret == 0) {
+          // the ring is full. The receiver wakes shm_loop once it made room
+          shm.set_writer_waiting(sockinfo.id);
+          if (shm.writable(sockinfo.id)) continue;
+          sockinfo.wouldblock = true;
+          END_TRACEPOINT(tcp_send_call);
+          return false;
+        }
+        network_bytessent.inc(ret);
+        sockinfo.outvec.sent(ret);
+      }
+      END_TRACEPOINT(tcp_send_call);
+      return true;
+    }
+
     int dc_tcp_comm::sendtosock(int sockfd, const char* buf, size_t len) {
       size_t numsent = 0;
       BEGIN_TRACEPOINT(tcp_send_call);
@@ -643,6 +725,62 @@ namespace graphlab {
     }
 
 
+    // the rounds without progress shm_loop polls before it sleeps
+    static const size_t SHM_SPIN_ROUNDS = 256;
+
+    bool dc_tcp_comm::shm_has_work() {
+      const std::vector<procid_t>& local_procs = shm.local_procs();
+      for (size_t i = 0;i < local_procs.size(); ++i) {
+        if (shm.readable(local_procs[i])) return true;
+      }
+      for (size_t i = 0;i < shm_targets.size(); ++i) {
+        if (sock[shm_targets[i]].wouldblock && shm.writable(shm_targets[i])) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void dc_tcp_comm::shm_loop() {
+      logstream(LOG_INFO) << "Shared memory loop Started" << std::endl;
+      const std::vector<procid_t>& local_procs = shm.local_procs();
+      size_t idle = 0;
+      while(!shm_done) {
+        bool progress = false;
+        // one read per source and round, so that no source starves the others
+        for (size_t i = 0;i < local_procs.size(); ++i) {
+          dc_receive* receiver = this->receiver[local_procs[i]];
+          size_t buflength;
+          char* c = receiver->get_buffer(buflength);
+          size_t msglen = shm.read(local_procs[i], c, buflength);
+          if (msglen > 0) {
+            network_bytesreceived.inc(msglen);
+            receiver->advance_buffer(c, msglen, buflength);
+            progress = true;
+          }
+        }
+        // resume the sends which filled their ring
+        for (size_t i = 0;i < shm_targets.size(); ++i) {
+          socket_info* sockinfo = &(sock[shm_targets[i]]);
+          if (sockinfo->wouldblock && shm.writable(shm_targets[i])) {
+            sockinfo->wouldblock = false;
+            process_sock(sockinfo);
+            progress = true;
+          }
+        }
+        if (progress) {
+          idle = 0;
+        } else if (++idle < SHM_SPIN_ROUNDS) {
+          sched_yield();
+        } else {
+          uint32_t doorbell = shm.prepare_sleep();
+          if (shm_done || shm_has_work()) shm.cancel_sleep();
+          else shm.sleep(doorbell, SEND_POLL_TIMEOUT);
+        }
+      }
+      logstream(LOG_INFO) << "Shared memory loop Stopped" << std::endl;
+    }
+
     void dc_tcp_comm::send_loop(struct event_base* ev) {
       logstream(LOG_INFO) << "Send loop Started" << std::endl;
       int ret = event_base_dispatch(ev);
@@ -36,6 +36,7 @@
 #include <graphlab/rpc/dc_internal_types.hpp>
 #include <graphlab/rpc/dc_comm_base.hpp>
 #include <graphlab/rpc/circular_iovec_buffer.hpp>
+#include <graphlab/rpc/dc_shm_channels.hpp>
 #include <graphlab/util/tracepoint.hpp>
 #include <graphlab/util/dense_bitset.hpp>
 
@@ -57,6 +58,11 @@ void on_send_event(int fd, short ev, void* arg);
 TCP implementation of the communications subsystem.
 Provides a single object interface to sending/receiving data streams to
 a collection of machines.
+
+The streams between processes on the same host go through shared
+memory rings (see dc_shm_channels) instead of the loopback. The sockets
+are still connected to every process, and carry the streams for which
+the shared memory could not be set up.
 */
 class dc_tcp_comm:public dc_comm_base {
  public:
@@ -65,6 +71,8 @@ class dc_tcp_comm:public dc_comm_base {
 
   inline dc_tcp_comm() {
     is_closed = true;
+    use_shm = false;
+    shm_done = true;
     INITIALIZE_TRACER(tcp_send_call, "dc_tcp_comm: send syscall");
   }
 
@@ -80,7 +88,10 @@ class dc_tcp_comm:public dc_comm_base {
    attached receiver
 
    machines: a vector of strings where each string is of the form [IP]:[portnumber]
-   initopts: unused
+   initopts: "shm=0" sends everything through the sockets. The environment
+             variable GRAPHLAB_SHM_COMM=0 does the same.
+             "shm_ring_size=N" sets the bytes of each shared memory ring,
+             RPC_SHM_RING_BYTES by default.
    curmachineid: The ID of the current machine. machines[curmachineid] will be
                  the listening address of this machine
 
@@ -171,6 +182,15 @@ class dc_tcp_comm:public dc_comm_base {
   /// constructs a connection to the target machine
   void connect(size_t target);
 
+  /**
+   * Sets up the shared memory channels to the processes on this host.
+   * Must be called before the other processes finish their init().
+   */
+  void create_shm_inbox(const std::map<std::string,std::string> &initopts);
+
+  /// Maps the inboxes of the other processes on this host
+  void attach_shm_inboxes();
+
   /// wrapper around the standard send. but loops till the buffer is all sent
   int sendtosock(int sockfd, const char* buf, size_t len);
 
@@ -208,6 +228,7 @@ class dc_tcp_comm:public dc_comm_base {
     struct event* inevent;  /// event object for incoming information
     struct event* outevent;  /// event object for outgoing information
     bool wouldblock;
+    bool use_shm; /// sent through the shared memory ring instead of outsock
     mutex m;
 
     circular_iovec_buffer outvec;  /// outgoing data
@@ -232,6 +253,7 @@ class dc_tcp_comm:public dc_comm_base {
    */
   void send_all(socket_info& sockinfo);
   bool send_till_block(socket_info& sockinfo);
+  bool send_till_block_shm(socket_info& sockinfo);
   void check_for_new_data(socket_info& sockinfo);
   void construct_events();
 
@@ -260,7 +282,17 @@ class dc_tcp_comm:public dc_comm_base {
   timeout_event send_triggered_timeout;
   timeout_event send_all_timeout;
 
-  fixed_dense_bitset<256> triggered_timeouts;
+  dense_bitset triggered_timeouts;
+  ////////////       Shared Memory Channels     //////////////////
+  dc_shm_channels shm;
+  bool use_shm;
+  std::vector<procid_t> shm_targets; /// the processes sent to through shm
+  volatile bool shm_done;
+  thread_group shmthreads;
+  /// receives from shm and resumes the sends to full rings
+  void shm_loop();
+  bool shm_has_work();
+
   ////////////       Listening Sockets     //////////////////////
   int listensock;
   thread listenthread;
@@ -47,10 +47,11 @@ inline void release_thread_local_buffer(procid_t target,
 inline void write_thread_local_buffer(procid_t target, 
                                       char* c,
                                       size_t len,
+                                      size_t capacity,
                                       bool do_not_count_bytes_sent) {
   void* ptr = pthread_getspecific(thrlocal_send_buffer_key);
   thread_local_buffer* p = (thread_local_buffer*)(ptr);
-  p->write(target, c, len, do_not_count_bytes_sent);
+  p->write(target, c, len, capacity, do_not_count_bytes_sent);
 }
 
 
@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_EXCHANGE_COMPRESSION_HPP
+#define GRAPHLAB_EXCHANGE_COMPRESSION_HPP
+
+#include <cstdlib>
+#include <string>
+#include <graphlab/serialization/oarchive.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/util/lz_compress.hpp>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/logger/logger.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+/**
+ * \ingroup rpc
+ * \internal
+ *
+ * The optional compression of the full send buffers of
+ * buffered_exchange and fiber_buffered_exchange, with its statistics.
+ *
+ * compress() turns the arguments of a split call into the arguments of
+ * another split call: the uncompressed length followed by the
+ * lz_compress() output. Buffers which do not shrink by at least 1/16
+ * are sent uncompressed.
+ */
+class exchange_compression {
+ public:
+  /// Buffers smaller than this are not worth compressing
+  static const size_t MIN_COMPRESS_BYTES = 512;
+
+  exchange_compression() : enabled(false) { }
+
+  void set_enabled(bool enable) { enabled = enable; }
+
+  bool is_enabled() const { return enabled; }
+
+  /**
+   * Compresses the arguments written to the split call call into the
+   * split call compressed. Returns false, leaving compressed to be
+   * cancelled, if the buffer is to be sent uncompressed.
+   */
+  bool compress(const oarchive& call, oarchive& compressed) {
+    // the arguments follow the blob size, which the header points to
+    const size_t begin = *reinterpret_cast<const size_t*>(call.buf) +
+                         sizeof(size_t);
+    const size_t len = call.off - begin;
+    raw_bytes.inc(len);
+    if (len < MIN_COMPRESS_BYTES) {
+      sent_bytes.inc(len);
+      return false;
+    }
+    timer ti;
+    ti.start();
+    // the raw length is read back with memcpy, not deserialized
+    compressed.write(reinterpret_cast<const char*>(&len), sizeof(size_t));
+    compressed.expand_buf(lz_compress_bound(len));
+    size_t clen = lz_compress(call.buf + begin, len,
+                              compressed.buf + compressed.off);
+    compress_seconds.inc(ti.current_time());
+    if (clen + sizeof(size_t) > len - len / 16) {
+      sent_bytes.inc(len);
+      return false;
+    }
+    compressed.off += clen;
+    sent_bytes.inc(clen + sizeof(size_t));
+    compressed_buffers.inc();
+    return true;
+  }
+
+  /**
+   * Decompresses the len bytes of arguments of a compressed split call.
+   * Returns a buffer to free() and sets rawlen to its length.
+   */
+  char* decompress(const char* ptr, size_t len, size_t& rawlen) {
+    timer ti;
+    ti.start();
+    ASSERT_GE(len, sizeof(size_t));
+    memcpy(&rawlen, ptr, sizeof(size_t));
+    char* raw = (char*)malloc(rawlen);
+    bool ok = lz_decompress(ptr + sizeof(size_t), len - sizeof(size_t),
+                            raw, rawlen);
+    ASSERT_MSG(ok, "Corrupted compressed exchange buffer");
+    decompress_seconds.inc(ti.current_time());
+    return raw;
+  }
+
+  /// The bytes of the buffers sent, before compression
+  size_t bytes_before_compression() const { return raw_bytes.value; }
+
+  /// The bytes of the buffers sent, after compression
+  size_t bytes_after_compression() const { return sent_bytes.value; }
+
+  /// The number of buffers sent compressed
+  size_t num_compressed_buffers() const { return compressed_buffers.value; }
+
+  /// The seconds spent compressing, summed over the threads
+  double compression_seconds() const { return compress_seconds.value; }
+
+  /// The seconds spent decompressing, summed over the threads
+  double decompression_seconds() const { return decompress_seconds.value; }
+
+  /// Logs the compression ratio and time, if compression is enabled
+  void report(const std::string& name) const {
+    if (!enabled) return;
+    const size_t after = bytes_after_compression();
+    logstream(LOG_INFO) << name << " compression: "
+                        << bytes_before_compression() << " -> " << after
+                        << " bytes (ratio "
+                        << (after > 0 ? double(bytes_before_compression()) / after : 1.0)
+                        << "), " << num_compressed_buffers()
+                        << " buffers compressed in " << compression_seconds()
+                        << "s, decompressed in " << decompression_seconds()
+                        << "s" << std::endl;
+  }
+
+ private:
+  bool enabled;
+  atomic<size_t> raw_bytes;
+  atomic<size_t> sent_bytes;
+  atomic<size_t> compressed_buffers;
+  atomic<double> compress_seconds;
+  atomic<double> decompress_seconds;
+};
+
+} // namespace dc_impl
+} // namespace graphlab
+#endif
@@ -28,6 +28,7 @@
 #include <graphlab/parallel/fiber_control.hpp>
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/rpc/exchange_compression.hpp>
 #include <graphlab/util/mpi_tools.hpp>
 
 
@@ -81,6 +82,8 @@ namespace graphlab {
    * \note The last single threaded receive is not necessary if worker-affinity
    * is set correctly so that every worker is active in the parallel receiving
    * block.
+   * \note As with \ref graphlab::buffered_exchange, set_compression(true)
+   * compresses the send buffers.
    *
    * \see graphlab::buffered_exchange
    */
@@ -112,6 +115,7 @@ namespace graphlab {
 
     std::vector<std::vector<send_record> > send_buffers;
     const size_t max_buffer_size;
+    dc_impl::exchange_compression compression;
 
 
     /**
@@ -121,7 +125,14 @@ namespace graphlab {
       if(send_buffers[wid][proc].oarc) {
         // write the length at the end of the buffere are returning
         send_buffers[wid][proc].oarc->write(reinterpret_cast<char*>(&send_buffers[wid][proc].numinserts), sizeof(size_t));
-        rpc.split_call_end(proc, send_buffers[wid][proc].oarc);
+        oarchive* arc = send_buffers[wid][proc].oarc;
+        if (compression.is_enabled()) {
+          oarchive* carc =
+              rpc.split_call_begin(&fiber_buffered_exchange::rpc_recv_compressed);
+          if (compression.compress(*arc, *carc)) std::swap(arc, carc);
+          rpc.split_call_cancel(carc);
+        }
+        rpc.split_call_end(proc, arc);
 //         logstream(LOG_DEBUG) << rpc.procid() << ": Sending exchange of length " 
 //                              << send_buffers[wid][proc].oarc->off << " to " 
 //                              << proc << std::endl;
@@ -269,10 +280,35 @@ namespace graphlab {
       return true;
     }
 
+    /**
+     * Compresses the send buffers of this machine with lz_compress() if
+     * enable is set. Buffers which do not compress well are still sent
+     * as they are. The receivers need not enable compression.
+     */
+    void set_compression(bool enable) { compression.set_enabled(enable); }
+
+    /**
+     * Returns the compression ratio and time of the buffers sent and
+     * received by this machine.
+     */
+    const dc_impl::exchange_compression& get_compression() const {
+      return compression;
+    }
+
     void clear() { }
 
     void barrier() { rpc.barrier(); }
   private:
+    void rpc_recv_compressed(size_t len, wild_pointer w) {
+      size_t rawlen = 0;
+      char* raw = compression.decompress(reinterpret_cast<const char*>(w.ptr),
+                                         len, rawlen);
+      wild_pointer rawptr;
+      rawptr.ptr = raw;
+      rpc_recv(rawlen, rawptr);
+      free(raw);
+    }
+
     void rpc_recv(size_t len, wild_pointer w) {
       buffer_type tmp;
       iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
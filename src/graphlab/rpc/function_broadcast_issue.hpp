@@ -102,7 +102,7 @@ class  BOOST_PP_CAT(FNAME_AND_CALL, N) { \
   public: \
   static void exec(std::vector<dc_send*>& sender, unsigned char flags, Iterator target_begin, Iterator target_end, F remote_function BOOST_PP_COMMA_IF(N) BOOST_PP_ENUM(N,GENARGS ,_) ) {  \
     oarchive arc;       \
-    arc.buf = (char*)malloc(INITIAL_BUFFER_SIZE); \
+    arc.buf = acquire_send_buffer(); \
     arc.len = INITIAL_BUFFER_SIZE; \
     size_t len = dc_send::write_packet_header(arc, _get_procid(), flags, _get_sequentialization_key()); \
     uint32_t beginoff = arc.off; \
@@ -118,7 +118,7 @@ class  BOOST_PP_CAT(FNAME_AND_CALL, N) { \
       release_thread_local_buffer(*iter, flags & CONTROL_PACKET); \
       ++iter;    \
     } \
-    free(arc.buf); \
+    release_send_buffer(arc.buf, arc.len); \
     if (flags & FLUSH_PACKET) pull_flush_soon_thread_local_buffer(); \
   }\
 };
@@ -105,7 +105,7 @@ class  BOOST_PP_CAT(BOOST_PP_TUPLE_ELEM(2,0,FNAME_AND_CALL), N) { \
   static void exec(dc_dist_object_base* rmi, std::vector<dc_send*> sender, unsigned char flags, \
                     Iterator target_begin, Iterator target_end, size_t objid, F remote_function BOOST_PP_COMMA_IF(N) BOOST_PP_ENUM(N,GENARGS ,_) ) {  \
     oarchive arc;       \
-    arc.buf = (char*)malloc(INITIAL_BUFFER_SIZE); \
+    arc.buf = acquire_send_buffer(); \
     arc.len = INITIAL_BUFFER_SIZE; \
     size_t len = dc_send::write_packet_header(arc, _get_procid(), flags, _get_sequentialization_key()); \
     uint32_t beginoff = arc.off; \
@@ -126,7 +126,7 @@ class  BOOST_PP_CAT(BOOST_PP_TUPLE_ELEM(2,0,FNAME_AND_CALL), N) { \
       } \
       ++iter; \
     } \
-    free(arc.buf); \
+    release_send_buffer(arc.buf, arc.len); \
     if (flags & FLUSH_PACKET) pull_flush_soon_thread_local_buffer(); \
   }  \
 };
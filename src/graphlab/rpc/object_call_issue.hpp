@@ -134,7 +134,7 @@ class object_split_call {
   static oarchive* split_call_begin(dc_dist_object_base* rmi, size_t objid, F remote_function) {
     oarchive* ptr = new oarchive;
     oarchive& arc = *ptr;
-    arc.buf = (char*)malloc(INITIAL_BUFFER_SIZE); 
+    arc.buf = acquire_send_buffer(); 
     arc.len = INITIAL_BUFFER_SIZE; 
     arc.advance(sizeof(packet_hdr));
     dispatch_type d = dc_impl::OBJECT_NONINTRUSIVE_DISPATCH2<distributed_control,T,F,size_t, wild_pointer>;
@@ -150,7 +150,7 @@ class object_split_call {
     return ptr;
   }
   static void split_call_cancel(oarchive* oarc) {
-    free(oarc->buf);
+    release_send_buffer(oarc->buf, oarc->len);
     delete oarc;
   }
 
@@ -173,7 +173,8 @@ class object_split_call {
     hdr->packet_type_mask = flags;
     hdr->sequentialization_key = _get_sequentialization_key();
     size_t len = hdr->len;
-    write_thread_local_buffer(target, oarc->buf, oarc->off, flags & CONTROL_PACKET);
+    write_thread_local_buffer(target, oarc->buf, oarc->off, oarc->len,
+                              flags & CONTROL_PACKET);
     if ((flags & CONTROL_PACKET) == 0) {
       rmi->inc_bytes_sent(target, len);
     }
@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <cstdlib>
+#include <vector>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/rpc/dc_compile_parameters.hpp>
+#include <graphlab/rpc/send_buffer_pool.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+/*
+ * The pool is shared by the threads filling the buffers and the threads
+ * sending them. Each is touched once for a whole buffer, so a single
+ * spinlock does not contend.
+ */
+static simple_spinlock pool_lock;
+
+// never destroyed, since buffers may still be released at exit
+static std::vector<char*>& get_pool() {
+  static std::vector<char*>* pool = new std::vector<char*>;
+  return *pool;
+}
+
+char* acquire_send_buffer() {
+  std::vector<char*>& pool = get_pool();
+  pool_lock.lock();
+  if (!pool.empty()) {
+    char* buf = pool.back();
+    pool.pop_back();
+    pool_lock.unlock();
+    return buf;
+  }
+  pool_lock.unlock();
+  return (char*)malloc(INITIAL_BUFFER_SIZE);
+}
+
+void release_send_buffer(char* buf, size_t capacity) {
+  if (buf == NULL) return;
+  if (capacity == INITIAL_BUFFER_SIZE) {
+    std::vector<char*>& pool = get_pool();
+    pool_lock.lock();
+    if (pool.size() < RPC_SEND_BUFFER_POOL_SIZE) {
+      if (pool.capacity() == 0) pool.reserve(RPC_SEND_BUFFER_POOL_SIZE);
+      pool.push_back(buf);
+      pool_lock.unlock();
+      return;
+    }
+    pool_lock.unlock();
+  }
+  free(buf);
+}
+
+} // namespace dc_impl
+} // namespace graphlab
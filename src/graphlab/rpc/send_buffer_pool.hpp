@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_RPC_SEND_BUFFER_POOL_HPP
+#define GRAPHLAB_RPC_SEND_BUFFER_POOL_HPP
+#include <cstddef>
+
+namespace graphlab {
+namespace dc_impl {
+
+/**
+ * \ingroup rpc
+ * \internal
+ * Returns a send buffer of INITIAL_BUFFER_SIZE bytes, reusing one
+ * returned by release_send_buffer() if there is one. The buffer may be
+ * grown with realloc() like any other oarchive buffer.
+ */
+char* acquire_send_buffer();
+
+/**
+ * \ingroup rpc
+ * \internal
+ * Frees a send buffer which holds capacity bytes. Buffers of
+ * INITIAL_BUFFER_SIZE bytes are kept for acquire_send_buffer(), up to
+ * RPC_SEND_BUFFER_POOL_SIZE of them.
+ */
+void release_send_buffer(char* buf, size_t capacity);
+
+} // namespace dc_impl
+} // namespace graphlab
+#endif
@@ -1,4 +1,5 @@
 #include <graphlab/rpc/thread_local_send_buffer.hpp>
+#include <graphlab/rpc/send_buffer_pool.hpp>
 #include <graphlab/rpc/dc.hpp>
 namespace graphlab {
 namespace dc_impl {
@@ -28,7 +29,7 @@ thread_local_buffer::~thread_local_buffer() {
   // deallocate the buffers
   for (size_t i = 0; i < current_archive.size(); ++i) {
     if (current_archive[i].buf) {
-      free(current_archive[i].buf);
+      release_send_buffer(current_archive[i].buf, current_archive[i].len);
       current_archive[i].buf = NULL;
     }
   }
@@ -50,7 +51,8 @@ void thread_local_buffer::push_flush() {
     if (bufs.first != NULL) {
       while(bufs.first != bufs.second) {
         buffer_elem* prev = bufs.first;
-        dc->write_to_buffer(i, bufs.first->buf, bufs.second->len);
+        dc->write_to_buffer(i, bufs.first->buf, bufs.first->len,
+                            bufs.first->capacity);
         buffer_elem** next = &bufs.first->next;
         volatile buffer_elem** n = (volatile buffer_elem**)(next);
         while(__unlikely__((*n) == NULL)) {
@@ -87,7 +89,7 @@ oarchive* thread_local_buffer::acquire(procid_t target) {
   archive_locks[target].lock();
   // need a new archive, or existing one at risk of being resized
   if (current_archive[target].buf == NULL) {
-    current_archive[target].buf = (char*)malloc(INITIAL_BUFFER_SIZE);
+    current_archive[target].buf = acquire_send_buffer();
     current_archive[target].off = 0;
     current_archive[target].len = INITIAL_BUFFER_SIZE;
   }
@@ -96,11 +98,13 @@ oarchive* thread_local_buffer::acquire(procid_t target) {
 }
 
 
-void thread_local_buffer::add_to_queue(procid_t target, char* ptr, size_t len) {
+void thread_local_buffer::add_to_queue(procid_t target, char* ptr, size_t len,
+                                       size_t capacity) {
   buffer_elem* elem = new buffer_elem;
   ASSERT_NE(ptr, NULL);
   elem->buf = ptr;
   elem->len = len;
+  elem->capacity = capacity;
   elem->next = NULL;
   outbuf[target]->enqueue(elem);
   if (outbuf[target]->approx_size() > NUM_FULL_BUFFER_LIMIT) {
@@ -118,11 +122,12 @@ void thread_local_buffer::release(procid_t target, bool do_not_count_bytes_sent)
     // shift the buffer into outbuf
     char* ptr = current_archive[target].buf;
     size_t len = current_archive[target].off;
+    size_t capacity = current_archive[target].len;
     current_archive[target].buf = NULL; 
     current_archive[target].off = 0;
     archive_locks[target].unlock();
 
-    add_to_queue(target, ptr, len);
+    add_to_queue(target, ptr, len, capacity);
 
   } else {
     archive_locks[target].unlock();
@@ -131,6 +136,7 @@ void thread_local_buffer::release(procid_t target, bool do_not_count_bytes_sent)
 
 
 void thread_local_buffer::write(procid_t target, char* c, size_t len, 
+                                size_t capacity,
                                 bool do_not_count_bytes_sent) {
   if (!do_not_count_bytes_sent) {
     bytes_sent[target] += len;
@@ -141,13 +147,14 @@ void thread_local_buffer::write(procid_t target, char* c, size_t len,
     archive_locks[target].lock();
 
     if (current_archive[target].off) {
-      add_to_queue(target, current_archive[target].buf, current_archive[target].off);
+      add_to_queue(target, current_archive[target].buf,
+                   current_archive[target].off, current_archive[target].len);
     }
     current_archive[target].buf = NULL; 
     current_archive[target].off = 0;
     archive_locks[target].unlock();
   }
-  add_to_queue(target, c, len);
+  add_to_queue(target, c, len, capacity);
 }
 
 
@@ -156,6 +163,7 @@ std::pair<buffer_elem*, buffer_elem*> thread_local_buffer::extract(procid_t targ
     if (archive_locks[target].try_lock()) {
       char* ptr = current_archive[target].buf;
       size_t len = current_archive[target].off;
+      size_t capacity = current_archive[target].len;
       if (len > 0) {
         current_archive[target].buf = NULL;
         current_archive[target].off = 0;
@@ -166,6 +174,7 @@ std::pair<buffer_elem*, buffer_elem*> thread_local_buffer::extract(procid_t targ
         ASSERT_NE(ptr, NULL);
         elem->buf = ptr;
         elem->len = len;
+        elem->capacity = capacity;
         elem->next = NULL;
         outbuf[target]->enqueue(elem);
       }
@@ -41,7 +41,12 @@ struct thread_local_buffer {
    */
   void release(procid_t target, bool do_not_count_bytes_sent);
 
-  void write(procid_t target, char* c, size_t len, bool do_not_count_bytes_sent);
+  /**
+   * Queues the len bytes of c, which holds capacity bytes, after the
+   * buffered messages. c is freed with release_send_buffer() once sent.
+   */
+  void write(procid_t target, char* c, size_t len, size_t capacity,
+             bool do_not_count_bytes_sent);
 
   /**
    * Must be called from within the thread owning this buffer.
@@ -91,7 +96,7 @@ struct thread_local_buffer {
 
   void inc_calls_sent(procid_t target);
 
-  void add_to_queue(procid_t target, char* ptr, size_t len);
+  void add_to_queue(procid_t target, char* ptr, size_t len, size_t capacity);
 };
 }
 }
@@ -23,6 +23,7 @@
 
 #ifndef GRAPHLAB_IS_POD_HPP
 #define GRAPHLAB_IS_POD_HPP
+#include <utility>
 #include <boost/type_traits.hpp>
 
 namespace graphlab {
@@ -80,6 +81,30 @@ namespace graphlab {
                              gl_is_pod<T>::value>::value
                           ));
   };
+
+  /**
+   * \internal
+   * gl_is_bulk_serializable<T>::value is true if an array of T can be
+   * serialized with a single copy of its bytes: T is a POD or a scalar,
+   * or T is a std::pair of such types without padding between them.
+   */
+  template <typename T>
+  struct gl_is_bulk_serializable{
+    BOOST_STATIC_CONSTANT(bool, value = gl_is_pod_or_scaler<T>::value);
+  };
+
+  /// \internal
+  template <typename T, typename U>
+  struct gl_is_bulk_serializable<std::pair<T, U> >{
+    BOOST_STATIC_CONSTANT(bool, value =
+                          (
+                           boost::type_traits::ice_and<
+                             gl_is_bulk_serializable<T>::value,
+                             gl_is_bulk_serializable<U>::value,
+                             sizeof(std::pair<T, U>) == sizeof(T) + sizeof(U)
+                             >::value
+                          ));
+  };
 }
 
 #endif
@@ -67,12 +67,17 @@ namespace graphlab {
       }
     };
 
-    /// Fast vector serialization if contained type is a POD
+    /**
+     * Fast vector serialization if contained type is bulk serializable.
+     * The elements are written with a single copy.
+     */
     template <typename OutArcType, typename ValueType>
     struct vector_serialize_impl<OutArcType, ValueType, true > {
       static void exec(OutArcType& oarc, const std::vector<ValueType>& vec) {
         oarc << size_t(vec.size());
-        serialize(oarc, &(vec[0]),sizeof(ValueType)*vec.size());
+        if (!vec.empty()) {
+          serialize(oarc, &(vec[0]),sizeof(ValueType)*vec.size());
+        }
       }
     };
 
@@ -87,14 +92,16 @@ namespace graphlab {
       }
     };
 
-    /// Fast vector deserialization if contained type is a POD
+    /// Fast vector deserialization if contained type is bulk serializable
     template <typename InArcType, typename ValueType>
     struct vector_deserialize_impl<InArcType, ValueType, true > {
       static void exec(InArcType& iarc, std::vector<ValueType>& vec){
         size_t len;
         iarc >> len;
         vec.clear(); vec.resize(len);
-        deserialize(iarc, &(vec[0]), sizeof(ValueType)*vec.size());
+        if (len > 0) {
+          deserialize(iarc, &(vec[0]), sizeof(ValueType)*vec.size());
+        }
       }
     };
 
@@ -106,7 +113,7 @@ namespace graphlab {
     struct serialize_impl<OutArcType, std::vector<ValueType>, false > {
       static void exec(OutArcType& oarc, const std::vector<ValueType>& vec) {
         vector_serialize_impl<OutArcType, ValueType, 
-          gl_is_pod_or_scaler<ValueType>::value >::exec(oarc, vec);
+          gl_is_bulk_serializable<ValueType>::value >::exec(oarc, vec);
       }
     };
     /**
@@ -115,7 +122,7 @@ namespace graphlab {
     struct deserialize_impl<InArcType, std::vector<ValueType>, false > {
       static void exec(InArcType& iarc, std::vector<ValueType>& vec){
         vector_deserialize_impl<InArcType, ValueType, 
-          gl_is_pod_or_scaler<ValueType>::value >::exec(iarc, vec);
+          gl_is_bulk_serializable<ValueType>::value >::exec(iarc, vec);
       }
     };
   } // archive_detail
@@ -27,13 +27,20 @@
 #endif
 
 #include <vector>
-#include <graphlab/parallel/atomic.hpp>
+#include <algorithm>
 
 namespace graphlab {
     /**
      *  Count the value_vec.
      *  Generate permute_index for value_vec in ascending order and 
      *  optionally fill in the prefix array of the counts. 
+     *
+     *  The sort is stable and runs in parallel: value_vec is cut into
+     *  contiguous chunks, each chunk is counted into its own histogram,
+     *  the histograms are turned into scatter offsets by a parallel
+     *  prefix sum over the keys, and each chunk scatters its own
+     *  indices. The number of chunks is limited so that the histograms
+     *  take no more room than permute_index.
      **/
     template <typename valuetype, typename sizetype>
     void counting_sort(const std::vector<valuetype>& value_vec,
@@ -41,37 +48,72 @@ namespace graphlab {
                        std::vector<sizetype>* prefix_array = NULL) {
       if(value_vec.size() == 0) return;
 
-      valuetype maxval = *std::max_element(value_vec.begin(), value_vec.end());
-      std::vector< atomic<size_t> > counter_array(maxval+1);
-      permute_index.resize(value_vec.size(), 0);
-      permute_index.assign(value_vec.size(), 0);
+      const size_t nvalues = value_vec.size();
+      const size_t nkeys =
+          size_t(*std::max_element(value_vec.begin(), value_vec.end())) + 1;
+      size_t nthreads = 1;
+#ifdef _OPENMP
+      nthreads = omp_get_max_threads();
+#endif
+      const size_t nchunks = std::min(nthreads, 1 + nvalues / nkeys);
+      // counts[c * nkeys + k] is the number of values k in chunk c, and
+      // later the next position of a value k of chunk c.
+      std::vector<sizetype> counts(nchunks * nkeys, 0);
+      permute_index.resize(nvalues);
+
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-      for (ssize_t i = 0; i < ssize_t(value_vec.size()); ++i) {
-        size_t val = value_vec[i];
-        counter_array[val].inc();
+      for (ssize_t c = 0; c < ssize_t(nchunks); ++c) {
+        sizetype* chunk_counts = &counts[c * nkeys];
+        const size_t end = (c + 1) * nvalues / nchunks;
+        for (size_t i = c * nvalues / nchunks; i < end; ++i) {
+          ++chunk_counts[value_vec[i]];
+        }
       }
 
-      for (size_t i = 1; i < counter_array.size(); ++i) {
-        counter_array[i] += counter_array[i-1];
+      // exclusive prefix sum in (key, chunk) order over key ranges
+      const size_t nranges = std::min(nthreads, nkeys);
+      std::vector<size_t> range_offset(nranges + 1, 0);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t r = 0; r < ssize_t(nranges); ++r) {
+        size_t total = 0;
+        const size_t end = (r + 1) * nkeys / nranges;
+        for (size_t k = r * nkeys / nranges; k < end; ++k) {
+          for (size_t c = 0; c < nchunks; ++c) total += counts[c * nkeys + k];
+        }
+        range_offset[r + 1] = total;
       }
-
+      for (size_t r = 0; r < nranges; ++r) {
+        range_offset[r + 1] += range_offset[r];
+      }
+      if (prefix_array != NULL) prefix_array->resize(nkeys);
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-      for (ssize_t i = 0; i < ssize_t(value_vec.size()); ++i) {
-        size_t val = value_vec[i];
-        permute_index[counter_array[val].dec()] = i;
+      for (ssize_t r = 0; r < ssize_t(nranges); ++r) {
+        size_t offset = range_offset[r];
+        const size_t end = (r + 1) * nkeys / nranges;
+        for (size_t k = r * nkeys / nranges; k < end; ++k) {
+          if (prefix_array != NULL) (*prefix_array)[k] = offset;
+          for (size_t c = 0; c < nchunks; ++c) {
+            const size_t count = counts[c * nkeys + k];
+            counts[c * nkeys + k] = offset;
+            offset += count;
+          }
+        }
       }
 
-      if (prefix_array != NULL) {
-        prefix_array->resize(counter_array.size());
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-        for (ssize_t i = 0; i < ssize_t(counter_array.size()); ++i) {
-          (*prefix_array)[i] = counter_array[i];
+      for (ssize_t c = 0; c < ssize_t(nchunks); ++c) {
+        sizetype* chunk_offsets = &counts[c * nkeys];
+        const size_t end = (c + 1) * nvalues / nchunks;
+        for (size_t i = c * nvalues / nchunks; i < end; ++i) {
+          permute_index[chunk_offsets[value_vec[i]]++] = i;
         }
       }
     }
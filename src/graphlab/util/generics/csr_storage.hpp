@@ -71,6 +71,9 @@ namespace graphlab {
 
       values.reserve(value_vec.size());
       values.resize(value_vec.size());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
       for (ssize_t i = 0; i < (ssize_t)value_vec.size(); ++i) {
         values[i] = value_vec[permute_index[i]];
       }
@@ -0,0 +1,293 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+#ifndef GRAPHLAB_DELTA_CSR_STORAGE
+#define GRAPHLAB_DELTA_CSR_STORAGE
+
+#include <stdint.h>
+#include <vector>
+#include <iostream>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+
+namespace graphlab {
+
+  /**
+   * A read only compressed version of csr_storage.
+   *
+   * Every entry of a row is a value and an id. The values of a row must
+   * be non decreasing. The ids are either explicit, and then increasing
+   * within a row, or implicit, and then equal to the position of the
+   * entry in the storage. Each number is written as the LEB128 varint of
+   * its difference to the previous number of the row, so the neighbor
+   * list of a vertex with nearby neighbors takes a byte or two per entry.
+   *
+   * The rows can only be read sequentially: the iterator decodes one
+   * entry at a time and moving it backward restarts the row.
+   */
+  template<typename valuetype, typename sizetype>
+  class delta_csr_storage {
+   public:
+     /**
+      * Iterates over the entries of a row. The iterator holds the decoded
+      * current entry, so value() and id() are free. position() is the
+      * index of the entry in the whole storage.
+      */
+     class iterator {
+      public:
+       iterator() : row_data(NULL), cursor(NULL), row_begin(0), row_end(0),
+                    pos(0), explicit_ids(false), cur_value(0), cur_id(0) { }
+
+       iterator(const unsigned char* row_data, sizetype row_begin,
+                sizetype row_end, sizetype pos, bool explicit_ids) :
+         row_data(row_data), cursor(row_data), row_begin(row_begin),
+         row_end(row_end), pos(row_begin), explicit_ids(explicit_ids),
+         cur_value(0), cur_id(0) {
+         if (pos >= row_end) {
+           // the end of a row needs no decoding
+           this->pos = row_end;
+         } else {
+           decode_entry(true);
+           seek(pos);
+         }
+       }
+
+       valuetype value() const { return cur_value; }
+       sizetype id() const { return cur_id; }
+       sizetype position() const { return pos; }
+
+       /// Moves to the entry at position target of the same row
+       void seek(sizetype target) {
+         if (target < pos) {
+           pos = row_begin;
+           cursor = row_data;
+           if (pos < row_end) decode_entry(true);
+         }
+         while (pos < target) {
+           ++pos;
+           if (pos < row_end) decode_entry(false);
+         }
+       }
+
+       void operator++() {
+         ++pos;
+         if (pos < row_end) decode_entry(false);
+       }
+       bool operator==(const iterator& other) const { return pos == other.pos; }
+       bool operator!=(const iterator& other) const { return pos != other.pos; }
+
+      private:
+       const unsigned char* row_data;
+       const unsigned char* cursor;
+       sizetype row_begin, row_end, pos;
+       bool explicit_ids;
+       valuetype cur_value;
+       sizetype cur_id;
+
+       void decode_entry(bool first) {
+         const uint64_t dvalue = read_varint(cursor);
+         cur_value = first ? valuetype(dvalue) : valuetype(cur_value + dvalue);
+         if (explicit_ids) {
+           const uint64_t did = read_varint(cursor);
+           cur_id = first ? sizetype(did) : sizetype(cur_id + did);
+         } else {
+           cur_id = pos;
+         }
+       }
+     }; // end of iterator
+
+   public:
+     delta_csr_storage() : nvalues(0), explicit_ids(false) { }
+
+     /**
+      * Encodes the rows of a csr_storage like layout: row i holds
+      * values[value_ptrs[i]] up to the start of the next row, and rows
+      * past the end of value_ptrs are empty. If ids is NULL the ids are
+      * the positions, otherwise ids must have the size of values.
+      */
+     void build(const std::vector<sizetype>& ptrs,
+                const std::vector<valuetype>& values,
+                const std::vector<sizetype>* ids = NULL) {
+       clear();
+       explicit_ids = (ids != NULL);
+       nvalues = values.size();
+       if (explicit_ids) ASSERT_EQ(ids->size(), values.size());
+       value_ptrs = ptrs;
+       const ssize_t nrows = ptrs.size();
+       byte_ptrs.resize(nrows + 1, 0);
+       // size every row first so the rows can be written in parallel
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+       for (ssize_t i = 0; i < nrows; ++i) {
+         byte_ptrs[i + 1] = encode_row(i, values, ids, NULL);
+       }
+       for (ssize_t i = 0; i < nrows; ++i) byte_ptrs[i + 1] += byte_ptrs[i];
+       bytes.resize(byte_ptrs[nrows]);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+       for (ssize_t i = 0; i < nrows; ++i) {
+         encode_row(i, values, ids, byte_data() + byte_ptrs[i]);
+       }
+     }
+
+     /// Number of keys in the storage.
+     inline size_t num_keys() const { return value_ptrs.size(); }
+
+     /// Number of values in the storage.
+     inline size_t num_values() const { return nvalues; }
+
+     /// Number of values with key == id
+     inline size_t num_values(size_t id) const {
+       return row_end(id) - row_begin(id);
+     }
+
+     /// Return iterator to the begining value with key == id
+     inline iterator begin(size_t id) const {
+       return make_iterator(id, row_begin(id));
+     }
+
+     /// Return iterator to the ending+1 value with key == id
+     inline iterator end(size_t id) const {
+       return make_iterator(id, row_end(id));
+     }
+
+     void clear() {
+       std::vector<sizetype>().swap(value_ptrs);
+       std::vector<size_t>().swap(byte_ptrs);
+       std::vector<unsigned char>().swap(bytes);
+       nvalues = 0;
+       explicit_ids = false;
+     }
+
+     void swap(delta_csr_storage& other) {
+       value_ptrs.swap(other.value_ptrs);
+       byte_ptrs.swap(other.byte_ptrs);
+       bytes.swap(other.bytes);
+       std::swap(nvalues, other.nvalues);
+       std::swap(explicit_ids, other.explicit_ids);
+     }
+
+     void load(iarchive& iarc) {
+       clear();
+       iarc >> value_ptrs >> byte_ptrs >> bytes >> nvalues >> explicit_ids;
+     }
+
+     void save(oarchive& oarc) const {
+       oarc << value_ptrs << byte_ptrs << bytes << nvalues << explicit_ids;
+     }
+
+     size_t estimate_sizeof() const {
+       return sizeof(value_ptrs) + sizeof(byte_ptrs) + sizeof(bytes)
+           + sizeof(sizetype) * value_ptrs.capacity()
+           + sizeof(size_t) * byte_ptrs.capacity() + bytes.capacity();
+     }
+
+     void meminfo(std::ostream& out) const {
+       out << "num values: " << nvalues
+           << "\n bytes: " << bytes.size()
+           << "\n bytes per value: "
+           << (nvalues ? double(bytes.size()) / nvalues : 0.0)
+           << std::endl;
+     }
+
+   private:
+     std::vector<sizetype> value_ptrs;
+     /// byte_ptrs[i] is the offset of row i in bytes, with one extra entry
+     std::vector<size_t> byte_ptrs;
+     std::vector<unsigned char> bytes;
+     size_t nvalues;
+     bool explicit_ids;
+
+     inline sizetype row_begin(size_t id) const {
+       return id < value_ptrs.size() ? value_ptrs[id] : sizetype(nvalues);
+     }
+
+     inline sizetype row_end(size_t id) const {
+       return id + 1 < value_ptrs.size() ? value_ptrs[id + 1]
+                                         : sizetype(nvalues);
+     }
+
+     unsigned char* byte_data() { return bytes.empty() ? NULL : &bytes[0]; }
+     const unsigned char* byte_data() const {
+       return bytes.empty() ? NULL : &bytes[0];
+     }
+
+     iterator make_iterator(size_t id, sizetype pos) const {
+       const unsigned char* row_data = id < value_ptrs.size() ?
+           byte_data() + byte_ptrs[id] : NULL;
+       return iterator(row_data, row_begin(id), row_end(id), pos,
+                       explicit_ids);
+     }
+
+     /** Writes row i to out, or only measures it if out is NULL.
+      *  Returns the number of bytes of the row. */
+     size_t encode_row(size_t i, const std::vector<valuetype>& values,
+                       const std::vector<sizetype>* ids,
+                       unsigned char* out) const {
+       const size_t begin = row_begin(i), end = row_end(i);
+       size_t len = 0;
+       for (size_t j = begin; j < end; ++j) {
+         uint64_t dvalue = values[j];
+         if (j > begin) {
+           ASSERT_LE(values[j - 1], values[j]);
+           dvalue -= values[j - 1];
+         }
+         len += write_varint(dvalue, out ? out + len : NULL);
+         if (ids != NULL) {
+           uint64_t did = (*ids)[j];
+           if (j > begin) {
+             ASSERT_LT((*ids)[j - 1], (*ids)[j]);
+             did -= (*ids)[j - 1];
+           }
+           len += write_varint(did, out ? out + len : NULL);
+         }
+       }
+       return len;
+     }
+
+     static size_t write_varint(uint64_t x, unsigned char* out) {
+       size_t len = 1;
+       while (x >= 0x80) {
+         if (out) *out++ = (unsigned char)(x | 0x80);
+         x >>= 7;
+         ++len;
+       }
+       if (out) *out = (unsigned char)x;
+       return len;
+     }
+
+     static uint64_t read_varint(const unsigned char*& in) {
+       // most deltas of sorted neighbor lists fit in a byte
+       if (!(*in & 0x80)) return *in++;
+       uint64_t x = *in & 0x7f;
+       size_t shift = 7;
+       while (*in++ & 0x80) {
+         x |= uint64_t(*in & 0x7f) << shift;
+         shift += 7;
+       }
+       return x;
+     }
+  }; // end of delta_csr_storage
+} // end of namespace graphlab
+#endif
@@ -94,6 +94,11 @@ namespace graphlab {
       std::streamsize write(const char* strm_ptr, std::streamsize n) {
          return hdfsWrite(filesystem, file, strm_ptr, n);
       }
+      /** Moves the read position to the given byte offset. Must be called
+       * before the first read through a wrapping stream. */
+      bool seek(size_t offset) {
+        return hdfsSeek(filesystem, file, tOffset(offset)) == 0;
+      }
       bool good() const { return file != NULL; }
     }; // end of hdfs device
     
@@ -129,6 +134,15 @@ namespace graphlab {
       return files;
     } // end of list_files
 
+    /** Returns the length in bytes of the file at the given path */
+    inline size_t file_size(const std::string& path) {
+      hdfsFileInfo* info = hdfsGetPathInfo(filesystem, path.c_str());
+      ASSERT_TRUE(info != NULL);
+      const size_t size = info->mSize;
+      hdfsFreeFileInfo(info, 1);
+      return size;
+    } // end of file_size
+
     inline static bool has_hadoop() { return true; }
     
     static hdfs& get_hdfs();
@@ -161,6 +175,11 @@ namespace graphlab {
                              << std::endl;
         return 0;
       }
+      bool seek(size_t offset) {
+        logstream(LOG_FATAL) << "Libhdfs is not installed on this system." 
+                             << std::endl;
+        return false;
+      }
       bool good() const { return false; }
     }; // end of hdfs device
     
@@ -186,6 +205,12 @@ namespace graphlab {
       return std::vector<std::string>();;
     } // end of list_files
 
+    inline size_t file_size(const std::string& path) {
+      logstream(LOG_FATAL) << "Libhdfs is not installed on this system." 
+                           << std::endl;
+      return 0;
+    } // end of file_size
+
     // No hadoop available
     inline static bool has_hadoop() { return false; }
     
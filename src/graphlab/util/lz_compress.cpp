@@ -0,0 +1,192 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+#include <graphlab/util/lz_compress.hpp>
+
+namespace graphlab {
+
+  /*
+   * The output is a sequence of
+   *   token: the literal length in the high 4 bits and the match length
+   *          minus 4 in the low 4 bits, 15 meaning that more length bytes
+   *          follow: each byte is added, until one is not 255
+   *   [more literal length bytes] literals
+   *   match offset: 2 bytes, little endian
+   *   [more match length bytes]
+   * The last sequence has only literals and ends the input.
+   */
+  static const size_t LZ_HASH_BITS = 14;
+  static const size_t LZ_MIN_MATCH = 4;
+  static const size_t LZ_MAX_OFFSET = 65535;
+
+  static inline uint32_t load32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static inline uint64_t load64(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static inline size_t lz_hash(uint32_t seq) {
+    return (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+  }
+
+  static inline char* write_length(char* op, size_t n) {
+    while (n >= 255) {
+      *op++ = (char)255;
+      n -= 255;
+    }
+    *op++ = (char)n;
+    return op;
+  }
+
+  // the length of the common prefix of a and b, b being before end
+  static inline size_t match_length(const char* a, const char* b,
+                                    const char* end) {
+    const char* start = b;
+    while (b + 8 <= end) {
+      uint64_t diff = load64(a) ^ load64(b);
+      if (diff != 0) return b - start + (__builtin_ctzll(diff) >> 3);
+      a += 8;
+      b += 8;
+    }
+    while (b < end && *a == *b) {
+      ++a;
+      ++b;
+    }
+    return b - start;
+  }
+
+  static inline char* write_sequence(char* op, const char* literals,
+                                     size_t nliterals, size_t offset,
+                                     size_t match_len) {
+    char* token = op++;
+    unsigned char t = 0;
+    if (nliterals >= 15) {
+      t = 15 << 4;
+      op = write_length(op, nliterals - 15);
+    } else {
+      t = (unsigned char)(nliterals << 4);
+    }
+    memcpy(op, literals, nliterals);
+    op += nliterals;
+    if (match_len > 0) {
+      *op++ = (char)(offset & 255);
+      *op++ = (char)(offset >> 8);
+      size_t ml = match_len - LZ_MIN_MATCH;
+      if (ml >= 15) {
+        t |= 15;
+        op = write_length(op, ml - 15);
+      } else {
+        t |= (unsigned char)ml;
+      }
+    }
+    *token = (char)t;
+    return op;
+  }
+
+  size_t lz_compress(const char* src, size_t len, char* dst) {
+    std::vector<uint32_t> table(size_t(1) << LZ_HASH_BITS, 0);
+    const char* end = src + len;
+    char* op = dst;
+    size_t anchor = 0;
+    size_t ip = 0;
+    while (len >= LZ_MIN_MATCH && ip <= len - LZ_MIN_MATCH) {
+      uint32_t seq = load32(src + ip);
+      size_t h = lz_hash(seq);
+      size_t candidate = table[h];
+      table[h] = (uint32_t)ip;
+      if (candidate < ip && ip - candidate <= LZ_MAX_OFFSET &&
+          load32(src + candidate) == seq) {
+        size_t mlen = LZ_MIN_MATCH +
+            match_length(src + candidate + LZ_MIN_MATCH,
+                         src + ip + LZ_MIN_MATCH, end);
+        op = write_sequence(op, src + anchor, ip - anchor,
+                            ip - candidate, mlen);
+        ip += mlen;
+        anchor = ip;
+      } else {
+        // skip faster through data which does not compress
+        ip += 1 + ((ip - anchor) >> 6);
+      }
+    }
+    op = write_sequence(op, src + anchor, len - anchor, 0, 0);
+    return op - dst;
+  }
+
+  // reads a length continued by bytes of 255. Returns false past the end
+  static inline bool read_length(const unsigned char*& ip,
+                                 const unsigned char* iend, size_t& n) {
+    unsigned char b;
+    do {
+      if (ip >= iend) return false;
+      b = *ip++;
+      n += b;
+    } while (b == 255);
+    return true;
+  }
+
+  bool lz_decompress(const char* src, size_t len, char* dst, size_t rawlen) {
+    const unsigned char* ip = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* iend = ip + len;
+    size_t op = 0;
+    while (ip < iend) {
+      unsigned char token = *ip++;
+      size_t nliterals = token >> 4;
+      if (nliterals == 15 && !read_length(ip, iend, nliterals)) return false;
+      if (nliterals > (size_t)(iend - ip) || nliterals > rawlen - op) {
+        return false;
+      }
+      memcpy(dst + op, ip, nliterals);
+      ip += nliterals;
+      op += nliterals;
+      // the last sequence has no match
+      if (ip == iend) break;
+      if (iend - ip < 2) return false;
+      size_t offset = ip[0] | (size_t(ip[1]) << 8);
+      ip += 2;
+      if (offset == 0 || offset > op) return false;
+      size_t mlen = token & 15;
+      if (mlen == 15 && !read_length(ip, iend, mlen)) return false;
+      mlen += LZ_MIN_MATCH;
+      if (mlen > rawlen - op) return false;
+      char* out = dst + op;
+      const char* match = out - offset;
+      if (offset >= mlen) {
+        memcpy(out, match, mlen);
+      } else {
+        // the match overlaps the bytes it produces
+        for (size_t i = 0;i < mlen; ++i) out[i] = match[i];
+      }
+      op += mlen;
+    }
+    return op == rawlen;
+  }
+}
@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_LZ_COMPRESS_HPP
+#define GRAPHLAB_LZ_COMPRESS_HPP
+#include <cstddef>
+
+namespace graphlab {
+  /**
+   * \ingroup util
+   * The largest size of lz_compress() output for len bytes of input.
+   */
+  inline size_t lz_compress_bound(size_t len) {
+    return len + len / 255 + 16;
+  }
+
+  /**
+   * \ingroup util
+   * Compresses len bytes at src into dst, which must hold
+   * lz_compress_bound(len) bytes, and returns the compressed size.
+   *
+   * A single pass LZ77 compressor in the manner of LZ4: greedy matches
+   * of at least 4 bytes, found through a hash table of the last
+   * position of each 4 byte sequence, at most 64KB back. It runs at
+   * several hundred MB/s and trades ratio for speed, for data which is
+   * otherwise sent as is. Incompressible input is skipped over faster.
+   */
+  size_t lz_compress(const char* src, size_t len, char* dst);
+
+  /**
+   * \ingroup util
+   * Decompresses len bytes of lz_compress() output at src into the
+   * rawlen bytes at dst. Returns false if the input is malformed or does
+   * not decompress into exactly rawlen bytes.
+   */
+  bool lz_decompress(const char* src, size_t len, char* dst, size_t rawlen);
+}
+#endif
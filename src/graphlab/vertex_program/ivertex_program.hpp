@@ -27,6 +27,9 @@
 #define GRAPHLAB_IVERTEX_PROGRAM_HPP
 
 
+#include <cstdlib>
+#include <cstring>
+
 #include <graphlab/vertex_program/icontext.hpp>
 #include <graphlab/util/empty.hpp>
 #include <graphlab/graph/graph_basic_types.hpp>
@@ -764,6 +767,53 @@ namespace graphlab {
     virtual void post_local_gather(gather_type&) const {
     }
 
+    /**
+     * \brief Encodes the change of the vertex data made by apply.
+     *
+     * Only called when the engine option \c track_changes is set. The
+     * engine then calls diff_vertex_data on the master after every
+     * apply, with the vertex data before and after the apply, and
+     * forwards delta to the mirrors only if it returns true. Each mirror
+     * passes the delta to patch_vertex_data.
+     *
+     * On entry delta holds new_data serialized from offset 0, which the
+     * engine also uses to measure the full update. Returning true with
+     * delta unchanged sends the whole new value. The default
+     * implementation does that unless old_data serializes to the same
+     * bytes, so an apply that leaves the data unchanged is not
+     * broadcast. Vertex programs with large vertex data of which apply
+     * only changes a small part may override both functions, rewinding
+     * delta.off to 0 and writing only that part.
+     *
+     * \param [in] old_data The vertex data before the apply
+     * \param [in] new_data The vertex data after the apply
+     * \param [in,out] delta An in-memory archive holding new_data, and
+     *                   on return the change
+     * \return false if the mirrors need not be updated
+     */
+    virtual bool diff_vertex_data(const vertex_data_type& old_data,
+                                  const vertex_data_type& new_data,
+                                  oarchive& delta) const {
+      oarchive old_arc;
+      old_arc << old_data;
+      const bool changed = (delta.off != old_arc.off) ||
+        (old_arc.off > 0 && memcmp(delta.buf, old_arc.buf, old_arc.off) != 0);
+      free(old_arc.buf);
+      return changed;
+    }
+
+    /**
+     * \brief Applies a change written by diff_vertex_data to the
+     * vertex data of a mirror.
+     *
+     * Called on a default constructed vertex program. The default
+     * implementation reads the whole new value.
+     */
+    virtual void patch_vertex_data(vertex_data_type& data,
+                                   iarchive& delta) const {
+      delta >> data;
+    }
+
   };  // end of ivertex_program
  
 }; //end of namespace graphlab
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/graph/builtin_parsers.hpp>
+using namespace graphlab;
+
+// collects the edges handed to it by the parsers
+struct edge_collector {
+  typedef size_t vertex_id_type;
+  std::vector<std::pair<size_t, size_t> > edges;
+  void add_edge(size_t source, size_t target) {
+    edges.push_back(std::make_pair(source, target));
+  }
+  void add_edges(const std::vector<std::pair<size_t, size_t> >& e) {
+    edges.insert(edges.end(), e.begin(), e.end());
+  }
+};
+
+class BuiltinParsersTestSuite : public CxxTest::TestSuite {
+  typedef bool (*block_parser_type)(edge_collector&, const std::string&,
+                                    const char*, const char*);
+
+  std::vector<std::pair<size_t, size_t> >
+  parse(block_parser_type parser, const std::string& text) {
+    edge_collector graph;
+    TS_ASSERT(parser(graph, "test", text.c_str(), text.c_str() + text.size()));
+    return graph.edges;
+  }
+
+public:
+  void test_header_lines_are_skipped(void) {
+    const std::string tsv = "source\ttarget\n1\t2\n\n3 4\r\nnot an edge\n5\t5\n6\t7";
+    std::vector<std::pair<size_t, size_t> > edges =
+        parse(builtin_parsers::tsv_block_parser<edge_collector>, tsv);
+    TS_ASSERT_EQUALS(edges.size(), 3);
+    TS_ASSERT_EQUALS(edges[0], std::make_pair(size_t(1), size_t(2)));
+    TS_ASSERT_EQUALS(edges[1], std::make_pair(size_t(3), size_t(4)));
+    TS_ASSERT_EQUALS(edges[2], std::make_pair(size_t(6), size_t(7)));
+
+    edges = parse(builtin_parsers::rtsv_block_parser<edge_collector>, tsv);
+    TS_ASSERT_EQUALS(edges.size(), 3);
+    TS_ASSERT_EQUALS(edges[0], std::make_pair(size_t(2), size_t(1)));
+
+    const std::string csv = "src,dst\n1,2\nno comma here\n8\n3,4\n";
+    edges = parse(builtin_parsers::csv_block_parser<edge_collector>, csv);
+    TS_ASSERT_EQUALS(edges.size(), 2);
+    TS_ASSERT_EQUALS(edges[1], std::make_pair(size_t(3), size_t(4)));
+  }
+
+  void test_snap_comments(void) {
+    const std::string snap = "# Nodes: 3 Edges: 2\n% other comment\n1 2\n2 3\n";
+    std::vector<std::pair<size_t, size_t> > edges =
+        parse(builtin_parsers::snap_block_parser<edge_collector>, snap);
+    TS_ASSERT_EQUALS(edges.size(), 2);
+    TS_ASSERT_EQUALS(edges[1], std::make_pair(size_t(2), size_t(3)));
+  }
+};
@@ -210,6 +210,37 @@ class csr_storage_test : public CxxTest::TestSuite {
     printf("+ Pass test: dynamic_csr_storage stress insertion:)\n\n");
   }
 
+  void test_counting_sort_stable() {
+    std::cout << "Test counting_sort" << std::endl;
+    // few keys (one histogram per thread) and many keys (fewer histograms)
+    const size_t nkeys_arr[] = {7, 1000, 200000};
+    for (size_t t = 0; t < 3; ++t) {
+      const size_t nkeys = nkeys_arr[t];
+      std::vector<keytype> keys(100000);
+      for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = (i * 2654435761u) % nkeys;
+      }
+      std::vector<sizetype> permute_index;
+      std::vector<sizetype> prefix;
+      graphlab::counting_sort(keys, permute_index, &prefix);
+      ASSERT_EQ(permute_index.size(), keys.size());
+      for (size_t i = 1; i < permute_index.size(); ++i) {
+        const keytype prev = keys[permute_index[i-1]];
+        const keytype cur = keys[permute_index[i]];
+        ASSERT_LE(prev, cur);
+        // equal keys keep their input order
+        if (prev == cur) ASSERT_LT(permute_index[i-1], permute_index[i]);
+      }
+      for (size_t k = 0; k < prefix.size(); ++k) {
+        const size_t end = k + 1 < prefix.size() ? prefix[k+1] : keys.size();
+        for (size_t i = prefix[k]; i < end; ++i) {
+          ASSERT_EQ(keys[permute_index[i]], k);
+        }
+      }
+    }
+    printf("+ Pass test: counting_sort :)\n\n");
+  }
+
  private:
   template<typename csr_type>
       void check(csr_type& csr,
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <unistd.h>
+#include <sys/wait.h>
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/rpc/dc_shm_channels.hpp>
+#include <graphlab/util/stl_util.hpp>
+using namespace graphlab;
+using namespace graphlab::dc_impl;
+
+static const size_t NBYTES = 64 * 1024 * 1024;
+
+char pattern(size_t i, size_t proc) {
+  return char(i * 131 + proc);
+}
+
+/*
+ * Processes 0 and 1 stream NBYTES to each other through rings much
+ * smaller than the writes, sleeping on the doorbell when they can
+ * neither read nor write. Returns true if every byte arrived in order.
+ */
+bool stream(const std::string& prefix, procid_t me) {
+  std::vector<procid_t> locals;
+  locals.push_back(0);
+  locals.push_back(1);
+  dc_shm_channels shm;
+  if (!shm.create(prefix, 2, me, locals, 65536)) return false;
+  // wait for the other inbox
+  for (size_t i = 0;i < 1000 && !shm.attach(1 - me); ++i) usleep(10000);
+  if (!shm.attached(1 - me)) return false;
+  const procid_t other = 1 - me;
+  std::vector<char> out(100000), in(70000);
+  unsigned int seed = me + 1;
+  size_t sent = 0, received = 0;
+  while (sent < NBYTES || received < NBYTES) {
+    bool progress = false;
+    if (sent < NBYTES) {
+      size_t len = std::min<size_t>(rand_r(&seed) % out.size() + 1,
+                                    NBYTES - sent);
+      for (size_t i = 0;i < len; ++i) out[i] = pattern(sent + i, me);
+      struct iovec iov[2];
+      iov[0].iov_base = &out[0];
+      iov[0].iov_len = len / 2;
+      iov[1].iov_base = &out[len / 2];
+      iov[1].iov_len = len - len / 2;
+      size_t written = shm.write(other, iov, 2);
+      if (written == 0) shm.set_writer_waiting(other);
+      sent += written;
+      progress = progress || written > 0;
+    }
+    size_t len = shm.read(other, &in[0], rand_r(&seed) % in.size() + 1);
+    for (size_t i = 0;i < len; ++i) {
+      if (in[i] != pattern(received + i, other)) return false;
+    }
+    received += len;
+    progress = progress || len > 0;
+    if (!progress) {
+      uint32_t doorbell = shm.prepare_sleep();
+      if (shm.readable(other) || (sent < NBYTES && shm.writable(other))) {
+        shm.cancel_sleep();
+      } else {
+        // a lost wake up would stall the test for a minute
+        shm.sleep(doorbell, 60 * 1000000);
+      }
+    }
+  }
+  return true;
+}
+
+class ShmChannelsTestSuite : public CxxTest::TestSuite {
+public:
+  void test_stream_between_processes(void) {
+    std::string prefix = "/graphlab_test_" + tostr(getpid()) + "_";
+    pid_t child = fork();
+    if (child == 0) _exit(stream(prefix, 1) ? 0 : 1);
+    TS_ASSERT(stream(prefix, 0));
+    int status = 0;
+    waitpid(child, &status, 0);
+    TS_ASSERT(WIFEXITED(status));
+    TS_ASSERT_EQUALS(WEXITSTATUS(status), 0);
+  }
+
+  void test_self_and_missing_peer(void) {
+    std::string prefix = "/graphlab_test_" + tostr(getpid()) + "_self_";
+    std::vector<procid_t> locals;
+    locals.push_back(0);
+    locals.push_back(2);
+    dc_shm_channels shm;
+    TS_ASSERT(shm.create(prefix, 3, 0, locals, 4096));
+    TS_ASSERT(shm.attach(0));
+    // process 1 is remote, and process 2 never created its inbox
+    TS_ASSERT(!shm.attach(1));
+    TS_ASSERT(!shm.attach(2));
+    TS_ASSERT(!shm.attached(2));
+    // a ring to itself holds its capacity
+    std::string s(5000, 'x');
+    struct iovec iov;
+    iov.iov_base = &s[0];
+    iov.iov_len = s.size();
+    TS_ASSERT_EQUALS(shm.write(0, &iov, 1), 4096);
+    TS_ASSERT(!shm.writable(0));
+    TS_ASSERT(shm.readable(0));
+    std::vector<char> buf(8192);
+    TS_ASSERT_EQUALS(shm.read(0, &buf[0], buf.size()), 4096);
+    TS_ASSERT(!shm.readable(0));
+    TS_ASSERT(shm.writable(0));
+  }
+};
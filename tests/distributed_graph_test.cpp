@@ -124,7 +124,35 @@ class distributed_graph_test  {
      dc->cout() << "\n+ Pass test: graph save load binary. :) \n";
    }
 
+   /**
+    * Test relabeling the local vertices after finalize
+    */
+   void test_reorder() {
+     const char* methods[] = {"degree", "rcm"};
+     for (size_t i = 0; i < 2; ++i) {
+       graphlab::graphlab_options opts;
+       opts.get_graph_args().set_option("reorder", methods[i]);
+       graphlab::distributed_graph<vertex_data, edge_data> g(*dc, opts);
+       test_add_edge_impl(g, 1000);
+       check_masters_first(g);
+       if (g.is_dynamic()) {
+         test_add_edge_impl(g, 1000, true);
+         check_masters_first(g);
+       }
+     }
+     dc->cout() << "\n+ Pass test: graph reorder. :) \n";
+   }
+
  private: 
+   template<typename Graph>
+       void check_masters_first(Graph& g) {
+         bool seen_mirror = false;
+         for (size_t i = 0; i < g.num_local_vertices(); ++i) {
+           if (g.l_is_master(i)) ASSERT_FALSE(seen_mirror);
+           else seen_mirror = true;
+         }
+       }
+
    template<typename Graph>
        void test_add_vertex_impl(Graph& g, size_t nverts) {
          g.clear();
@@ -506,6 +534,7 @@ int main(int argc, char** argv) {
   testsuit.test_add_edge();
   testsuit.test_dynamic_add_edge();
   testsuit.test_save_load();
+  testsuit.test_reorder();
 
   delete(dc);
   graphlab::mpi_tools::finalize();
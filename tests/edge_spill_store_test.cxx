@@ -0,0 +1,201 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cxxtest/TestSuite.h>
+#include <boost/unordered_map.hpp>
+#include <graphlab/graph/ingress/edge_spill_store.hpp>
+#include <graphlab/graph/local_graph.hpp>
+#include <graphlab/graph/dynamic_local_graph.hpp>
+#include <graphlab/macros_def.hpp>
+using namespace graphlab;
+
+typedef edge_spill_store<int> store_type;
+
+struct test_edge {
+  vertex_id_type source, target;
+  int edata;
+  test_edge(vertex_id_type source, vertex_id_type target, int edata) :
+    source(source), target(target), edata(edata) { }
+};
+
+class EdgeSpillStoreTestSuite : public CxxTest::TestSuite {
+public:
+  std::vector<test_edge> random_edges(size_t n) {
+    std::vector<test_edge> edges;
+    size_t x = 12345;
+    while (edges.size() < n) {
+      x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+      // sparse vids with repeated edges; local graphs reject self edges
+      const vertex_id_type s = (x >> 33) % 997 * 1000003;
+      const vertex_id_type t = (x >> 13) % 997 * 1000003;
+      if (s != t) edges.push_back(test_edge(s, t, int(edges.size())));
+    }
+    return edges;
+  }
+
+  void spill(store_type& store, const std::vector<test_edge>& edges) {
+    // add in irregular batches
+    for (size_t i = 0; i < edges.size(); i += 37) {
+      std::vector<test_edge> batch(edges.begin() + i,
+          edges.begin() + std::min(i + 37, edges.size()));
+      store.add_records(batch);
+    }
+    store.flush();
+  }
+
+  void test_merge_order(void) {
+    std::vector<test_edge> edges = random_edges(10000);
+    store_type store("edge_spill_test", 1000);
+    spill(store, edges);
+    TS_ASSERT_EQUALS(store.num_edges(), edges.size());
+    store_type::merge_reader reader(store);
+    store_type::edge_record rec, last;
+    std::vector<int> seen;
+    while (reader.next(rec)) {
+      if (!seen.empty()) TS_ASSERT(!(rec < last));
+      const test_edge& e = edges[rec.edata];
+      TS_ASSERT_EQUALS(rec.source, e.source);
+      TS_ASSERT_EQUALS(rec.target, e.target);
+      seen.push_back(rec.edata);
+      last = rec;
+    }
+    std::sort(seen.begin(), seen.end());
+    TS_ASSERT_EQUALS(seen.size(), edges.size());
+    for (size_t i = 0; i < seen.size(); ++i) TS_ASSERT_EQUALS(seen[i], int(i));
+    store.clear();
+    TS_ASSERT_EQUALS(store.num_edges(), 0);
+  }
+
+  void add_batches(store_type* store, const std::vector<test_edge>* edges,
+                   size_t first, size_t step) {
+    for (size_t i = first * 37; i < edges->size(); i += step * 37) {
+      std::vector<test_edge> batch(edges->begin() + i,
+          edges->begin() + std::min(i + 37, edges->size()));
+      store->add_records(batch);
+    }
+  }
+
+  void test_concurrent_adds(void) {
+    // many small runs, so the adders wait for the writer thread
+    std::vector<test_edge> edges = random_edges(50000);
+    store_type store("edge_spill_test", 500);
+    thread_group group;
+    for (size_t i = 0; i < 4; ++i) {
+      group.launch(boost::bind(&EdgeSpillStoreTestSuite::add_batches, this,
+                               &store, &edges, i, 4));
+    }
+    group.join();
+    store.flush();
+    TS_ASSERT_EQUALS(store.num_edges(), edges.size());
+    store_type::merge_reader reader(store);
+    store_type::edge_record rec, last;
+    std::vector<int> seen;
+    while (reader.next(rec)) {
+      if (!seen.empty()) TS_ASSERT(!(rec < last));
+      TS_ASSERT_EQUALS(rec.source, edges[rec.edata].source);
+      seen.push_back(rec.edata);
+      last = rec;
+    }
+    std::sort(seen.begin(), seen.end());
+    TS_ASSERT_EQUALS(seen.size(), edges.size());
+    for (size_t i = 0; i < seen.size(); ++i) TS_ASSERT_EQUALS(seen[i], int(i));
+  }
+
+  void test_serialized_edge_data(void) {
+    // edge data which is not POD is serialized record by record
+    std::vector<test_edge> edges = random_edges(5000);
+    std::vector<std::pair<vertex_id_type, vertex_id_type> > expected;
+    edge_spill_store<std::string> store("edge_spill_test", 700);
+    for (size_t i = 0; i < edges.size(); ++i) {
+      std::vector<edge_spill_store<std::string>::edge_record> one(1,
+          edge_spill_store<std::string>::edge_record(edges[i].source,
+              edges[i].target, tostr(edges[i].edata)));
+      store.add_records(one);
+      expected.push_back(std::make_pair(edges[i].source, edges[i].target));
+    }
+    store.flush();
+    std::sort(expected.begin(), expected.end());
+    edge_spill_store<std::string>::merge_reader reader(store);
+    edge_spill_store<std::string>::edge_record rec;
+    size_t i = 0;
+    while (reader.next(rec)) {
+      TS_ASSERT_EQUALS(rec.source, expected[i].first);
+      TS_ASSERT_EQUALS(rec.target, expected[i].second);
+      const test_edge& e = edges[atoi(rec.edata.c_str())];
+      TS_ASSERT_EQUALS(rec.source, e.source);
+      TS_ASSERT_EQUALS(rec.target, e.target);
+      ++i;
+    }
+    TS_ASSERT_EQUALS(i, edges.size());
+  }
+
+  template <typename Graph>
+  void check_build(void) {
+    std::vector<test_edge> edges = random_edges(20000);
+    store_type store("edge_spill_test", 3000);
+    spill(store, edges);
+    Graph spilled;
+    boost::unordered_map<vertex_id_type, lvid_type> vid2lvid;
+    store.build_local_graph(spilled, vid2lvid);
+    store.clear();
+
+    // the same graph built in memory with the same vertex numbering
+    Graph expected;
+    expected.resize(vid2lvid.size());
+    foreach(const test_edge& e, edges) {
+      expected.add_edge(vid2lvid[e.source], vid2lvid[e.target], e.edata);
+    }
+    expected.finalize();
+
+    TS_ASSERT_EQUALS(spilled.num_vertices(), expected.num_vertices());
+    TS_ASSERT_EQUALS(spilled.num_edges(), expected.num_edges());
+    for (lvid_type v = 0; v < expected.num_vertices(); ++v) {
+      TS_ASSERT(adjacency(spilled, v, true) == adjacency(expected, v, true));
+      TS_ASSERT(adjacency(spilled, v, false) == adjacency(expected, v, false));
+    }
+  }
+
+  template <typename Graph>
+  std::vector<std::pair<lvid_type, int> > adjacency(Graph& g, lvid_type v, bool out) {
+    std::vector<std::pair<lvid_type, int> > ret;
+    if (out) {
+      foreach(const typename Graph::edge_type& e, g.out_edges(v))
+        ret.push_back(std::make_pair(e.target().id(), e.data()));
+    } else {
+      foreach(const typename Graph::edge_type& e, g.in_edges(v))
+        ret.push_back(std::make_pair(e.source().id(), e.data()));
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+  }
+
+  void test_build_local_graph(void) {
+    check_build<local_graph<int, int> >();
+    check_build<dynamic_local_graph<int, int> >();
+  }
+};
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <cstdlib>
+#include <boost/bind.hpp>
+#include <graphlab/parallel/fiber_group.hpp>
+#include <graphlab/util/timer.hpp>
+using namespace graphlab;
+
+/*
+ * Measures the rate of launching short lived fibers, from outside the
+ * workers and from within fibers, and how many of the launches
+ * recycled the stack of a terminated fiber or were stolen by another
+ * worker.
+ *
+ * usage: fiber_launch_bench [nfibers] [stacksize] [guard_pages] [nworkers]
+ */
+size_t nfibers = 100000;
+size_t stacksize = 16384;
+atomic<size_t> ncalls;
+
+void shortfn() {
+  ncalls.inc();
+}
+
+// launches n short fibers from within a fiber, as the engines do
+void launcherfn(fiber_group* group, size_t n) {
+  for (size_t i = 0;i < n; ++i) {
+    group->launch(shortfn);
+    // let the launched fibers run and terminate
+    if (i % 64 == 63) fiber_control::yield();
+  }
+}
+
+void report(const char* name, double t, size_t stacks0, size_t recycled0,
+            size_t stolen0) {
+  fiber_control& fc = fiber_control::get_instance();
+  std::cout << name << ": " << nfibers / t << " launches/s, "
+            << fc.total_stacks_allocated() - stacks0 << " stacks allocated, "
+            << fc.total_fibers_recycled() - recycled0 << " fibers recycled, "
+            << fc.total_fibers_stolen() - stolen0 << " fibers stolen\n";
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) nfibers = atol(argv[1]);
+  if (argc > 2) stacksize = atol(argv[2]);
+  bool guard_pages = argc > 3 && atoi(argv[3]) != 0;
+  if (argc > 4) fiber_control::instance_set_parameters(atol(argv[4]), 0);
+  fiber_control::instance_set_stack_parameters(guard_pages, 16 * 1024 * 1024);
+  fiber_control& fc = fiber_control::get_instance();
+  std::cout << fc.num_workers() << " workers, stacksize " << stacksize
+            << (guard_pages ? ", guard pages\n" : "\n");
+
+  for (size_t round = 0;round < 3; ++round) {
+    size_t stacks0 = fc.total_stacks_allocated();
+    size_t recycled0 = fc.total_fibers_recycled();
+    size_t stolen0 = fc.total_fibers_stolen();
+    timer ti; ti.start();
+    fiber_group group;
+    group.set_stacksize(stacksize);
+    for (size_t i = 0;i < nfibers; ++i) group.launch(shortfn);
+    group.join();
+    report("outside the workers", ti.current_time(),
+           stacks0, recycled0, stolen0);
+
+    stacks0 = fc.total_stacks_allocated();
+    recycled0 = fc.total_fibers_recycled();
+    stolen0 = fc.total_fibers_stolen();
+    ti.start();
+    // fiber_group::join() blocks the worker, so only the main thread joins
+    fiber_group launched;
+    launched.set_stacksize(stacksize);
+    const size_t nlaunchers = fc.num_workers();
+    for (size_t i = 0;i < nlaunchers; ++i) {
+      launched.launch(boost::bind(launcherfn, &launched, nfibers / nlaunchers));
+    }
+    launched.join();
+    report("within fibers", ti.current_time(), stacks0, recycled0, stolen0);
+  }
+  std::cout << ncalls.value << " calls\n";
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <vector>
+#include <boost/bind.hpp>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/engine/gather_part_queues.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+using namespace graphlab;
+
+typedef gather_part_queues<size_t> queues_type;
+
+static const size_t NTHREADS = 4;
+
+// sums the edge ids of the parts, stealing once the own queue is empty
+void drain(queues_type* queues, size_t t, std::vector<size_t>* results) {
+  queues_type::gather_part part;
+  while (queues->num_pending() > 0) {
+    if (!queues->next(t, true, part)) continue;
+    size_t accum = 0;
+    for (size_t i = part.begin; i < part.end; ++i) {
+      accum += part.in_edges ? i : 1000000 + i;
+    }
+    if (queues->combine(part, accum, true)) {
+      (*results)[part.lvid] = part.gather->accum;
+      delete part.gather;
+    }
+    queues->part_done();
+  }
+}
+
+class GatherPartQueuesTestSuite : public CxxTest::TestSuite {
+public:
+  void test_split(void) {
+    queues_type queues;
+    queues.resize(NTHREADS);
+    TS_ASSERT_EQUALS(queues.part_edges(100, 10), 10);
+    TS_ASSERT_EQUALS(queues.part_edges(1600, 10), 100);
+    queues.split(0, 7, 25, 10, 10, 0);
+    // 3 parts of in edges and 1 part of out edges
+    TS_ASSERT_EQUALS(queues.num_pending(), 4);
+    queues_type::gather_part part;
+    TS_ASSERT(!queues.next(1, false, part));
+    // the own queue is taken from the back
+    TS_ASSERT(queues.next(0, false, part));
+    TS_ASSERT(!part.in_edges);
+    TS_ASSERT_EQUALS(part.end - part.begin, 10);
+    TS_ASSERT(!queues.combine(part, 5, true));
+    queues.part_done();
+    // thieves take from the front
+    TS_ASSERT(queues.next(1, true, part));
+    TS_ASSERT(part.in_edges);
+    TS_ASSERT_EQUALS(part.begin, 0);
+    TS_ASSERT(!queues.combine(part, 0, false));
+    queues.part_done();
+    size_t last = 0;
+    while (queues.next(2, true, part)) {
+      last = queues.combine(part, 1, true);
+      queues.part_done();
+    }
+    TS_ASSERT(last);
+    TS_ASSERT_EQUALS(part.gather->accum, 7);
+    TS_ASSERT_EQUALS(queues.num_pending(), 0);
+    delete part.gather;
+  }
+
+  void test_parallel_steal(void) {
+    queues_type queues;
+    queues.resize(NTHREADS);
+    std::vector<size_t> results(10, 0);
+    for (size_t lvid = 0; lvid < results.size(); ++lvid) {
+      queues.split(lvid % 2, lvid, 1000 * lvid, 100, 64, 0);
+    }
+    thread_group group;
+    for (size_t t = 0; t < NTHREADS; ++t) {
+      group.launch(boost::bind(drain, &queues, t, &results));
+    }
+    group.join();
+    for (size_t lvid = 0; lvid < results.size(); ++lvid) {
+      const size_t nin = 1000 * lvid;
+      TS_ASSERT_EQUALS(results[lvid],
+                       nin * (nin - (nin > 0)) / 2 + 100 * 1000000 + 4950);
+    }
+  }
+};
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/engine/hybrid_frontier.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/macros_def.hpp>
+using namespace graphlab;
+
+static const size_t NTHREADS = 8;
+static const size_t NVERTS = 10000;
+
+// thread t sets every NTHREADS-th multiple of step, starting at t * step
+void set_stride(hybrid_frontier* frontier, size_t t, size_t step) {
+  for (size_t lvid = t * step; lvid < NVERTS; lvid += NTHREADS * step) {
+    frontier->set_bit(lvid);
+  }
+}
+
+// returns every lvid of a sweep, sorted
+std::vector<lvid_type> sweep(hybrid_frontier& frontier, bool use_queue) {
+  atomic<size_t> counter(0);
+  std::vector<lvid_type> ret, block;
+  frontier.begin_sweep(use_queue);
+  while (frontier.next_block(counter, block)) {
+    ret.insert(ret.end(), block.begin(), block.end());
+  }
+  std::sort(ret.begin(), ret.end());
+  return ret;
+}
+
+class HybridFrontierTestSuite : public CxxTest::TestSuite {
+public:
+  void test_sparse_and_dense(void) {
+    hybrid_frontier frontier;
+    frontier.resize(NVERTS, 100);
+    TS_ASSERT(frontier.is_sparse());
+    TS_ASSERT(!frontier.set_bit(5));
+    TS_ASSERT(frontier.set_bit(5));
+    frontier.set_bit(NVERTS - 1);
+    frontier.set_bit(700);
+    TS_ASSERT(frontier.is_sparse());
+    TS_ASSERT_EQUALS(frontier.num_queued(), 3);
+    // cleared bits are skipped by the sweeps
+    frontier.clear_bit(700);
+    std::vector<lvid_type> lvids = sweep(frontier, true);
+    TS_ASSERT_EQUALS(lvids.size(), 2);
+    TS_ASSERT_EQUALS(lvids[0], 5);
+    TS_ASSERT_EQUALS(lvids[1], NVERTS - 1);
+    TS_ASSERT(sweep(frontier, false) == lvids);
+
+    // overflowing the queue makes the frontier dense
+    for (size_t i = 0; i < 200; ++i) frontier.set_bit(i * 10 + 1);
+    TS_ASSERT(!frontier.is_sparse());
+    TS_ASSERT_EQUALS(sweep(frontier, true).size(), 202);
+    TS_ASSERT(!frontier.make_sparse());
+
+    // and it is sparse again once empty
+    frontier.clear();
+    TS_ASSERT(frontier.is_sparse());
+    TS_ASSERT(sweep(frontier, true).empty());
+    TS_ASSERT(sweep(frontier, false).empty());
+  }
+
+  void test_make_sparse(void) {
+    hybrid_frontier frontier;
+    frontier.resize(NVERTS, 1000);
+    frontier.fill();
+    TS_ASSERT(!frontier.is_sparse());
+    TS_ASSERT_EQUALS(sweep(frontier, true).size(), NVERTS);
+    for (size_t lvid = 0; lvid < NVERTS; ++lvid) {
+      if (lvid % 17 != 0) frontier.clear_bit(lvid);
+    }
+    TS_ASSERT(frontier.make_sparse());
+    TS_ASSERT_EQUALS(frontier.num_queued(), (NVERTS + 16) / 17);
+    // the queue is in lvid order
+    for (size_t i = 0; i < frontier.num_queued(); ++i) {
+      TS_ASSERT_EQUALS(frontier.queued(i), i * 17);
+    }
+    TS_ASSERT(sweep(frontier, true) == sweep(frontier, false));
+  }
+
+  void test_parallel_set(void) {
+    const size_t steps[] = {1, 50};
+    for (size_t s = 0; s < 2; ++s) {
+      hybrid_frontier frontier;
+      frontier.resize(NVERTS, 500);
+      thread_group group;
+      for (size_t t = 0; t < NTHREADS; ++t) {
+        group.launch(boost::bind(set_stride, &frontier, t, steps[s]));
+      }
+      group.join();
+      std::vector<lvid_type> lvids = sweep(frontier, true);
+      for (size_t i = 0; i < lvids.size(); ++i) {
+        TS_ASSERT_EQUALS(lvids[i] % steps[s], 0);
+      }
+      TS_ASSERT_EQUALS(lvids.size(), (NVERTS + steps[s] - 1) / steps[s]);
+      TS_ASSERT_EQUALS(frontier.is_sparse(), steps[s] > 1);
+      frontier.clear();
+      TS_ASSERT(sweep(frontier, false).empty());
+    }
+  }
+};
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <cstdlib>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/util/lz_compress.hpp>
+using namespace graphlab;
+
+class LzCompressTestSuite : public CxxTest::TestSuite {
+  // compresses and decompresses src, returning the compressed size
+  size_t roundtrip(const std::vector<char>& src) {
+    std::vector<char> compressed(lz_compress_bound(src.size()));
+    size_t clen = lz_compress(&src[0], src.size(), &compressed[0]);
+    TS_ASSERT_LESS_THAN_EQUALS(clen, compressed.size());
+    std::vector<char> raw(src.size() + 1);
+    TS_ASSERT(lz_decompress(&compressed[0], clen, &raw[0], src.size()));
+    raw.resize(src.size());
+    TS_ASSERT(raw == src);
+    return clen;
+  }
+
+public:
+  void test_sorted_ids(void) {
+    std::vector<char> src;
+    for (size_t i = 0;i < 100000; ++i) {
+      size_t id = i * 3;
+      src.insert(src.end(), (char*)&id, (char*)&id + sizeof(size_t));
+    }
+    TS_ASSERT_LESS_THAN(roundtrip(src), src.size() * 2 / 3);
+  }
+
+  void test_random(void) {
+    srand(1);
+    for (size_t len = 0;len < 2000; len += 37) {
+      std::vector<char> src(len + 1);
+      for (size_t i = 0;i < len; ++i) src[i] = rand() % (i % 3 ? 256 : 4);
+      src.resize(len);
+      if (len > 0) roundtrip(src);
+    }
+  }
+
+  void test_malformed(void) {
+    std::vector<char> src(10000, 'a');
+    std::vector<char> compressed(lz_compress_bound(src.size()));
+    size_t clen = lz_compress(&src[0], src.size(), &compressed[0]);
+    std::vector<char> raw(src.size());
+    // the wrong length or truncated input is rejected
+    TS_ASSERT(!lz_decompress(&compressed[0], clen, &raw[0], src.size() - 1));
+    TS_ASSERT(!lz_decompress(&compressed[0], clen / 2, &raw[0], src.size()));
+    srand(2);
+    for (size_t i = 0;i < 1000; ++i) {
+      std::vector<char> corrupt(compressed.begin(), compressed.begin() + clen);
+      corrupt[rand() % clen] = rand();
+      lz_decompress(&corrupt[0], clen, &raw[0], raw.size());
+    }
+  }
+};
@@ -0,0 +1,102 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/graph/mirror_set.hpp>
+#include <graphlab/macros_def.hpp>
+using namespace graphlab;
+
+class MirrorSetTestSuite : public CxxTest::TestSuite {
+public:
+  void check_contents(const mirror_set& s, std::vector<size_t> expected) {
+    std::sort(expected.begin(), expected.end());
+    expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+    TS_ASSERT_EQUALS(s.popcount(), expected.size());
+    TS_ASSERT_EQUALS(s.empty(), expected.empty());
+    std::vector<size_t> actual;
+    foreach(size_t p, s) actual.push_back(p);
+    TS_ASSERT(actual == expected);
+    for (size_t i = 0; i < 1100; ++i) {
+      bool inexpected = std::binary_search(expected.begin(), expected.end(), i);
+      TS_ASSERT_EQUALS(s.get(i), inexpected);
+    }
+  }
+
+  void test_inline_and_spill(void) {
+    mirror_set s;
+    check_contents(s, std::vector<size_t>());
+    size_t probes[8] = {7, 2, 7, 1000, 2, 130, 0, 64};
+    std::vector<size_t> inserted;
+    for (size_t i = 0; i < 8; ++i) {
+      bool existed = std::find(inserted.begin(), inserted.end(), probes[i])
+                     != inserted.end();
+      TS_ASSERT_EQUALS(s.set_bit(probes[i]), existed);
+      inserted.push_back(probes[i]);
+      check_contents(s, inserted);
+    }
+    // copies are deep and compare equal
+    mirror_set s2(s);
+    TS_ASSERT(s2 == s);
+    s.clear();
+    check_contents(s, std::vector<size_t>());
+    check_contents(s2, inserted);
+    TS_ASSERT(s2 != s);
+    s = s2;
+    TS_ASSERT(s == s2);
+  }
+
+  void test_union_and_serialize(void) {
+    mirror_set a, b;
+    a.set_bit(1); a.set_bit(5);
+    b.set_bit(5); b.set_bit(300); b.set_bit(9);
+    a |= b;
+    size_t expected[4] = {1, 5, 9, 300};
+    check_contents(a, std::vector<size_t>(expected, expected + 4));
+
+    std::stringstream strm;
+    graphlab::oarchive oarc(strm);
+    oarc << a << b;
+    strm.flush();
+    graphlab::iarchive iarc(strm);
+    mirror_set a2, b2;
+    iarc >> a2 >> b2;
+    TS_ASSERT(a2 == a);
+    TS_ASSERT(b2 == b);
+  }
+
+  void test_concurrent_set_bit(void) {
+    mirror_set s;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int i = 0; i < 4000; ++i) {
+      s.set_bit((i * 7) % 1000);
+    }
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < 1000; ++i) expected.push_back(i);
+    check_contents(s, expected);
+  }
+};
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <vector>
+#include <string>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+using namespace graphlab;
+
+struct ring_owner { };
+typedef dc_dist_object<ring_owner> ring_type;
+
+/// A non POD element, so that the serializing codec is used
+struct histogram {
+  std::vector<size_t> counts;
+  histogram& operator+=(const histogram& other) {
+    if (counts.size() < other.counts.size()) counts.resize(other.counts.size());
+    for (size_t i = 0;i < other.counts.size(); ++i) counts[i] += other.counts[i];
+    return *this;
+  }
+  bool operator==(const histogram& other) const {
+    return counts == other.counts;
+  }
+  void save(oarchive& oarc) const { oarc << counts; }
+  void load(iarchive& iarc) { iarc >> counts; }
+};
+
+/*
+ * Runs the ring_all_reduce() schedule of p machines on a single thread.
+ * Every step first encodes what each machine sends, then lets machine
+ * (i + 1) % p add or assign the chunk it receives, which is what the
+ * blocking ring_wait() orders on a real ring.
+ */
+template <typename E>
+void simulate_ring(std::vector<std::vector<E> >& data) {
+  typedef dc_impl::ring_chunk_codec<gl_is_pod<E>::value> codec;
+  const size_t p = data.size();
+  const size_t n = data[0].size();
+  for (size_t phase = 0;phase < 2; ++phase) {
+    for (size_t step = 0;step < p - 1; ++step) {
+      std::vector<std::string> sent(p);
+      std::vector<size_t> sent_chunk(p);
+      for (size_t i = 0;i < p; ++i) {
+        sent_chunk[i] = phase == 0 ?
+          ring_type::ring_reduce_send_chunk(i, step, p) :
+          ring_type::ring_gather_send_chunk(i, step, p);
+        const size_t begin = ring_type::ring_chunk_begin(sent_chunk[i], n, p);
+        const size_t end = ring_type::ring_chunk_begin(sent_chunk[i] + 1, n, p);
+        sent[i] = codec::encode(&data[i][0] + begin, end - begin);
+      }
+      for (size_t i = 0;i < p; ++i) {
+        const size_t prev = (i + p - 1) % p;
+        const size_t chunk = phase == 0 ?
+          ring_type::ring_reduce_recv_chunk(i, step, p) :
+          ring_type::ring_gather_recv_chunk(i, step, p);
+        // a machine receives exactly the chunk its predecessor sent
+        TS_ASSERT_EQUALS(chunk, sent_chunk[prev]);
+        const size_t begin = ring_type::ring_chunk_begin(chunk, n, p);
+        const size_t end = ring_type::ring_chunk_begin(chunk + 1, n, p);
+        if (phase == 0) codec::add(sent[prev], &data[i][0] + begin, end - begin);
+        else codec::assign(sent[prev], &data[i][0] + begin, end - begin);
+      }
+    }
+  }
+}
+
+class RingAllReduceTestSuite : public CxxTest::TestSuite {
+public:
+  void test_chunk_boundaries() {
+    for (size_t p = 2;p <= 64; ++p) {
+      for (size_t n = p;n <= 3 * p + 1; ++n) {
+        TS_ASSERT_EQUALS(ring_type::ring_chunk_begin(0, n, p), 0);
+        TS_ASSERT_EQUALS(ring_type::ring_chunk_begin(p, n, p), n);
+        for (size_t c = 0;c < p; ++c) {
+          const size_t len = ring_type::ring_chunk_begin(c + 1, n, p) -
+                             ring_type::ring_chunk_begin(c, n, p);
+          // chunks are nonempty and differ by at most one element
+          TS_ASSERT(len == n / p || len == n / p + 1);
+        }
+      }
+    }
+  }
+
+  void test_schedule() {
+    for (size_t p = 2;p <= 64; ++p) {
+      std::vector<size_t> reduced(p, 0);
+      for (size_t step = 0;step < p - 1; ++step) {
+        std::vector<bool> sent(p, false), received(p, false);
+        for (size_t i = 0;i < p; ++i) {
+          const size_t next = (i + 1) % p;
+          TS_ASSERT_EQUALS(ring_type::ring_reduce_send_chunk(i, step, p),
+                           ring_type::ring_reduce_recv_chunk(next, step, p));
+          TS_ASSERT_EQUALS(ring_type::ring_gather_send_chunk(i, step, p),
+                           ring_type::ring_gather_recv_chunk(next, step, p));
+          // every chunk moves exactly once per step
+          sent[ring_type::ring_reduce_send_chunk(i, step, p)] = true;
+          received[ring_type::ring_gather_recv_chunk(i, step, p)] = true;
+          ++reduced[ring_type::ring_reduce_recv_chunk(i, step, p)];
+        }
+        for (size_t c = 0;c < p; ++c) {
+          TS_ASSERT(sent[c]);
+          TS_ASSERT(received[c]);
+        }
+      }
+      // every chunk is added p - 1 times, once from every other machine
+      for (size_t c = 0;c < p; ++c) TS_ASSERT_EQUALS(reduced[c], p - 1);
+      // all gather starts with the chunk the reduce-scatter completed
+      for (size_t i = 0;i < p; ++i) {
+        TS_ASSERT_EQUALS(ring_type::ring_gather_send_chunk(i, 0, p),
+                         ring_type::ring_reduce_recv_chunk(i, p - 2, p));
+      }
+    }
+  }
+
+  void test_pod_all_reduce() {
+    for (size_t p = 2;p <= 64; ++p) {
+      const size_t n = 2 * p + 3;
+      std::vector<std::vector<size_t> > data(p, std::vector<size_t>(n));
+      std::vector<size_t> expected(n, 0);
+      for (size_t i = 0;i < p; ++i) {
+        for (size_t j = 0;j < n; ++j) {
+          data[i][j] = (i + 1) * 1000 + j;
+          expected[j] += data[i][j];
+        }
+      }
+      simulate_ring(data);
+      for (size_t i = 0;i < p; ++i) TS_ASSERT(data[i] == expected);
+    }
+  }
+
+  void test_serialized_all_reduce() {
+    for (size_t p = 2;p <= 16; ++p) {
+      const size_t n = p + 1;
+      std::vector<std::vector<histogram> > data(p, std::vector<histogram>(n));
+      std::vector<histogram> expected(n);
+      for (size_t i = 0;i < p; ++i) {
+        for (size_t j = 0;j < n; ++j) {
+          data[i][j].counts.assign((i + j) % 4 + 1, i + 1);
+          expected[j] += data[i][j];
+        }
+      }
+      simulate_ring(data);
+      for (size_t i = 0;i < p; ++i) TS_ASSERT(data[i] == expected);
+    }
+  }
+
+  void test_pod_codec() {
+    typedef dc_impl::ring_chunk_codec<true> codec;
+    std::vector<double> v;
+    for (size_t i = 0;i < 100; ++i) v.push_back(i * 0.5);
+    std::string s = codec::encode(&v[0] + 10, 50);
+    TS_ASSERT_EQUALS(s.length(), 50 * sizeof(double));
+    std::vector<double> out(50, 0);
+    codec::assign(s, &out[0], 50);
+    for (size_t i = 0;i < 50; ++i) TS_ASSERT_EQUALS(out[i], v[i + 10]);
+    codec::add(s, &out[0], 50);
+    for (size_t i = 0;i < 50; ++i) TS_ASSERT_EQUALS(out[i], 2 * v[i + 10]);
+    // empty chunks
+    TS_ASSERT(codec::encode(&v[0], 0).empty());
+    codec::assign(std::string(), &out[0], 0);
+  }
+
+  void test_serialized_codec() {
+    typedef dc_impl::ring_chunk_codec<false> codec;
+    std::vector<histogram> v(20);
+    for (size_t i = 0;i < v.size(); ++i) v[i].counts.assign(i % 5, i);
+    std::string s = codec::encode(&v[0] + 5, 10);
+    std::vector<histogram> out(10);
+    codec::assign(s, &out[0], 10);
+    for (size_t i = 0;i < 10; ++i) TS_ASSERT(out[i] == v[i + 5]);
+    codec::add(s, &out[0], 10);
+    for (size_t i = 0;i < 10; ++i) {
+      histogram twice = v[i + 5];
+      twice += v[i + 5];
+      TS_ASSERT(out[i] == twice);
+    }
+    std::vector<std::string> strs(3);
+    strs[0] = "ring"; strs[2] = std::string(1000, 'x');
+    std::vector<std::string> strs_out(3);
+    dc_impl::ring_chunk_codec<false>::assign(
+        dc_impl::ring_chunk_codec<false>::encode(&strs[0], 3), &strs_out[0], 3);
+    TS_ASSERT(strs_out == strs);
+  }
+};
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/rpc/dc_compile_parameters.hpp>
+#include <graphlab/rpc/send_buffer_pool.hpp>
+#include <graphlab/rpc/circular_iovec_buffer.hpp>
+#include <graphlab/rpc/dc_buffered_stream_send2.hpp>
+using namespace graphlab;
+using namespace graphlab::dc_impl;
+
+class SendBufferPoolTestSuite : public CxxTest::TestSuite {
+public:
+  void test_release_and_acquire() {
+    // nothing to return
+    release_send_buffer(NULL, INITIAL_BUFFER_SIZE);
+    char* a = acquire_send_buffer();
+    char* b = acquire_send_buffer();
+    TS_ASSERT(a != NULL);
+    TS_ASSERT(b != NULL);
+    TS_ASSERT(a != b);
+    // the whole chunk is writable
+    memset(a, 1, INITIAL_BUFFER_SIZE);
+    release_send_buffer(a, INITIAL_BUFFER_SIZE);
+    release_send_buffer(b, INITIAL_BUFFER_SIZE);
+    // last released, first reused
+    TS_ASSERT_EQUALS(acquire_send_buffer(), b);
+    TS_ASSERT_EQUALS(acquire_send_buffer(), a);
+    release_send_buffer(a, INITIAL_BUFFER_SIZE);
+    release_send_buffer(b, INITIAL_BUFFER_SIZE);
+  }
+
+  void test_other_capacities_are_freed() {
+    char* a = acquire_send_buffer();
+    release_send_buffer(a, INITIAL_BUFFER_SIZE);
+    // grown and shrunk buffers do not enter the pool
+    release_send_buffer((char*)malloc(128), 128);
+    release_send_buffer((char*)malloc(2 * INITIAL_BUFFER_SIZE),
+                        2 * INITIAL_BUFFER_SIZE);
+    TS_ASSERT_EQUALS(acquire_send_buffer(), a);
+    release_send_buffer(a, INITIAL_BUFFER_SIZE);
+  }
+
+  void test_pool_size_is_bounded() {
+    const size_t n = RPC_SEND_BUFFER_POOL_SIZE + 1;
+    std::vector<char*> bufs(n);
+    for (size_t i = 0;i < n; ++i) bufs[i] = acquire_send_buffer();
+    for (size_t i = 0;i < n; ++i) release_send_buffer(bufs[i], INITIAL_BUFFER_SIZE);
+    // the last buffer found the pool full and was freed
+    for (size_t i = 0;i < RPC_SEND_BUFFER_POOL_SIZE; ++i) {
+      TS_ASSERT_EQUALS(acquire_send_buffer(), bufs[RPC_SEND_BUFFER_POOL_SIZE - 1 - i]);
+    }
+    for (size_t i = 0;i < RPC_SEND_BUFFER_POOL_SIZE; ++i) {
+      release_send_buffer(bufs[i], INITIAL_BUFFER_SIZE);
+    }
+  }
+
+  void test_outgoing_data_is_handed_off_once() {
+    dc_buffered_stream_send2 sender(NULL, NULL, 0);
+    char* a = acquire_send_buffer();
+    memcpy(a, "hello", 5);
+    sender.write_to_buffer(a, 5, INITIAL_BUFFER_SIZE);
+    char* b = (char*)malloc(32);
+    memcpy(b, "0123456789", 10);
+    sender.write_to_buffer(b, 10, 32);
+
+    circular_iovec_buffer outdata;
+    TS_ASSERT_EQUALS(sender.get_outgoing_data(outdata), 15);
+    TS_ASSERT_EQUALS(outdata.size(), 2);
+    TS_ASSERT_EQUALS(outdata.parallel_v[0].iov_base, a);
+    TS_ASSERT_EQUALS(outdata.parallel_v[0].iov_len, 5);
+    TS_ASSERT_EQUALS(outdata.v[0].iov_len, INITIAL_BUFFER_SIZE);
+    TS_ASSERT_EQUALS(outdata.parallel_v[1].iov_base, b);
+    TS_ASSERT_EQUALS(outdata.parallel_v[1].iov_len, 10);
+    TS_ASSERT_EQUALS(outdata.v[1].iov_len, 32);
+
+    // the buffers now belong to outdata and are not sent again
+    TS_ASSERT_EQUALS(sender.get_outgoing_data(outdata), 0);
+    TS_ASSERT_EQUALS(outdata.size(), 2);
+
+    // once sent, the pooled chunk goes back to the pool
+    outdata.sent(15);
+    TS_ASSERT(outdata.empty());
+    char* c = acquire_send_buffer();
+    TS_ASSERT_EQUALS(c, a);
+    release_send_buffer(c, INITIAL_BUFFER_SIZE);
+  }
+};
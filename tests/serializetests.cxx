@@ -36,6 +36,7 @@
 
 #include <graphlab/util/generics/any.hpp>
 #include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/util/timer.hpp>
 
 
 using namespace graphlab;
@@ -414,5 +415,80 @@ public:
         TS_ASSERT_EQUALS(p1[i].x, p2[i].x);
     }
   }
+
+  void test_pair_vector_serialization() {
+    typedef std::pair<uint32_t, uint32_t> packed_pair;
+    typedef std::pair<uint32_t, double> padded_pair;
+    TS_ASSERT(gl_is_bulk_serializable<packed_pair>::value);
+    TS_ASSERT(!gl_is_bulk_serializable<padded_pair>::value);
+    std::vector<packed_pair> p1;
+    std::vector<padded_pair> q1;
+    for (uint32_t i = 0;i < 1000; ++i) {
+      p1.push_back(packed_pair(i, 3 * i));
+      q1.push_back(padded_pair(i, i / 2.0));
+    }
+    oarchive oarc;
+    oarc << p1 << q1 << std::vector<packed_pair>();
+    // the packed pairs are written as a single block after the length
+    iarchive iarc(oarc.buf, oarc.off);
+    size_t len = 0;
+    iarc >> len;
+    TS_ASSERT_EQUALS(len, p1.size());
+    TS_ASSERT_EQUALS(memcmp(oarc.buf + iarc.off, &p1[0],
+                            p1.size() * sizeof(packed_pair)), 0);
+
+    std::vector<packed_pair> p2, p3(5);
+    std::vector<padded_pair> q2;
+    iarchive iarc2(oarc.buf, oarc.off);
+    iarc2 >> p2 >> q2 >> p3;
+    TS_ASSERT(p1 == p2);
+    TS_ASSERT(q1 == q2);
+    TS_ASSERT(p3.empty());
+    TS_ASSERT_EQUALS(iarc2.off, oarc.off);
+    free(oarc.buf);
+  }
+
+  // compares writing and reading a vector element by element with
+  // a single copy of its bytes
+  void test_bulk_serialization_throughput() {
+    std::vector<std::pair<uint32_t, uint32_t> > v(1 << 22);
+    for (size_t i = 0;i < v.size(); ++i) {
+      v[i].first = i; v[i].second = i ^ 0x5555;
+    }
+    const double mb = double(v.size() * sizeof(v[0])) / (1024 * 1024);
+    timer ti;
+    oarchive elem_oarc;
+    ti.start();
+    elem_oarc << v.size();
+    serialize_iterator(elem_oarc, v.begin(), v.end());
+    const double elem_write = ti.current_time();
+    std::vector<std::pair<uint32_t, uint32_t> > w;
+    iarchive elem_iarc(elem_oarc.buf, elem_oarc.off);
+    ti.start();
+    size_t len = 0;
+    elem_iarc >> len;
+    w.reserve(len);
+    deserialize_iterator<iarchive, std::pair<uint32_t, uint32_t> >(
+        elem_iarc, std::inserter(w, w.end()));
+    const double elem_read = ti.current_time();
+    TS_ASSERT(v == w);
+
+    oarchive bulk_oarc;
+    ti.start();
+    bulk_oarc << v;
+    const double bulk_write = ti.current_time();
+    iarchive bulk_iarc(bulk_oarc.buf, bulk_oarc.off);
+    ti.start();
+    bulk_iarc >> w;
+    const double bulk_read = ti.current_time();
+    TS_ASSERT(v == w);
+
+    std::cout << "\nPer element: write " << mb / elem_write << " MB/s, read "
+              << mb / elem_read << " MB/s\n"
+              << "Bulk: write " << mb / bulk_write << " MB/s, read "
+              << mb / bulk_read << " MB/s" << std::endl;
+    free(elem_oarc.buf);
+    free(bulk_oarc.buf);
+  }
 };
 
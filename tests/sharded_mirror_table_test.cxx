@@ -0,0 +1,82 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <vector>
+#include <boost/bind.hpp>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/graph/ingress/sharded_mirror_table.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/macros_def.hpp>
+using namespace graphlab;
+
+typedef fixed_dense_bitset<128> bin_counts_type;
+typedef sharded_mirror_table<bin_counts_type> table_type;
+
+static const size_t NTHREADS = 8;
+static const size_t NVIDS = 20000;
+
+// thread t marks bit t on every vertex, visiting them in a different order
+void mark_all(table_type* table, size_t t) {
+  for (size_t i = 0; i < NVIDS; ++i) {
+    const vertex_id_type vid = (i * 7919 + t * 104729) % NVIDS;
+    bin_counts_type& mirrors = (*table)[vid];
+    mirrors.set_bit(t);
+  }
+}
+
+class ShardedMirrorTableTestSuite : public CxxTest::TestSuite {
+public:
+  void test_stable_references(void) {
+    table_type table(4);
+    bin_counts_type& first = table[42];
+    TS_ASSERT(first.empty());
+    first.set_bit(3);
+    // force the index of every shard to grow
+    for (vertex_id_type vid = 0; vid < 10000; ++vid) table[vid * 3 + 1];
+    TS_ASSERT_EQUALS(&table[42], &first);
+    TS_ASSERT(table[42].get(3));
+    TS_ASSERT_EQUALS(table.size(), 10001);
+    table.clear();
+    TS_ASSERT_EQUALS(table.size(), 0);
+    TS_ASSERT(table[42].empty());
+  }
+
+  void test_concurrent_insert(void) {
+    table_type table(16);
+    thread_group group;
+    for (size_t t = 0; t < NTHREADS; ++t) {
+      group.launch(boost::bind(mark_all, &table, t));
+    }
+    group.join();
+    TS_ASSERT_EQUALS(table.size(), NVIDS);
+    std::vector<bool> seen(NVIDS, false);
+    for (size_t s = 0; s < table.num_shards(); ++s) {
+      foreach(const table_type::entry_type& entry, table.shard_entries(s)) {
+        TS_ASSERT(!seen[entry.first]);
+        seen[entry.first] = true;
+        TS_ASSERT_EQUALS(entry.second.popcount(), NTHREADS);
+      }
+    }
+  }
+};
@@ -86,6 +86,33 @@ void test_tsv(graphlab::distributed_control& dc) {
   check_structure(graph);  
 }
 
+void test_snap_lines(graphlab::distributed_control& dc) {
+  graphlab::distributed_graph<size_t, size_t> graph(dc);
+  graph.load("data/test_snap", graphlab::builtin_parsers::snap_parser<graph_type>);
+  graph.finalize();
+  check_structure(graph);  
+}
+
+void test_tsv_split(graphlab::distributed_control& dc) {
+  graphlab::graphlab_options opts;
+  opts.get_graph_args().set_option("split_ingress", true);
+  opts.get_graph_args().set_option("split_size", 3);
+  graphlab::distributed_graph<size_t, size_t> graph(dc, opts);
+  graph.load_format("data/test_tsv", "tsv");
+  graph.finalize();
+  check_structure(graph);  
+}
+
+void test_adj_split(graphlab::distributed_control& dc) {
+  graphlab::graphlab_options opts;
+  opts.get_graph_args().set_option("split_ingress", true);
+  opts.get_graph_args().set_option("split_size", 5);
+  graphlab::distributed_graph<size_t, size_t> graph(dc, opts);
+  graph.load_format("data/test_adj", "adj");
+  graph.finalize();
+  check_structure(graph);  
+}
+
 void test_powerlaw(graphlab::distributed_control& dc) {
   graphlab::distributed_graph<size_t, size_t> graph(dc);
   graph.load_synthetic_powerlaw(1000);
@@ -117,13 +144,32 @@ void test_save_load(graphlab::distributed_control& dc) {
 
 }
 
+void test_partition_snapshot(graphlab::distributed_control& dc) {
+  graphlab::distributed_graph<size_t, size_t> graph(dc);
+  graph.load_format("data/test_tsv", "tsv");
+  ASSERT_TRUE(graph.save_partition("data/test_snapshot"));
+  graphlab::distributed_graph<size_t, size_t> graph2(dc);
+  ASSERT_TRUE(graph2.load_partition("data/test_snapshot"));
+  ASSERT_TRUE(graph2.is_finalized());
+  ASSERT_EQ(graph.num_vertices(), graph2.num_vertices());
+  ASSERT_EQ(graph.num_edges(), graph2.num_edges());
+  ASSERT_EQ(graph.num_replicas(), graph2.num_replicas());
+  check_structure(graph2);
+  graphlab::distributed_graph<size_t, size_t> graph3(dc);
+  ASSERT_FALSE(graph3.load_partition("data/no_such_snapshot"));
+}
+
 
 int main(int argc, char** argv) {
   graphlab::distributed_control dc;
   test_adj(dc);
   test_snap(dc);
   test_tsv(dc);
+  test_snap_lines(dc);
+  test_tsv_split(dc);
+  test_adj_split(dc);
   test_powerlaw(dc);
   test_save_load(dc);
+  test_partition_snapshot(dc);
 };
 
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <vector>
+#include <boost/bind.hpp>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/parallel/work_stealing_deque.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+using namespace graphlab;
+
+static const size_t NTHIEVES = 4;
+static const size_t NVALUES = 200000;
+
+struct is_odd {
+  bool operator()(size_t v) const { return v % 2 == 1; }
+};
+
+// pushes 1 to NVALUES, taking every third value back itself
+void owner(work_stealing_deque<size_t>* deque, std::vector<size_t>* taken) {
+  size_t v;
+  for (size_t i = 1;i <= NVALUES; ++i) {
+    deque->push(i);
+    if (i % 3 == 0 && deque->steal(v)) ++(*taken)[v];
+  }
+}
+
+void thief(work_stealing_deque<size_t>* deque, std::vector<size_t>* taken,
+           atomic<size_t>* ntaken) {
+  size_t v;
+  while (ntaken->value < NVALUES) {
+    if (deque->steal(v)) {
+      __sync_fetch_and_add(&(*taken)[v], 1);
+      ntaken->inc();
+    }
+  }
+}
+
+class WorkStealingDequeTestSuite : public CxxTest::TestSuite {
+public:
+  void test_fifo_and_growth(void) {
+    work_stealing_deque<size_t> deque(4);
+    TS_ASSERT(deque.empty());
+    for (size_t i = 0;i < 100; ++i) deque.push(i);
+    TS_ASSERT_EQUALS(deque.approx_size(), 100);
+    size_t v = 0;
+    // a refused top stays at the top
+    TS_ASSERT(!deque.steal(v, is_odd()));
+    for (size_t i = 0;i < 50; ++i) {
+      TS_ASSERT(deque.steal(v));
+      TS_ASSERT_EQUALS(v, i);
+    }
+    TS_ASSERT(!deque.steal(v, is_odd()));
+    for (size_t i = 100;i < 200; ++i) deque.push(i);
+    for (size_t i = 50;i < 200; ++i) {
+      TS_ASSERT(deque.steal(v));
+      TS_ASSERT_EQUALS(v, i);
+    }
+    TS_ASSERT(deque.empty());
+    TS_ASSERT(!deque.steal(v));
+  }
+
+  void test_concurrent_steal(void) {
+    work_stealing_deque<size_t> deque;
+    std::vector<size_t> taken(NVALUES + 1, 0);
+    std::vector<size_t> owner_taken(NVALUES + 1, 0);
+    atomic<size_t> ntaken;
+    thread_group group;
+    for (size_t i = 0;i < NTHIEVES; ++i) {
+      group.launch(boost::bind(thief, &deque, &taken, &ntaken));
+    }
+    owner(&deque, &owner_taken);
+    for (size_t i = 1;i <= NVALUES; ++i) {
+      if (owner_taken[i]) ntaken.inc();
+    }
+    group.join();
+    // every value was taken exactly once
+    for (size_t i = 1;i <= NVALUES; ++i) {
+      TS_ASSERT_EQUALS(taken[i] + owner_taken[i], 1);
+    }
+    TS_ASSERT(deque.empty());
+  }
+};
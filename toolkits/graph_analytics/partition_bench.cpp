@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+/**
+ * Partition quality benchmark. Loads the same graph once per ingress
+ * method, runs a fixed number of PageRank super-steps on it and appends
+ * one JSON object per method to the result file (or prints it):
+ *
+ *   mpiexec -n 8 ./partition_bench --powerlaw=1000000
+ *   mpiexec -n 8 ./partition_bench --graph=/data/lj --format=snap \
+ *       --ingress=random,zodiac --graph_opts interval=2000 \
+ *       --result_file=lj.json
+ *
+ * rss_bytes is the largest resident set size of any machine right after
+ * finalize(). It is sampled from /proc/self/statm rather than the process
+ * high-water mark, so every method reports its own footprint; memory the
+ * allocator keeps from earlier methods is still counted.
+ */
+
+#include <unistd.h>
+
+#include <cstdio>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include <graphlab.hpp>
+#include <graphlab/util/stl_util.hpp>
+#include <graphlab/util/memory_info.hpp>
+#include <graphlab/macros_def.hpp>
+
+typedef double vertex_data_type;
+typedef graphlab::empty edge_data_type;
+typedef graphlab::distributed_graph<vertex_data_type, edge_data_type> graph_type;
+
+void init_vertex(graph_type::vertex_type& vertex) { vertex.data() = 1; }
+
+/*
+ * Plain PageRank over the in-edges, so that the engine time reflects the
+ * mirror synchronization cost of the partition.
+ */
+class pagerank :
+  public graphlab::ivertex_program<graph_type, double>,
+  public graphlab::IS_POD_TYPE {
+public:
+  edge_dir_type gather_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return graphlab::IN_EDGES;
+  }
+
+  double gather(icontext_type& context, const vertex_type& vertex,
+                edge_type& edge) const {
+    return edge.source().data() / edge.source().num_out_edges();
+  }
+
+  void apply(icontext_type& context, vertex_type& vertex,
+             const gather_type& total) {
+    vertex.data() = 0.85 * total + 0.15;
+  }
+
+  edge_dir_type scatter_edges(icontext_type& context,
+                              const vertex_type& vertex) const {
+    return graphlab::NO_EDGES;
+  }
+}; // end of pagerank
+
+
+/// Every ingress method the graph registers
+const char* ALL_INGRESS =
+  "random,random2,grid,pds,oblivious,hybrid,hybrid_ginger,libra,"
+  "zodiac,constell,bipartite,bipartite_aweto";
+
+/// Returns the current resident set size of this process in bytes
+size_t current_rss_bytes() {
+  FILE* fp = fopen("/proc/self/statm", "r");
+  if (fp == NULL) return 0;
+  unsigned long size = 0, resident = 0;
+  const int nread = fscanf(fp, "%lu %lu", &size, &resident);
+  fclose(fp);
+  if (nread != 2) return 0;
+  return size_t(resident) * size_t(sysconf(_SC_PAGESIZE));
+}
+
+/// Returns the largest value of v over all the machines
+size_t max_over_procs(graphlab::distributed_control& dc, size_t v) {
+  std::vector<size_t> values(dc.numprocs(), 0);
+  values[dc.procid()] = v;
+  dc.all_gather(values);
+  return *std::max_element(values.begin(), values.end());
+}
+
+/// Returns false if method cannot run on the current number of machines
+bool is_supported(const std::string& method, size_t numprocs) {
+  int nrow, ncol, p;
+  if (method == "grid")
+    return graphlab::sharding_constraint::is_grid_compatible(numprocs, nrow, ncol);
+  if (method == "pds")
+    return graphlab::sharding_constraint::is_pds_compatible(numprocs, p);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+  global_logger().set_log_level(LOG_INFO);
+
+  graphlab::command_line_options clopts("Partition quality benchmark.");
+  std::string graph_dir;
+  std::string format = "snap";
+  clopts.attach_option("graph", graph_dir,
+                       "The graph file. If none is provided a synthetic "
+                       "power-law graph is generated.");
+  clopts.add_positional("graph");
+  clopts.attach_option("format", format, "The graph file format");
+  size_t powerlaw = 100000;
+  clopts.attach_option("powerlaw", powerlaw,
+                       "Number of vertices of the synthetic power-law graph");
+  double alpha = 2.1, beta = 2.2;
+  clopts.attach_option("alpha", alpha, "Power-law constant for indegree");
+  clopts.attach_option("beta", beta, "Power-law constant for outdegree");
+  std::string ingress_list = ALL_INGRESS;
+  clopts.attach_option("ingress", ingress_list,
+                       "Comma separated ingress methods to compare");
+  size_t iterations = 10;
+  clopts.attach_option("iterations", iterations,
+                       "Number of PageRank super-steps to time");
+  std::string result_file;
+  clopts.attach_option("result_file", result_file,
+                       "If set, the results are appended to this file as "
+                       "one JSON object per line");
+  if(!clopts.parse(argc, argv)) {
+    dc.cout() << "Error in parsing command line arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+  clopts.get_engine_args().set_option("max_iterations", iterations);
+  clopts.get_engine_args().set_option("sched_allv", true);
+
+  const std::string graph_name = graph_dir.empty() ?
+    "powerlaw:" + graphlab::tostr(powerlaw) + ":" + graphlab::tostr(alpha)
+                + ":" + graphlab::tostr(beta) : graph_dir;
+
+  std::vector<std::string> methods = graphlab::strsplit(ingress_list, ",", true);
+  foreach(const std::string& method, methods) {
+    if (!is_supported(method, dc.numprocs())) {
+      dc.cout() << "Skipping " << method << ": not supported on "
+                << dc.numprocs() << " machines" << std::endl;
+      continue;
+    }
+    graphlab::graphlab_options opts = clopts;
+    opts.get_graph_args().set_option("ingress", method);
+    // hybrid_ginger requires the graph size hints
+    if (method == "hybrid_ginger") {
+      if (!opts.get_graph_args().is_set("nedges"))
+        opts.get_graph_args().set_option("nedges", 15);
+      if (!opts.get_graph_args().is_set("nverts"))
+        opts.get_graph_args().set_option("nverts", 1);
+    }
+
+    dc.full_barrier();
+    const size_t bytes_before = dc.network_bytes_sent();
+    graphlab::timer timer;
+    timer.start();
+    graph_type graph(dc, opts);
+    if (graph_dir.empty()) {
+      graph.load_synthetic_powerlaw2(powerlaw, alpha, beta, 100000000);
+    } else {
+      graph.load_format(graph_dir, format);
+    }
+    graph.finalize();
+    const double ingress_time = timer.current_time();
+    size_t network_bytes = dc.network_bytes_sent() - bytes_before;
+    dc.all_reduce(network_bytes);
+    const size_t rss = max_over_procs(dc, current_rss_bytes());
+    const size_t heap = max_over_procs(dc, graphlab::memory_info::allocated_bytes());
+
+    graph.transform_vertices(init_vertex);
+    graphlab::synchronous_engine<pagerank> engine(dc, graph, opts);
+    engine.signal_all();
+    engine.start();
+    const std::vector<double>& superstep_times = engine.get_superstep_times();
+
+    if (dc.procid() == 0) {
+      std::stringstream strm;
+      strm << "{\"graph\": \"" << graph_name << "\""
+           << ", \"nprocs\": " << dc.numprocs()
+           << ", \"ingress\": \"" << method << "\""
+           << ", \"nverts\": " << graph.num_vertices()
+           << ", \"nedges\": " << graph.num_edges()
+           << ", \"ingress_time\": " << ingress_time
+           << ", \"rss_bytes\": " << rss
+           << ", \"heap_bytes\": " << heap
+           << ", \"network_bytes\": " << network_bytes
+           << ", \"replication_factor\": "
+           << (double)graph.num_replicas() / graph.num_vertices()
+           << ", \"edge_balance\": " << graph.get_edge_balance()
+           << ", \"vertex_balance\": " << graph.get_vertex_balance()
+           << ", \"engine_time\": " << engine.get_exec_time()
+           << ", \"compute_balance\": " << engine.get_compute_balance()
+           << ", \"superstep_times\": [";
+      for (size_t i = 0; i < superstep_times.size(); ++i) {
+        strm << (i ? ", " : "") << superstep_times[i];
+      }
+      strm << "]}";
+      std::cout << strm.str() << std::endl;
+      if (!result_file.empty()) {
+        std::ofstream fout(result_file.c_str(), std::ios::app);
+        fout << strm.str() << std::endl;
+      }
+    }
+  }
+
+  graphlab::mpi_tools::finalize();
+  return EXIT_SUCCESS;
+} // End of main